@@ -0,0 +1,98 @@
+/*  Host check for susan_ra4m1_minima_adc_oversample.h - plans run end to end on SimAdc: a dithered
+ *  DC level and a sine through adc_os_begin() / adc_os_feed(), the ENOB measured by AdcEnob on the
+ *  outputs against the plan's predicted p.enob.
+ *
+ *    g++ -std=gnu++17 -Wall -Wextra -DRA4M1_HOST_SIM -I.. adc_oversample.cpp -o adc_oversample && ./adc_oversample
+ *
+ * This code is "AS IS" without warranty or liability.
+ * GPL v3 or later - see susan_ra4m1_minima_register_defines.h
+*/
+
+#include <cmath>
+#include <random>
+#include "susan_ra4m1_minima_adc_oversample.h"
+#include "check.h"
+
+using namespace ra4m1;
+
+constexpr unsigned int ch = adc_pin(A0);
+constexpr unsigned int FRAMES = 256;
+constexpr float ENOB_TOLERANCE = 0.2f;  // Measured against predicted, bits - 400 outputs
+
+// The plan on SimAdc - the converter's own noise set to give the plan's enob_12 / enob_14, on
+// a DC level or a sine of 50 outputs a period - and the ENOB measured over 'outputs'
+static float measure(const AdcOsPlan &p, bool sine, unsigned int outputs) {
+  sim_reset();
+  std::mt19937 rng(1);
+  double enob_in = p.res == 12 ? ADC_OS_LIMITS.enob_12 : ADC_OS_LIMITS.enob_14;
+  double total = std::pow(2.0, p.res - enob_in) / std::sqrt(12.0);  // Noise and quantisation, LSB rms
+  std::normal_distribution<double> noise(0, std::sqrt(total * total - 1.0 / 12));
+  double fs = (double)(1u << p.res), per_output = (double)p.hw * p.ratio;
+  auto ideal = [&](unsigned long c) { return sine ? fs * (0.5 + 0.4 * std::sin(2 * M_PI * c / (per_output * 50))) : fs * 0.3137; };
+
+  unsigned long conv = 0;
+  SimAdc adc;
+  adc.input = [&](unsigned int, unsigned int) {
+    double v = std::floor(ideal(conv++) + noise(rng) + 0.5);
+    return (unsigned short)(v < 0 ? 0 : v > fs - 1 ? fs - 1 : v);
+  };
+  AdcOversampler os;
+  if(!adc_os_begin(os, p, ch)) return 0;
+  static unsigned short buf[adc_stream_words(ch, FRAMES)];
+  adc_stream_begin(ch, buf, FRAMES, ADC_MOVE_ISR);
+
+  AdcEnob e;
+  e.clear();
+  double scale = std::pow(2.0, (double)p.bits - p.res);
+  unsigned int got = 0;
+  while(got < outputs) {
+    adc.run(FRAMES);
+    const AdcBlock *b = adc_stream_get();
+    if(!b) continue;
+    unsigned int out[FRAMES];
+    unsigned int n = adc_os_feed(os, b, out, FRAMES);
+    adc_stream_release(b);
+    for(unsigned int i = 0; i < n; i++, got++) {
+      if(!sine) {
+        e.add(out[i]);
+        continue;
+      }
+      // Order 1 is a block average - the reference is the mean of the ideal over the output's
+      // conversions, in output LSBs
+      unsigned long first = (unsigned long)got * p.hw * p.ratio;
+      double m = 0;
+      for(unsigned long c = first; c < first + p.hw * p.ratio; c++) m += ideal(c);
+      e.add(out[i], m / per_output * scale);
+    }
+  }
+  adc_stream_stop();
+  return e.enob(p.bits);
+}
+
+static void check_enob(const char *name, const AdcOsPlan &p, bool sine) {
+  float enob = measure(p, sine, 400);
+  check(std::fabs(enob - p.enob) <= ENOB_TOLERANCE, "%s, %s: ENOB %.2f measured, %.2f planned", name, sine ? "sine" : "dithered DC",
+        enob, p.enob);
+}
+
+int main() {
+  check_begin();
+
+  AdcOsPlan p = adc_os_plan(16, 100);
+  check(p.ok && p.res == 14 && p.hw == 4 && p.ratio == 128 && p.bits == 18 && p.scan_hz == 12800, "16 bits at 100 Hz: 14 bit, 4x ADADC, CIC / 128, 12.8 kHz scans");
+  check_enob("16 bits at 100 Hz", p, false);
+  check_enob("16 bits at 100 Hz", p, true);
+
+  p = adc_os_plan(14, 1000);
+  check(p.ok && p.ratio == 8, "14 bits at 1 kHz: CIC / 8");
+  check_enob("14 bits at 1 kHz", p, false);
+  check_enob("14 bits at 1 kHz", p, true);
+
+  p = adc_os_plan(15, 2000, 1, 2);
+  check(p.ok && p.order == 2, "15 bits at 2 kHz, order 2");
+  check_enob("15 bits at 2 kHz order 2", p, false);
+
+  check(!adc_os_plan(20, 1000).ok, "20 bits at 1 kHz is refused");
+
+  return check_end();
+}
@@ -0,0 +1,70 @@
+/*  Host check for the bit-band macros and ra4m1::BitBand - the alias words of BITBAND_PERI() and
+ *  BitBand<>::alias against bitband_alias() of the register defines' addresses, and set / clear
+ *  through the alias flipping the one bit in the simulated register image.
+ *
+ *    g++ -std=gnu++17 -Wall -Wextra -DRA4M1_HOST_SIM -I.. bitband.cpp -o bitband && ./bitband
+ *
+ * This code is "AS IS" without warranty or liability.
+ * GPL v3 or later - see susan_ra4m1_minima_register_defines.h
+*/
+
+#include "susan_ra4m1_minima_register_types.h"
+#include "check.h"
+
+using namespace ra4m1;
+
+// BITBAND_PERI(reg, bit) and, where there is one, the typed register's BitBand<>::alias - both
+// must be bitband_alias() of the define's address
+static void check_alias(const char *name, SimBitBand b, const volatile void *reg, unsigned int bit, unsigned int typed = 0) {
+  unsigned int want = bitband_alias(phys(reg), bit);
+  check(want != 0 && b.alias == want, "BITBAND_PERI(%s) is 0x%08X", name, want);
+  if(typed) check(typed == want, "BitBand<> of %s is 0x%08X", name, want);
+}
+
+#define CHECK_ALIAS(reg, bit, ...) check_alias(#reg ", " #bit, BITBAND_PERI(reg, bit), reg, bit, ##__VA_ARGS__)
+
+// Set and clear through the alias change the one bit and nothing else in the register
+template <typename B, typename T>
+static void check_flip(const char *name, volatile T *reg, unsigned int bit) {
+  unsigned int addr = phys(reg);
+  T others = (T)(0xA5A5A5A5u & ~(1u << bit)), mask = (T)(1u << bit);
+  sim_poke<T>(addr, others);
+  B::set();
+  bool set = sim_peek<T>(addr) == (T)(others | mask) && B::read();
+  B::clear();
+  bool clear = sim_peek<T>(addr) == others && !B::read();
+  check(set && clear, "BitBand<%s>::set() / clear() flip bit %u only", name, bit);
+
+  *BITBAND_PERI(reg, bit) = 1;
+  set = sim_peek<T>(addr) == (T)(others | mask) && *BITBAND_PERI(reg, bit) == 1;
+  *BITBAND_PERI(reg, bit) = 0;
+  clear = sim_peek<T>(addr) == others && *BITBAND_PERI(reg, bit) == 0;
+  check(set && clear, "*BITBAND_PERI(%s) = 1 / 0 flip bit %u only", name, bit);
+}
+
+int main() {
+  check_begin();
+  sim_reset();
+
+  CHECK_ALIAS(AGT0_AGTCR, AGTCR_TSTART, BitBand<AGT0::AGTCR, AGTCR_TSTART>::alias);
+  CHECK_ALIAS(ADC140_ADCSR, ADCSR_ADST, BitBand<ADCSR, ADCSR_ADST>::alias);
+  CHECK_ALIAS(MSTP_MSTPCRD, MSTPD16, BitBand<MSTPCRD, MSTPD16>::alias);
+  CHECK_ALIAS(SYSTEM_OSCSF, OSCSF_PLLSF, BitBand<OSCSF, OSCSF_PLLSF>::alias);
+  CHECK_ALIAS(SCI0_SCR, SCR_TE);
+  CHECK_ALIAS(PORT1_PODR, 11);
+  check(bitband_alias(phys(AGT0_AGTCR), AGTCR_TSTART) == 0x43080100, "AGT0_AGTCR.TSTART alias is 0x43080100, as worked by hand");
+  check(bitband_alias(0x20000004, 31) == 0x220000FC, "SRAM 0x20000004 bit 31 alias is 0x220000FC");
+  check(bitband_alias(0x60000000, 0) == 0, "No alias outside the bit-band regions");
+
+  check_flip<BitBand<AGT0::AGTCR, AGTCR_TSTART>>("AGT0_AGTCR, AGTCR_TSTART", AGT0_AGTCR, AGTCR_TSTART);
+  check_flip<BitBand<ADCSR, ADCSR_ADST>>("ADC140_ADCSR, ADCSR_ADST", ADC140_ADCSR, ADCSR_ADST);
+  check_flip<BitBand<MSTPCRD, MSTPD16>>("MSTP_MSTPCRD, MSTPD16", MSTP_MSTPCRD, MSTPD16);
+
+  volatile unsigned int flags = 0x00000001;
+  *BITBAND_SRAM(&flags, 31) = 1;
+  bool set = flags == 0x80000001u && *BITBAND_SRAM(&flags, 31) == 1;
+  *BITBAND_SRAM(&flags, 0) = 0;
+  check(set && flags == 0x80000000u, "*BITBAND_SRAM(&flags, n) = 1 / 0 flip bit n only");
+
+  return check_end();
+}
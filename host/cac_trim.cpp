@@ -0,0 +1,70 @@
+/*  Host check for susan_ra4m1_minima_cac_trim.h - the trim loop against SimCac: HOCO, MOCO and
+ *  LOCO started off frequency, by interrupt and by polling, must end locked with the simulated
+ *  oscillator itself within the deadband - or half a trim step, when that is more - the trim
+ *  register where the offset puts it, and PRCR as the sketch left it.
+ *
+ *    g++ -std=gnu++17 -Wall -Wextra -DRA4M1_HOST_SIM -I.. cac_trim.cpp -o cac_trim && ./cac_trim
+ *
+ * This code is "AS IS" without warranty or liability.
+ * GPL v3 or later - see susan_ra4m1_minima_register_defines.h
+*/
+
+#include "susan_ra4m1_minima_cac_trim.h"
+#include "check.h"
+
+using namespace ra4m1;
+
+static const char *const names[] = {"MOSC", "SOSC", "HOCO", "MOCO", "LOCO", "PCLKB", "IWDT", "CACREF"};
+
+// 'offset' ppm off with 'gain' ppm a trim step, 400 measurements, the slots used when 'irq'
+static void run(CacClock target, long offset, double gain, unsigned int noise, bool irq, CacClock ref = CAC_MOSC,
+                unsigned long ref_hz = 12000000) {
+  sim_reset();
+  sim_poke<unsigned int>(0x404, 4u << OFS1_HOCOFRQ1_2_0);  // HOCO 48 MHz
+  sim_poke<unsigned short>(SYSTEM + 0xE3FE, (unsigned short)(1 << PRCR_PRC1));  // Left set by the sketch
+  SimCac cac;
+  cac.noise = noise;
+  cac.ppm_per_step = gain;
+  cac.pin_hz = ref_hz;
+  (target == CAC_HOCO ? cac.hoco_offset_ppm : target == CAC_MOCO ? cac.moco_offset_ppm : cac.loco_offset_ppm) = offset;
+  cac.attach();
+
+  CacTrimConfig cfg;
+  cfg.target = target;
+  cfg.ref = ref;
+  cfg.ref_hz = ref_hz;
+  if(irq) {
+    cfg.slot_mend = 12;
+    cfg.slot_ovf = 13;
+  }
+  const char *name = names[target], *by = names[ref], *how = irq ? "interrupt" : "poll";
+  check(cac_trim_start(cfg), "%s %+ld ppm against %s, %s: cac_trim_start()", name, offset, by, how);
+  for(unsigned int i = 0; i < 400; i++) {
+    cac.measure();
+    if(!irq) cac_trim_poll();
+  }
+
+  const CacTrimState &s = cac_trim_state;
+  double ppm = (cac.clock_hz(target) / cac_nominal_hz(target) - 1) * 1e6;
+  long want = (long)__builtin_lround(-offset / gain);
+  double band = __builtin_fabs(gain) / 2 > cfg.deadband_ppm ? __builtin_fabs(gain) / 2 : cfg.deadband_ppm;
+  check(s.locked && s.overflows == 0 && s.measurements == 400, "%s: locked, %u measurements, no overflows", name, s.measurements);
+  check(ppm > -band && ppm < band, "%s: %+.0f ppm after %u trim steps - within %.0f", name, ppm, s.adjustments, band);
+  check(s.trim >= want - 2 && s.trim <= want + 2 && s.trim == cac_trim_read(target), "%s: trim %d, offset / step %ld", name, s.trim, want);
+  check((sim_peek<unsigned short>(SYSTEM + 0xE3FE) & 0xFF) == (1 << PRCR_PRC1), "%s: PRCR back as it was, PRC1 still set", name);
+  check(gain * s.ppm_per_step > 0, "%s: learnt %ld ppm a step, modelled %.0f", name, s.ppm_per_step, gain);
+
+  cac_trim_stop();
+  check(!(sim_peek<unsigned char>(CACBASE + 0x4600) & (1 << CACR0_CFME)), "%s: cac_trim_stop() stops the CAC", name);
+}
+
+int main() {
+  check_begin();
+  run(CAC_HOCO, 9000, 350, 0, true);
+  run(CAC_HOCO, -15000, 120, 3, true);
+  run(CAC_HOCO, 5000, -400, 3, false);         // A trim register that runs the other way
+  run(CAC_MOCO, 7000, 800, 2, true);
+  run(CAC_LOCO, -20000, 1500, 2, true);        // Swapped - the crystal counted over LOCO periods
+  run(CAC_HOCO, 4000, 350, 0, true, CAC_PIN, 1000);
+  return check_end();
+}
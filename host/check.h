@@ -0,0 +1,43 @@
+/*  The host checks' shared harness - one line per check, ok or FAIL, and a passed / FAILED
+ *  footer with the exit code to match:
+ *
+ *    int main() {
+ *      check_begin();
+ *      check(lat_begin(), "lat_begin() gets two slots");
+ *      check(r.entry.min == 12, "%s: entry min %u", name, r.entry.min);   // printf style
+ *      return check_end();
+ *    }
+ *
+ * This code is "AS IS" without warranty or liability.
+ * GPL v3 or later - see susan_ra4m1_minima_register_defines.h
+*/
+
+#ifndef SUSAN_RA4M1_MINIMA_HOST_CHECK_H
+#define SUSAN_RA4M1_MINIMA_HOST_CHECK_H
+
+#include <cstdarg>
+#include <cstdio>
+
+inline unsigned int check_failures = 0;
+
+// Unbuffered, so the lines up to a crash or an abort in the sim are all there
+inline void check_begin() { setvbuf(stdout, nullptr, _IONBF, 0); }
+
+__attribute__((format(printf, 2, 3)))
+inline bool check(bool ok, const char *what, ...) {
+  va_list args;
+  va_start(args, what);
+  printf("%s  ", ok ? "ok  " : "FAIL");
+  vprintf(what, args);
+  printf("\n");
+  va_end(args);
+  if(!ok) check_failures++;
+  return ok;
+}
+
+inline int check_end() {
+  printf("%s\n", check_failures ? "FAILED" : "passed");
+  return check_failures ? 1 : 0;
+}
+
+#endif  // SUSAN_RA4M1_MINIMA_HOST_CHECK_H
@@ -0,0 +1,77 @@
+/*  Host check for susan_ra4m1_minima_irq_latency.h - lat_run() against SimLatency, whose entry,
+ *  exit and tail-chain times are known, so each histogram must come back bin for bin.
+ *
+ *    g++ -std=gnu++17 -Wall -Wextra -DRA4M1_HOST_SIM -I.. irq_latency.cpp -o irq_latency && ./irq_latency
+ *
+ * This code is "AS IS" without warranty or liability.
+ * GPL v3 or later - see susan_ra4m1_minima_register_defines.h
+*/
+
+#include "susan_ra4m1_minima_irq_latency.h"
+#include "check.h"
+
+using namespace ra4m1;
+
+// Exactly the given counts in the given bins, and nothing anywhere else
+static bool hist_is(const LatencyHist &h, unsigned int n, const unsigned int *values, const unsigned int *counts) {
+  unsigned int total = 0;
+  for(unsigned int i = 0; i < n; i++) {
+    if(h.bin[values[i]] != counts[i]) return false;
+    total += counts[i];
+  }
+  return h.count == total && h.min == values[0] && h.max == values[n - 1];
+}
+
+static LatencyResult r;
+
+static void run(SimLatency &sim, unsigned int priority, unsigned int shots, const char *name) {
+  lat_run(priority, shots, r);
+  const unsigned int exit[] = {sim.exit}, chain[] = {sim.chain}, all[] = {shots};
+  check(hist_is(r.exit, 1, exit, all), "%s: exit all %u", name, sim.exit);
+  check(hist_is(r.chain, 1, chain, all), "%s: chain all %u", name, sim.chain);
+  check(r.priority == priority, "priority recorded");
+}
+
+int main() {
+  check_begin();
+  sim_reset();
+  SimLatency sim;
+  sim.entry = 12;
+  sim.exit = 10;
+  sim.chain = 6;
+  sim.attach();
+  check(lat_begin(), "lat_begin() gets two slots");
+  check(lat_state.read_cost == 1, "GTCNT read cost is one count");
+
+  // No jitter - every entry the same
+  run(sim, 6, 100, "jitter 0");
+  const unsigned int flat[] = {12}, flat_n[] = {100};
+  check(hist_is(r.entry, 1, flat, flat_n), "jitter 0: entry all 12");
+  check(r.entry.p50() == 12 && r.entry.p99() == 12, "jitter 0: p50 / p99 12");
+
+  // Even jitter - the chained entry takes every other step, the measured one 12 and 14
+  sim.jitter = 4;
+  sim.interrupts = 0;
+  run(sim, 0, 100, "jitter 4");
+  const unsigned int even[] = {12, 14}, even_n[] = {50, 50};
+  check(hist_is(r.entry, 2, even, even_n), "jitter 4: entry 50 x 12, 50 x 14");
+  check(r.entry.p50() == 12 && r.entry.p99() == 14, "jitter 4: p50 12, p99 14");
+
+  // Odd jitter - every step comes round to the measured entry
+  sim.jitter = 3;
+  sim.interrupts = 0;
+  run(sim, 15, 99, "jitter 3");
+  const unsigned int odd[] = {12, 13, 14}, odd_n[] = {33, 33, 33};
+  check(hist_is(r.entry, 3, odd, odd_n), "jitter 3: entry 33 each of 12, 13, 14");
+  check(r.entry.p50() == 13 && r.entry.p99() == 14, "jitter 3: p50 13, p99 14");
+
+  // Beyond the bins - min / max stay exact, the last bin takes the rest
+  sim.jitter = 200;
+  sim.interrupts = 0;
+  lat_run(3, 100, r);
+  check(r.entry.min == 12 && r.entry.max == 12 + 198, "jitter 200: min 12, max 210");
+  check(r.entry.bin[LAT_BINS - 1] == 100 - (LAT_BINS - 1 - 12 + 1) / 2, "jitter 200: values over 127 in the last bin");
+
+  lat_end();
+  return check_end();
+}
@@ -0,0 +1,70 @@
+/*  Host check for susan_ra4m1_minima_parallel_bus.h - verify() on the simulated ports, and the
+ *  PCNTR3 stores of one byte in order: each data port, the strobe's port last, then the release.
+ *
+ *    g++ -std=gnu++17 -Wall -Wextra -DRA4M1_HOST_SIM -DRA4M1_MMIO_TRACE -I.. parallel_bus.cpp -o parallel_bus && ./parallel_bus
+ *
+ * This code is "AS IS" without warranty or liability.
+ * GPL v3 or later - see susan_ra4m1_minima_register_defines.h
+*/
+
+#include "susan_ra4m1_minima_parallel_bus.h"
+#include "check.h"
+
+using namespace ra4m1;
+
+struct Store { unsigned int port, value; };
+static Store stores[16];
+static unsigned int nstores = 0;
+
+// Every PCNTR3 store in the trace, in order, as port number and word
+static void traced_pcntr3() {
+  nstores = 0;
+  trace_for_each([](const TraceEntry &e) {
+    unsigned int port = (e.addr - gpio_port_addr(0, PCNTR3)) / 0x20;
+    if(e.write && port < 10 && e.addr == gpio_port_addr(port, PCNTR3) && nstores < 16) stores[nstores++] = Store{port, e.value};
+  });
+}
+
+// The PCNTR3 word a store of 'v' should make on 'port' - data bits set or cleared, the strobe
+// active on its own port
+template <unsigned int Strobe, bool ActiveLow, unsigned int... Bits>
+static unsigned int expect_word(unsigned int port, unsigned int v) {
+  const unsigned int pins[] = {Bits...};
+  unsigned int w = 0;
+  for(unsigned int i = 0; i < sizeof...(Bits); i++)
+    if(gpio_port(pins[i]) == port) w |= ((v >> i) & 1) ? 1u << gpio_bit(pins[i]) : 1u << (gpio_bit(pins[i]) + 16);
+  if(gpio_port(Strobe) == port) w |= 1u << (gpio_bit(Strobe) + (ActiveLow ? 16 : 0));
+  return w;
+}
+
+template <unsigned int Strobe, bool ActiveLow, unsigned int... Bits>
+static void check_bus(const char *name, unsigned int value, const unsigned int *order, unsigned int ports) {
+  typedef ParallelBus<Strobe, ActiveLow, Bits...> Bus;
+  sim_reset();
+  Bus::begin();
+  check(Bus::verify() == -1, "%s: verify() every value", name);
+  check(Bus::tables.ports == ports && sizeof(Bus::tables.word) == ports * 1024, "%s: %u port tables, %u bytes", name, ports,
+        (unsigned int)sizeof(Bus::tables.word));
+
+  trace_clear();
+  Bus::write((unsigned char)value);
+  traced_pcntr3();
+  bool ok = nstores == ports + 1;
+  for(unsigned int j = 0; ok && j < ports; j++)
+    ok = stores[j].port == order[j] && stores[j].value == expect_word<Strobe, ActiveLow, Bits...>(order[j], value);
+  unsigned int idle = 1u << (gpio_bit(Strobe) + (ActiveLow ? 0 : 16));
+  ok = ok && stores[ports].port == gpio_port(Strobe) && stores[ports].value == idle;
+  check(ok, "%s: write(0x%02X) is one store per port, strobe port last, then the release", name, value);
+  check(Bus::read_back() == value, "%s: read back 0x%02X from PIDR", name, value);
+}
+
+int main() {
+  check_begin();
+  const unsigned int lcd[] = {1, 3};    // D2 - D6 on port 1, D8 / D0 / D1 and the D9 strobe on port 3
+  const unsigned int one[] = {1};       // All on port 1
+  const unsigned int three[] = {1, 0};  // Data on port 1, the A0 strobe on port 0
+  check_bus<D9, true, D8, D0, D1, D2, D3, D4, D5, D6>("D8 D0 D1 D2 - D6, D9 low", 0x3A, lcd, 2);
+  check_bus<D13, false, D2, D3, D4, D5, D6, D7, D10, D11>("D2 - D7 D10 D11, D13 high", 0xC5, one, 1);
+  check_bus<A0, true, D2, D3>("D2 D3, A0 low", 0x02, three, 2);
+  return check_end();
+}
@@ -0,0 +1,63 @@
+/*  Host check for susan_ra4m1_minima_register_types.h - the bus accesses of the typed layer,
+ *  counted through the MMIO trace: modify() is one read and one write, assign() one write.
+ *
+ *    g++ -std=gnu++17 -Wall -Wextra -DRA4M1_HOST_SIM -DRA4M1_MMIO_TRACE -I.. register_types.cpp -o register_types && ./register_types
+ *
+ * This code is "AS IS" without warranty or liability.
+ * GPL v3 or later - see susan_ra4m1_minima_register_defines.h
+*/
+
+#include "susan_ra4m1_minima_register_types.h"
+#include "check.h"
+
+using namespace ra4m1;
+
+// The traced accesses, in order, as R / W characters - all must be to 'addr'
+static bool accesses(const char *expect, unsigned int addr) {
+  char seen[16] = {};
+  unsigned int n = 0;
+  bool same = true;
+  trace_for_each([&](const TraceEntry &e) {
+    if(n < 15) seen[n++] = e.write ? 'W' : 'R';
+    same = same && e.addr == addr;
+  });
+  return same && !__builtin_strcmp(seen, expect);
+}
+
+// Widths from the define suffixes
+static_assert(SCKDIVCR::PCKB.len == 3 && SCKDIVCR::PCKB.pos == SCKDIVCR_PCKB_2_0, "PCKB is b10-8");
+static_assert(PLLCCR2::PLLMUL.len == 5 && PLLCCR2::PLODIV.len == 2, "PLLMUL 5 bits, PLODIV 2");
+static_assert(PRCR::PRKEY.len == 8 && PRCR::PRC1.len == 1, "PRKEY 8 bits, PRC1 one");
+static_assert(SCKDIVCR::PCKB.set<4>().bits() == 4u << SCKDIVCR_PCKB_2_0, "set<V>() in place");
+
+int main(int argc, char **) {
+  check_begin();
+  sim_reset();
+  sim_poke<unsigned int>(SCKDIVCR::address, 0x44044444);
+  unsigned int div = (unsigned int)argc + 1;  // 2, not a constant to the compiler
+
+  trace_clear();
+  modify(SCKDIVCR::PCKB = div, SCKDIVCR::PCKA.set<1>(), SCKDIVCR::ICK.set<0>());
+  check(accesses("RW", SCKDIVCR::address), "modify() of three fields is one read, one write");
+  check(sim_peek<unsigned int>(SCKDIVCR::address) == 0x40041244, "modify() keeps the other fields");
+
+  trace_clear();
+  SCKDIVCR::modify(SCKDIVCR::PCKD.set<6>());
+  check(accesses("RW", SCKDIVCR::address), "modify() of one field is one read, one write");
+
+  trace_clear();
+  assign(SCKSCR::CKSEL.set<3>());
+  check(accesses("W", SCKSCR::address), "assign() is one write, no read");
+  check(sim_peek<unsigned char>(SCKSCR::address) == 3, "assign() sets the field");
+
+  trace_clear();
+  PLLCCR2::PLODIV.write(1);
+  check(accesses("RW", PLLCCR2::address), "Field::write() is one read, one write");
+
+  trace_clear();
+  check(SCKDIVCR::PCKB.read() == 2 && accesses("R", SCKDIVCR::address), "Field::read() is one read");
+
+  check((SCKDIVCR::PCKB = div + 8).value == (div & 7), "A run time value is masked to the field");
+
+  return check_end();
+}
@@ -0,0 +1,272 @@
+/*  Arduino UNO R4 Minima - ADC oversampling and CIC decimation for the RA4M1 register defines:
+ *
+ *  Averaging M conversions with about an LSB of noise on them gives half a bit per doubling of
+ *  M. Here the ADC14's own addition (ADADC, on the ADADS channels) does the first 2, 4 or 16,
+ *  and a CIC decimator on the streamed scans does the rest. Ask for effective bits and an output
+ *  rate; the plan picks 12 or 14 bit conversion (ADCER_ADPCR), the ADADC count and the
+ *  decimation ratio, for the lowest scan rate - the fewest samples through the CPU:
+ *
+ *    constexpr unsigned int ch = ra4m1::adc_pin(A0);
+ *    ra4m1::AdcOsPlan p = ra4m1::adc_os_plan(16, 100);        // 16 effective bits at 100 Hz
+ *    // p.res 14, p.hw 4, p.ratio 128, p.scan_hz 12800, p.bits 18, p.enob 16.4 - or p.ok false
+ *    ra4m1::AdcOversampler os;
+ *    ra4m1::adc_os_begin(os, p, ch);                           // ADCER, ADADC, ADADS - ADC stopped
+ *    ra4m1::adc_timed_begin(ch, buf, 64, 4, p.scan_hz);         // Or adc_stream_begin() etc.
+ *    ...
+ *    if(const ra4m1::AdcBlock *b = ra4m1::adc_stream_get()) {
+ *      unsigned int out[4];
+ *      unsigned int n = ra4m1::adc_os_feed(os, b, out, 4);       // p.bits wide, 0 - 2^bits - 1
+ *      ra4m1::adc_stream_release(b);
+ *    }
+ *    // os.cycles_per_output() - CPU cost, ICLK cycles per output sample
+ *
+ *  The CIC is order 1 - 3 (integrate, decimate by a power of two, comb), in 32 bit wrapping
+ *  arithmetic, so the gain res + log2(hw) + order * log2(ratio) has to fit 31 bits. Order 1 is a
+ *  plain block average and the best for white noise; 2 and 3 take the noise a little less far
+ *  down but keep out more of what aliases - the plan counts that in, from the sum of the squared
+ *  filter taps. The ADC adds rather than averages (ADADC_AVEE 0) so its extra bits are kept.
+ *
+ *  The predicted ENOB comes from the converter's own, AdcOsLimits::enob_12 / enob_14, the filter's
+ *  noise gain and the output word's step. AdcEnob measures it on the output - the spread about
+ *  the mean for a steady input, or the error against a known signal:
+ *
+ *    ra4m1::AdcEnob e;  e.clear();
+ *    for(...) e.add(out[i]);                                   // DC input
+ *    float enob = e.enob(p.bits);
+ *
+ *  Note: No noise, no gain - a quiet input on the same code every time stays on it whatever the
+ *        averaging; dither it by an LSB or so. The figures in ADC_OS_LIMITS are rough, for
+ *        ADC14 at PCLKC 48 MHz with the default sampling time on a quiet board: measure the
+ *        board's enob_12 / enob_14 with AdcEnob and hw 1, ratio 1, and pass those.
+ *        16x addition is 12 bit only. ADADC applies to every ADADS channel in the scan.
+ *
+ *  With RA4M1_HOST_SIM, SimAdc adds ADADC conversions on the ADADS channels, so a synthetic
+ *  input with noise runs through the whole pipeline and the ENOB figures can be checked on Linux,
+ *  as host/adc_oversample.cpp does; cycles() there only counts register accesses, so the CPU cost
+ *  reads near 0.
+ *
+ * This code is "AS IS" without warranty or liability.
+ * GPL v3 or later - see susan_ra4m1_minima_register_defines.h
+*/
+
+#ifndef SUSAN_RA4M1_MINIMA_ADC_OVERSAMPLE_H
+#define SUSAN_RA4M1_MINIMA_ADC_OVERSAMPLE_H
+
+#include "susan_ra4m1_minima_adc_stream.h"
+
+namespace ra4m1 {
+
+constexpr unsigned int ADC_OS_MAX_ORDER = 3;
+constexpr unsigned int ADC_OS_MAX_RATIO_LOG2 = 12;  // Ratio up to 4096
+
+struct AdcOsLimits {
+  unsigned long conv_hz_12;  // Conversions per second the ADC can do, 12 bit
+  unsigned long conv_hz_14;
+  float enob_12;             // ENOB of single conversions
+  float enob_14;
+};
+
+constexpr AdcOsLimits ADC_OS_LIMITS = {800000, 600000, 11.0f, 12.0f};
+
+// ADADC counts that add up to a power of two, and their ADADC_ADC codes
+constexpr unsigned char ADC_OS_HW[4] = {1, 2, 4, 16};
+constexpr unsigned char ADC_OS_HW_CODE[4] = {ADC_AVG_1, ADC_AVG_2, ADC_AVG_4, ADC_AVG_16};
+
+
+// ==== Plan ====
+
+struct AdcOsPlan {
+  bool ok;                   // False - nothing reaches the bits at the rate; the best there is
+  unsigned char res;         // 12 / 14
+  unsigned char hw;          // Conversions added per sample by the ADC
+  unsigned char order;       // CIC
+  unsigned int ratio;        // Samples per output
+  unsigned int bits;         // Output word
+  unsigned int shift;        // CIC sum to output
+  unsigned long scan_hz;     // Samples per second to run the ADC at - out_hz * ratio
+  unsigned long conv_hz;     // Conversions per second that takes, all channels
+  float enob;                // Predicted
+};
+
+// Sum of the squared taps over the squared DC gain - sinc^order, 'ratio' long
+constexpr float adc_os_noise_gain(unsigned int order, unsigned int ratio) {
+  float r = (float)ratio;
+  if(order == 1) return 1.0f / r;
+  if(order == 2) return (2.0f * r * r + 1.0f) / (3.0f * r * r * r);
+  return (11.0f * r * r * r * r + 5.0f * r * r + 4.0f) / (20.0f * r * r * r * r * r);
+}
+
+inline float adc_os_enob(unsigned int res, float enob_in, unsigned int hw, unsigned int order, unsigned int ratio, unsigned int bits) {
+  float noise = __builtin_exp2f(2.0f * (res - enob_in)) * adc_os_noise_gain(order, ratio) / hw;
+  float step = __builtin_exp2f(2.0f * ((float)res - (float)bits));
+  return res - 0.5f * __builtin_log2f(noise + step);
+}
+
+// 'bits' effective bits at 'out_hz' outputs per second on each of 'channels' channels
+inline AdcOsPlan adc_os_plan(float bits, unsigned long out_hz, unsigned int channels = 1, unsigned int order = 1,
+                             const AdcOsLimits &lim = ADC_OS_LIMITS) {
+  AdcOsPlan best = {}, top = {};
+  if(!out_hz || !channels || !order || order > ADC_OS_MAX_ORDER) return best;
+  unsigned int want = (unsigned int)bits + 2;  // Output word - its step well under the noise
+  for(unsigned int res = 12; res <= 14; res += 2) {
+    unsigned long conv_max = res == 12 ? lim.conv_hz_12 : lim.conv_hz_14;
+    float enob_in = res == 12 ? lim.enob_12 : lim.enob_14;
+    for(unsigned int h = 0; h < 4; h++) {
+      unsigned int hw = ADC_OS_HW[h], hw_log2 = __builtin_ctz(hw);
+      if(res == 14 && hw > 4) continue;
+      for(unsigned int r = 0; r <= ADC_OS_MAX_RATIO_LOG2; r++) {
+        unsigned int growth = res + hw_log2 + order * r;
+        if(growth > 31) break;
+        unsigned long long scan = (unsigned long long)out_hz << r, conv = scan * hw * channels;
+        if(conv > conv_max) break;
+        AdcOsPlan p = {false, (unsigned char)res, (unsigned char)hw, (unsigned char)order, 1u << r, 0, 0,
+                       (unsigned long)scan, (unsigned long)conv, 0};
+        p.bits = want < growth ? want : growth;
+        p.shift = growth - p.bits;
+        p.enob = adc_os_enob(res, enob_in, hw, order, p.ratio, p.bits);
+        if(p.enob > top.enob) top = p;
+        if(p.enob < bits) continue;
+        p.ok = true;
+        if(!best.ok || p.scan_hz < best.scan_hz || (p.scan_hz == best.scan_hz && p.conv_hz < best.conv_hz)) best = p;
+        break;  // More ratio only costs
+      }
+    }
+  }
+  return best.ok ? best : top;
+}
+
+
+// ==== CIC decimator ====
+
+struct AdcCic {
+  unsigned char order;
+  unsigned char shift;
+  unsigned int ratio;
+  unsigned int phase;
+  unsigned int top;           // Output full scale
+  unsigned int integ[ADC_OS_MAX_ORDER];
+  unsigned int comb[ADC_OS_MAX_ORDER];
+
+  void reset(unsigned int o, unsigned int r, unsigned int s, unsigned int bits) {
+    order = (unsigned char)o;
+    ratio = r;
+    shift = (unsigned char)s;
+    phase = 0;
+    top = bits < 32 ? (1u << bits) - 1 : ~0u;
+    for(unsigned int k = 0; k < ADC_OS_MAX_ORDER; k++) integ[k] = comb[k] = 0;
+  }
+
+  // One sample in - true with 'out' set on every ratio'th, rounded to the output word
+  bool push(unsigned int x, unsigned int &out) {
+    integ[0] += x;
+    for(unsigned int k = 1; k < order; k++) integ[k] += integ[k - 1];
+    if(++phase < ratio) return false;
+    phase = 0;
+    unsigned int y = integ[order - 1];
+    for(unsigned int k = 0; k < order; k++) {
+      unsigned int t = y;
+      y -= comb[k];
+      comb[k] = t;
+    }
+    out = shift ? (y + (1u << (shift - 1))) >> shift : y;
+    if(out > top) out = top;  // Rounded past full scale
+    return true;
+  }
+};
+
+
+// ==== Pipeline ====
+
+struct AdcOversampler {
+  AdcOsPlan plan;
+  unsigned int channel;
+  AdcCic cic;
+  unsigned int warm;          // Outputs still to drop - the CIC's first 'order - 1' are partial
+  unsigned int cycles;        // Spent in adc_os_feed()
+  unsigned int outputs;
+
+  unsigned int cycles_per_output() const { return outputs ? cycles / outputs : 0; }
+};
+
+// The plan into the ADC for 'channels' - ADCSR_ADST has to be 0. 'os' follows the first channel
+inline bool adc_os_begin(AdcOversampler &os, const AdcOsPlan &p, unsigned int channels) {
+  if(!p.ratio || !adc_channels_ok(channels)) return false;
+  unsigned int h = 0;
+  while(h < 3 && ADC_OS_HW[h] != p.hw) h++;
+  mmio_write(MSTP_MSTPCRD, mmio_read(MSTP_MSTPCRD) & ~(1u << MSTPD16));
+  unsigned int adpcr = p.res == 14 ? ADC_ADPCR_14BIT : ADC_ADPCR_12BIT;
+  mmio_write(ADC140_ADCER, (unsigned short)((mmio_read(ADC140_ADCER) & ~(3u << ADCER_ADPCR_1_0)) | (adpcr << ADCER_ADPCR_1_0)));
+  mmio_write(ADC140_ADADC, (unsigned char)(ADC_OS_HW_CODE[h] << ADADC_ADC_2_0));  // AVEE 0 - addition
+  unsigned int add = p.hw > 1 ? channels : 0;
+  mmio_write(ADC140_ADADS0, (unsigned short)((add >> 3) & 0x7FFF));
+  mmio_write(ADC140_ADADS1, (unsigned short)((add >> 19) & 0x3FF));
+  unsigned int ex = mmio_read(ADC140_ADEXICR) & ~((1u << ADEXICR_TSSAD) | (1u << ADEXICR_OCSAD));
+  mmio_write(ADC140_ADEXICR, (unsigned short)(ex | (add & ADC_TEMP ? 1u << ADEXICR_TSSAD : 0) | (add & ADC_VREF ? 1u << ADEXICR_OCSAD : 0)));
+
+  os.plan = p;
+  os.channel = channels & -channels;
+  os.cic.reset(p.order, p.ratio, p.shift, p.bits);
+  os.warm = p.order - 1;
+  os.cycles = os.outputs = 0;
+  cycles_enable();
+  return true;
+}
+
+// The channel's samples in a block through the CIC - returns the outputs written, up to 'max'
+inline unsigned int adc_os_feed(AdcOversampler &os, const AdcBlock *b, unsigned int *out, unsigned int max) {
+  unsigned int start = cycles(), n = 0;
+  const AdcStream &s = adc_streams[b->group];
+  int i = adc_index(s.channels, os.channel);
+  if(i < 0) return 0;
+  const volatile unsigned short *x = b->data + i;
+  for(unsigned int f = 0; f < s.frames; f++, x += s.span) {
+    unsigned int y;
+    if(!os.cic.push(*x, y)) continue;
+    if(os.warm) {
+      os.warm--;
+      continue;
+    }
+    if(n < max) out[n++] = y;
+  }
+  os.cycles += cycles() - start;
+  os.outputs += n;
+  return n;
+}
+
+
+// ==== ENOB measurement ====
+// RMS of the error in output LSBs, offset taken out - against a known signal, or about the mean
+
+struct AdcEnob {
+  unsigned int n;
+  double first;
+  double sum;
+  double sum2;
+
+  void clear() { n = 0; first = sum = sum2 = 0; }
+
+  void add(double value, double ideal = 0) {
+    double e = value - ideal;
+    if(!n) first = e;
+    e -= first;  // Small numbers into the sums
+    sum += e;
+    sum2 += e * e;
+    n++;
+  }
+
+  float rms() const {
+    if(n < 2) return 0;
+    double mean = sum / n, var = sum2 / n - mean * mean;
+    return var > 0 ? (float)__builtin_sqrt(var) : 0.0f;
+  }
+
+  // 'bits' less the noise's - capped at 'bits' for no noise at all
+  float enob(unsigned int bits) const {
+    float r = rms() * 3.4641016f;  // sqrt(12)
+    return r > 1.0f ? bits - __builtin_log2f(r) : (float)bits;
+  }
+};
+
+}  // namespace ra4m1
+
+#endif  // SUSAN_RA4M1_MINIMA_ADC_OVERSAMPLE_H
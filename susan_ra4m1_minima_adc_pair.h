@@ -0,0 +1,185 @@
+/*  Arduino UNO R4 Minima - paired ADC sampling and block power for the RA4M1 register defines:
+ *
+ *  Double trigger mode (ADCSR_DBLE) converts one channel, ADCSR_DBLANS, twice: the first trigger's
+ *  result goes to its ADDRn, the second's to ADDBLDR, and IRQ_ADC140_ADI comes after the second.
+ *  Here both triggers are compare match B of one GPT channel in triangle wave mode, counting up and
+ *  then down again, through ELC_AD00 - two samples a period, placed symmetrically about the top
+ *  of the count, 'skew' GPT counts apart, set by GTCCRB alone. Each pair is moved into the double
+ *  buffer of susan_ra4m1_minima_adc_stream.h, ADDBLDR up to ADDRn in one block per pair:
+ *
+ *    constexpr unsigned int sense = ra4m1::adc_pin(A0);
+ *    alignas(4) static unsigned short buf[ra4m1::adc_pair_words(sense, sense, 200)];
+ *    ra4m1::adc_pair_begin(sense, sense, buf, 200, 4, 10000, 48);  // GPT164, 10 kHz pairs, 48 counts apart
+ *    ...
+ *    if(const ra4m1::AdcBlock *b = ra4m1::adc_stream_get()) {
+ *      for(unsigned int f = 0; f < 200; f++) { ra4m1::adc_pair_first(b, f); ra4m1::adc_pair_second(b, f); }
+ *      ra4m1::adc_stream_release(b);
+ *    }
+ *    // ra4m1::adc_pair.skew - the counts actually between them, adc_pair_skew_ns() in time
+ *
+ *  Current and voltage on two pins: the ADC14 has one converter and double trigger mode takes one
+ *  channel, so the two can't both land in the duplexing registers. adc_pair_begin(i, v, ...) with
+ *  two channels runs a single scan of both on each GPT period instead (susan_ra4m1_minima_adc_timed.h),
+ *  converted back to back - the skew is one conversion, sampling plus conversion states of the
+ *  later channel, about a microsecond: 0.02 degrees at 50 Hz, below the ADC's own error, so the
+ *  pair counts as time aligned. adc_pair_first() / _second() read them the same way.
+ *
+ *  Power, once per block - the two sequences as current and voltage, their DC parts taken off:
+ *
+ *    ra4m1::AdcPower pw = ra4m1::adc_power_block(b, amps_per_lsb, volts_per_lsb);
+ *    // pw.p - mean of the instantaneous i * v, pw.irms / pw.vrms, pw.va, pw.pf, pw.i_dc / pw.v_dc
+ *    float inst[200];
+ *    ra4m1::adc_power_block(b, amps_per_lsb, volts_per_lsb, inst);  // Instantaneous power too
+ *
+ *  The sums are 64 bit integers, n * sum(x^2) - sum(x)^2, so nothing cancels in the float.
+ *
+ *  Note: The GPT channel, ELC_ELSR08 and ADSTRGR are taken until adc_pair_end(), as for
+ *        adc_timed_begin(); the skew is even, 2 - 2 * GTPR - 2 counts, and the first sample is
+ *        the one counting up. RMS and power are only exact over whole cycles of the signal - make
+ *        frames / hz a whole number of mains periods, 200 pairs at 10 kHz for 50 Hz. Double
+ *        trigger pairs move ADDBLDR up to ADDRn, n + 5 words a pair, for any mover. A double
+ *        trigger pair is fixed until adc_pair_end() - adc_timed_rate() and adc_timed_phase()
+ *        return false on its triangle wave, so call adc_pair_begin() again for another rate
+ *        or skew. A two channel pair is a timed scan, and both work on it as usual.
+ *
+ *  With RA4M1_HOST_SIM, SimAdcTimer counts triangle wave periods, two compare B triggers each,
+ *  and SimAdc fills ADDRn and ADDBLDR by turns with DBLE set - SimAdcTimer::at is each trigger's
+ *  time in GPT counts for the input function.
+ *
+ * This code is "AS IS" without warranty or liability.
+ * GPL v3 or later - see susan_ra4m1_minima_register_defines.h
+*/
+
+#ifndef SUSAN_RA4M1_MINIMA_ADC_PAIR_H
+#define SUSAN_RA4M1_MINIMA_ADC_PAIR_H
+
+#include "susan_ra4m1_minima_adc_timed.h"
+
+namespace ra4m1 {
+
+constexpr unsigned int ADC_DBLDR = 0xC018;  // ADDBLDR, off ADCBASE - the word below ADTSDR
+
+// A double trigger pair of one ANn channel bit - ADDBLDR up to its ADDRn
+constexpr unsigned int adc_pair_span(unsigned int channel) { return adc_first(channel) + 2; }
+
+// Both halves and the DTC record, in 16 bit words
+constexpr unsigned int adc_pair_words(unsigned int first, unsigned int second, unsigned int frames) {
+  return first == second ? 2 * frames * adc_pair_span(first) + sizeof(DtcInfo) / 2 : adc_stream_words(first | second, frames);
+}
+
+struct AdcPair {
+  bool running;
+  bool dbl;                    // Double trigger - one channel
+  unsigned int first_word;     // In a frame
+  unsigned int second_word;
+  unsigned int skew;           // GPT counts first to second, double trigger
+};
+
+inline AdcPair adc_pair = {};
+
+
+// ==== Pairs ====
+
+inline void adc_pair_end() {
+  if(!adc_pair.running) return;
+  adc_timed_end();
+  adc_pair.running = false;
+}
+
+// Pairs of 'first' and 'second' at 'hz' from GPT channel 'unit' - one channel twice, 'skew' GPT
+// counts apart, by double trigger, or two channels in one scan. False when the channels, rate or
+// skew will not do, or as adc_stream_open()
+inline bool adc_pair_begin(unsigned int first, unsigned int second, unsigned short *buffer, unsigned int frames, unsigned int unit,
+                           unsigned long hz, unsigned int skew = 0, AdcMover mover = ADC_MOVE_DTC, unsigned int priority = 2) {
+  adc_pair_end();
+  adc_timed_end();
+  AdcPair &p = adc_pair;
+  if(unit >= GPT_UNITS || !hz || !first || !second || (first & (first - 1)) || (second & (second - 1))) return false;
+  if(first != second) {
+    if(!adc_timed_begin(first | second, buffer, frames, unit, hz, mover, priority)) return false;
+    p = AdcPair{true, false, (unsigned int)adc_index(first | second, first), (unsigned int)adc_index(first | second, second), 0};
+    return true;
+  }
+
+  unsigned int bit = adc_first(first);
+  if(!adc_channels_ok(first) || (first & (ADC_TEMP | ADC_VREF))) return false;
+  GptPeriod g = gpt_period(clock_pclkd_now(), 2 * hz, unit < 2);  // Half a period per GTPR
+  unsigned int top = g.gtpr + 1;
+  if(!g.ok || (unit >= 2 && top > 0xFFFF) || !top) return false;
+  skew &= ~1u;
+  if(skew < 2 || skew > 2 * (top - 1)) return false;
+  if(!adc_stream_open_at(first, ADCBASE + ADC_DBLDR, adc_pair_span(first), buffer, frames, mover, priority)) return false;
+
+  adc_timed_gpt(unit, g);
+  unsigned int b = gpt_base(unit);
+  mmio_write<unsigned int>(b + GTPR, top);
+  mmio_write<unsigned int>(b + GTPBR, top);
+  mmio_write<unsigned int>(b + GTCCRB, top - skew / 2);
+  mmio_write(ADC140_ADSTRGR, (unsigned short)((ADC_TRS_ELC_AD00 << ADSTRGR_TRSA_5_0) | (ADC_TRS_NONE << ADSTRGR_TRSB_5_0)));
+  mmio_write(ADC140_ADCSR, (unsigned short)((ADC_ADCS_SINGLE << ADCSR_ADCS_1_0) | ((bit - 3) << ADCSR_DBLANS_4_0) | (1u << ADCSR_DBLE) |
+                                            (1u << ADCSR_ADIE) | (1u << ADCSR_TRGE)));
+  adc_timed.event = gpt_event(unit, IRQ_GPT0_CCMPB);
+  adc_timed.triangle = true;
+  elc_begin();
+  mmio_write(ELC_ELSR08, (unsigned short)adc_timed.event);
+  mmio_write<unsigned int>(b + GTCR, (GPT_MD_TRIANGLE << GTCR_MD_2_0) | (g.tpcs << GTCR_TPCS_2_0) | (1u << GTCR_CST));
+  p = AdcPair{true, true, adc_pair_span(first) - 1, 0, skew};
+  return true;
+}
+
+inline unsigned long adc_pair_skew_ns() {
+  unsigned long hz = adc_timed_count_hz();
+  return hz ? (unsigned long)(adc_pair.skew * 1000000000ULL / hz) : 0;
+}
+
+inline unsigned short adc_pair_first(const AdcBlock *b, unsigned int frame) { return b->data[frame * adc_stream.span + adc_pair.first_word]; }
+inline unsigned short adc_pair_second(const AdcBlock *b, unsigned int frame) { return b->data[frame * adc_stream.span + adc_pair.second_word]; }
+
+
+// ==== Power ====
+
+struct AdcPower {
+  unsigned int samples;
+  float i_dc;     // Means, LSB
+  float v_dc;
+  float irms;     // AC parts, scaled
+  float vrms;
+  float p;        // Mean of the instantaneous power
+  float va;       // irms * vrms
+  float pf;       // p / va, 0 with no va
+};
+
+// A block of pairs, first as current and second as voltage - 'inst', when given, gets each
+// pair's instantaneous power, DC parts off, one float a frame
+inline AdcPower adc_power_block(const AdcBlock *b, float amps_per_lsb, float volts_per_lsb, float *inst = nullptr) {
+  AdcPower pw = {};
+  unsigned int frames = adc_stream.frames;
+  long long n = frames, si = 0, sv = 0, sii = 0, svv = 0, siv = 0;
+  for(unsigned int f = 0; f < frames; f++) {
+    long long i = adc_pair_first(b, f), v = adc_pair_second(b, f);
+    si += i;
+    sv += v;
+    sii += i * i;
+    svv += v * v;
+    siv += i * v;
+  }
+  if(!n) return pw;
+  double nn = (double)n * (double)n;
+  pw.samples = frames;
+  pw.i_dc = (float)((double)si / n);
+  pw.v_dc = (float)((double)sv / n);
+  pw.irms = (float)(__builtin_sqrt((double)(n * sii - si * si) / nn) * amps_per_lsb);
+  pw.vrms = (float)(__builtin_sqrt((double)(n * svv - sv * sv) / nn) * volts_per_lsb);
+  pw.p = (float)((double)(n * siv - si * sv) / nn * amps_per_lsb * volts_per_lsb);
+  pw.va = pw.irms * pw.vrms;
+  pw.pf = pw.va > 0 ? pw.p / pw.va : 0;
+  if(inst) {
+    float s = amps_per_lsb * volts_per_lsb;
+    for(unsigned int f = 0; f < frames; f++) inst[f] = (adc_pair_first(b, f) - pw.i_dc) * (adc_pair_second(b, f) - pw.v_dc) * s;
+  }
+  return pw;
+}
+
+}  // namespace ra4m1
+
+#endif  // SUSAN_RA4M1_MINIMA_ADC_PAIR_H
@@ -0,0 +1,167 @@
+/*  Arduino UNO R4 Minima - group A / B ADC scan scheduling for the RA4M1 register defines:
+ *
+ *  The ADC14's group scan mode has two channel sets. Here group A is the timed one - a scan on
+ *  every period of a GPT channel, through the ELC as in susan_ra4m1_minima_adc_timed.h - and
+ *  group B is background, scanning over and over whenever A is not (ADGSPCR_GBRP). A trigger for
+ *  A during a B scan stops B, runs A, and restarts B from its first channel (ADGSPCR_PGS,
+ *  GBRSCN), so A's sample instants stay on the timer edge whatever B is doing. Each group has its
+ *  own double buffer and end interrupt, IRQ_ADC140_ADI and IRQ_ADC140_GBADI:
+ *
+ *    constexpr unsigned int fast = ra4m1::adc_pin(A0) | ra4m1::adc_pin(A1);
+ *    constexpr unsigned int slow = ra4m1::adc_pin(A2) | ra4m1::ADC_TEMP | ra4m1::ADC_VREF;
+ *    alignas(4) static unsigned short a_buf[ra4m1::adc_stream_words(fast, 128)];
+ *    static unsigned short b_buf[ra4m1::adc_stream_words(slow, 8)];
+ *
+ *    ra4m1::adc_sched_begin({fast, a_buf, 128, ra4m1::ADC_MOVE_DTC}, {slow, b_buf, 8}, 4, 20000);
+ *    ...
+ *    if(const ra4m1::AdcBlock *b = ra4m1::adc_stream_get(ra4m1::ADC_GROUP_A)) { ... release ... }
+ *    if(const ra4m1::AdcBlock *b = ra4m1::adc_stream_get(ra4m1::ADC_GROUP_B)) { ... release ... }
+ *
+ *    ra4m1::AdcSchedStats st = ra4m1::adc_sched_stats();
+ *    // st.a_hz / st.b_hz - scans per second each group got since begin / adc_sched_clear()
+ *    // st.preempted - B scans that had A come in, st.preemptions - A scans inside B scans,
+ *    // st.most - most A scans inside one B scan
+ *
+ *  Group A's mover is any of the three; group B is always moved by its handler, one priority
+ *  level below A's, which also counts the A scans since the last B scan end - with B restarting
+ *  back to back, each of those came in during the B scan that just ended and restarted it.
+ *
+ *  Note: A B scan only ends when it fits between two A triggers - when the B set takes longer
+ *        than an A period, b_hz stays 0 and st.most grows. The groups can't share a channel.
+ *        The rates come from cycles(), which wraps after 2^32 ICLK cycles - 89 s at 48 MHz - so
+ *        read them within that of adc_sched_clear(). adc_timed_rate() / _phase() work on group A.
+ *
+ *  With RA4M1_HOST_SIM, SimAdcTimer periods start A scans and SimAdc::scan(ADC_GROUP_B) runs B
+ *  scans, in whatever interleave the test wants.
+ *
+ * This code is "AS IS" without warranty or liability.
+ * GPL v3 or later - see susan_ra4m1_minima_register_defines.h
+*/
+
+#ifndef SUSAN_RA4M1_MINIMA_ADC_SCHED_H
+#define SUSAN_RA4M1_MINIMA_ADC_SCHED_H
+
+#include "susan_ra4m1_minima_adc_timed.h"
+
+namespace ra4m1 {
+
+struct AdcSchedGroup {
+  unsigned int channels;
+  unsigned short *buffer;        // adc_stream_words(channels, frames)
+  unsigned int frames;           // Scans per half
+  AdcMover mover = ADC_MOVE_DTC; // Group A only - B is always ADC_MOVE_ISR
+};
+
+struct AdcSchedStats {
+  unsigned int cycles;           // Window, since begin / adc_sched_clear()
+  unsigned int a_scans;
+  unsigned int b_scans;
+  unsigned long a_hz;
+  unsigned long b_hz;
+  unsigned int preempted;        // B scans with at least one A scan inside
+  unsigned int preemptions;      // A scans inside B scans
+  unsigned int most;             // Most A scans inside one B scan
+};
+
+struct AdcSched {
+  bool running;
+  unsigned int start;            // cycles() at begin / clear
+  unsigned int a_base;           // adc_stream_scans() at begin / clear
+  unsigned int b_base;
+  volatile unsigned int a_seen;  // Group A scans at the last B scan end
+  volatile unsigned int preempted;
+  volatile unsigned int preemptions;
+  volatile unsigned int most;
+};
+
+inline AdcSched adc_sched = {};
+
+
+// ==== Bookkeeping ====
+
+// Group B's on_scan, after each B scan is moved
+inline void adc_sched_b_scan() {
+  AdcSched &s = adc_sched;
+  unsigned int a = adc_stream_scans(adc_streams[ADC_GROUP_A]);
+  unsigned int n = a - s.a_seen;
+  s.a_seen = a;
+  if(!n) return;
+  s.preempted = s.preempted + 1;
+  s.preemptions = s.preemptions + n;
+  if(n > s.most) s.most = n;
+}
+
+inline void adc_sched_clear() {
+  AdcSched &s = adc_sched;
+  unsigned int primask = irq_save();
+  s.start = cycles();
+  s.a_base = s.a_seen = adc_stream_scans(adc_streams[ADC_GROUP_A]);
+  s.b_base = adc_stream_scans(adc_streams[ADC_GROUP_B]);
+  s.preempted = s.preemptions = s.most = 0;
+  irq_restore(primask);
+}
+
+inline AdcSchedStats adc_sched_stats() {
+  AdcSched &s = adc_sched;
+  AdcSchedStats st = {};
+  if(!s.running) return st;
+  unsigned int primask = irq_save();
+  st.cycles = cycles() - s.start;
+  st.a_scans = adc_stream_scans(adc_streams[ADC_GROUP_A]) - s.a_base;
+  st.b_scans = adc_stream_scans(adc_streams[ADC_GROUP_B]) - s.b_base;
+  st.preempted = s.preempted;
+  st.preemptions = s.preemptions;
+  st.most = s.most;
+  irq_restore(primask);
+  if(st.cycles) {
+    unsigned long long iclk = clock_iclk_now();
+    st.a_hz = (unsigned long)(st.a_scans * iclk / st.cycles);
+    st.b_hz = (unsigned long)(st.b_scans * iclk / st.cycles);
+  }
+  return st;
+}
+
+
+// ==== Scheduler ====
+
+inline void adc_sched_end() {
+  AdcSched &s = adc_sched;
+  if(!s.running) return;
+  adc_timed_end();
+  adc_stream_stop(ADC_GROUP_B);
+  mmio_write(ADC140_ADGSPCR, (unsigned short)0);
+  adc_select(0, ADC_GROUP_B);
+  s.running = false;
+}
+
+// Group A on every period of GPT channel 'unit' at 'hz', group B in between - false when the
+// groups share a channel, the rate does not fit the channel, or as adc_stream_open()
+inline bool adc_sched_begin(const AdcSchedGroup &a, const AdcSchedGroup &b, unsigned int unit, unsigned long hz,
+                            unsigned int priority = 2) {
+  adc_sched_end();
+  adc_timed_end();
+  if(unit >= GPT_UNITS || !hz || (a.channels & b.channels) || priority >= 15) return false;
+  GptPeriod g = gpt_period(clock_pclkd_now(), hz, unit < 2);
+  if(!g.ok) return false;
+  if(!adc_stream_open(b.channels, b.buffer, b.frames, ADC_MOVE_ISR, priority + 1, ADC_GROUP_B)) return false;
+  adc_streams[ADC_GROUP_B].on_scan = adc_sched_b_scan;
+  if(!adc_stream_open(a.channels, a.buffer, a.frames, a.mover, priority, ADC_GROUP_A)) {
+    adc_stream_stop(ADC_GROUP_B);
+    return false;
+  }
+
+  adc_timed_gpt(unit, g);
+  mmio_write(ADC140_ADSTRGR, (unsigned short)((ADC_TRS_ELC_AD00 << ADSTRGR_TRSA_5_0) | (ADC_TRS_NONE << ADSTRGR_TRSB_5_0)));
+  constexpr unsigned short csr = (ADC_ADCS_GROUP << ADCSR_ADCS_1_0) | (1u << ADCSR_ADIE) | (1u << ADCSR_GBADIE);
+  mmio_write(ADC140_ADCSR, csr);  // Group scan mode before PGS
+  mmio_write(ADC140_ADGSPCR, (unsigned short)((1u << ADGSPCR_PGS) | (1u << ADGSPCR_GBRSCN) | (1u << ADGSPCR_GBRP)));
+  mmio_write(ADC140_ADCSR, (unsigned short)(csr | (1u << ADCSR_TRGE)));
+  adc_sched.running = true;
+  adc_sched_clear();
+  adc_timed_go();
+  return true;
+}
+
+}  // namespace ra4m1
+
+#endif  // SUSAN_RA4M1_MINIMA_ADC_SCHED_H
@@ -0,0 +1,281 @@
+/*  Arduino UNO R4 Minima - per channel ADC sampling time tuning for the RA4M1 register defines:
+ *
+ *  Each ANn has its own sampling time, ADSSTR00 - 14 (AN16 - AN25 share ADSSTRL), in ADCLK
+ *  states, 13 after reset. A low impedance source settles in far fewer; a high impedance one,
+ *  a divider or a sensor with no buffer, needs more than 13. Here each channel is swept and the
+ *  fewest states that settle inside a tolerance are kept, plus a margin - so every channel gets
+ *  what it needs and no more, and the scan is as short as the sources allow:
+ *
+ *    constexpr unsigned int chans = ra4m1::adc_pin(A0) | ra4m1::adc_pin(A1) | ra4m1::adc_pin(A4);
+ *    ra4m1::AdcSstrResult r = ra4m1::adc_sstr_tune(chans);     // ADC stopped, inputs steady
+ *    // r.table.states[n] - ADSSTRn now, r.settled[n] - fewest states inside the tolerance,
+ *    // r.failed - channels not settled at 255, r.before_hz / r.after_hz - single scans per second
+ *    EEPROM.put(0, r.table);                                    // The core's data flash EEPROM
+ *    ...
+ *    ra4m1::AdcSstrTable t;
+ *    EEPROM.get(0, t);
+ *    if(!ra4m1::adc_sstr_apply(t)) ...                          // Not a table - tune again
+ *
+ *  Settling is measured the way a scan stresses it. The sampling capacitor holds the previous
+ *  channel's voltage, anywhere from VREFL to VREFH; the disconnection detection assist (ADDISCR)
+ *  precharges it to VREFH, or discharges it to VREFL, before each sampling, the worst case on
+ *  purpose. The reference is the sum of 'repeats' conversions at 255 states; then at each setting
+ *  the same count from the rail further from the input. What is left of the step, scaled up to a
+ *  full scale step, has to be within tol_lsb. The error only falls with more states, so it is a
+ *  binary search, 8 settings a channel.
+ *
+ *  Note: Channels on ADSSTRL get the most any of them needs. ADC_TEMP and ADC_VREF are left as
+ *        they are - their sampling time is a datasheet minimum for the sensor and the reference,
+ *        not a board's settling. The inputs have to hold still through the tuning, and noise
+ *        counts as settling error - more repeats for a noisy input. ADCER's resolution is used,
+ *        flush right. ADANSA, ADADS, ADCSR and ADDISCR are put back after.
+ *        The table is ADSSTR values only, sealed with a check - it follows the board and its
+ *        sources, not the clock: states are ADCLK states, so tune again after a PCLKC change.
+ *
+ *  With RA4M1_HOST_SIM, ra4m1::SimAdcSettle gives each channel a level and an RC time constant in
+ *  ADCLK states, runs single scans on the ADST write, and moves cycles() on by each conversion's
+ *  states, so the sweep and the throughput figures can be checked on Linux.
+ *
+ * This code is "AS IS" without warranty or liability.
+ * GPL v3 or later - see susan_ra4m1_minima_register_defines.h
+*/
+
+#ifndef SUSAN_RA4M1_MINIMA_ADC_SSTR_H
+#define SUSAN_RA4M1_MINIMA_ADC_SSTR_H
+
+#include "susan_ra4m1_minima_adc_stream.h"
+#include "susan_ra4m1_minima_clocks.h"
+
+namespace ra4m1 {
+
+// ==== Sampling state registers ====
+// ADSSTR00 - 14, then ADSSTRL for AN16 - AN25
+
+constexpr unsigned int ADC_SSTR_REGS = 16;
+constexpr unsigned int ADC_SSTR_L = 15;
+constexpr unsigned int ADC_SSTR_NONE = 0xFF;
+constexpr unsigned int ADC_SSTR_TUNABLE = (0x7FFFu << 3) | (0x3FFu << 19);
+constexpr unsigned int ADC_SSTR_MAGIC = 0x53535452;  // "SSTR"
+
+// Register index of a channel bit, ADC_SSTR_NONE for ADC_TEMP / ADC_VREF / ADRD
+constexpr unsigned int adc_sstr_reg(unsigned int bit) {
+  return bit >= 3 && bit <= 17 ? bit - 3 : bit >= 19 && bit <= 28 ? ADC_SSTR_L : ADC_SSTR_NONE;
+}
+
+inline unsigned int adc_sstr_addr(unsigned int reg) { return reg == ADC_SSTR_L ? phys(ADC140_ADSSTRL) : phys(ADC140_ADSSTR00) + reg; }
+
+
+// ==== Table ====
+
+struct AdcSstrTable {
+  unsigned int magic;
+  unsigned int channels;                 // The ones tuned
+  unsigned char states[ADC_SSTR_REGS];
+  unsigned int check;
+};
+
+constexpr unsigned int adc_sstr_check(const AdcSstrTable &t) {
+  unsigned int h = 2166136261u ^ t.magic;  // FNV-1a
+  for(unsigned int i = 0; i < 4; i++) h = (h ^ ((t.channels >> (i * 8)) & 0xFF)) * 16777619u;
+  for(unsigned int i = 0; i < ADC_SSTR_REGS; i++) h = (h ^ t.states[i]) * 16777619u;
+  return h;
+}
+
+constexpr bool adc_sstr_valid(const AdcSstrTable &t) {
+  if(t.magic != ADC_SSTR_MAGIC || t.check != adc_sstr_check(t)) return false;
+  for(unsigned int i = 0; i < ADC_SSTR_REGS; i++)
+    if(t.states[i] < ADC_SSTR_MIN) return false;
+  return true;
+}
+
+// The registers as they are now, no channels tuned
+inline AdcSstrTable adc_sstr_read() {
+  AdcSstrTable t = {};
+  t.magic = ADC_SSTR_MAGIC;
+  for(unsigned int i = 0; i < ADC_SSTR_REGS; i++) t.states[i] = mmio_read<unsigned char>(adc_sstr_addr(i));
+  t.check = adc_sstr_check(t);
+  return t;
+}
+
+// Into ADSSTR00 - 14 / L - false, and nothing written, when 't' is not a sealed table
+inline bool adc_sstr_apply(const AdcSstrTable &t) {
+  if(!adc_sstr_valid(t)) return false;
+  mmio_write(MSTP_MSTPCRD, mmio_read(MSTP_MSTPCRD) & ~(1u << MSTPD16));
+  for(unsigned int i = 0; i < ADC_SSTR_REGS; i++) mmio_write<unsigned char>(adc_sstr_addr(i), t.states[i]);
+  return true;
+}
+
+
+// ==== Measuring ====
+
+// One single scan of group A - ADC idle, ADCSR single scan mode. ICLK cycles, ADST to its end
+inline unsigned int adc_sstr_scan_cycles() {
+  unsigned short csr = mmio_read(ADC140_ADCSR);
+  unsigned int t0 = cycles();
+  mmio_write(ADC140_ADCSR, (unsigned short)(csr | (1u << ADCSR_ADST)));
+  while(mmio_read(ADC140_ADCSR) & (1u << ADCSR_ADST)) {}
+  return cycles() - t0;
+}
+
+// Sum of 'n' single scan results of one channel bit, the only one in group A
+inline unsigned int adc_sstr_sum(unsigned int bit, unsigned int n) {
+  unsigned int sum = 0;
+  for(unsigned int i = 0; i < n; i++) {
+    adc_sstr_scan_cycles();
+    sum += mmio_read<unsigned short>(adc_result_addr(bit));
+  }
+  return sum;
+}
+
+
+// ==== Tuning ====
+
+struct AdcSstrOptions {
+  unsigned int repeats = 16;     // Conversions per measurement
+  unsigned int tol_lsb = 1;      // Settling error allowed, scaled to a full scale step
+  unsigned int margin_pct = 25;  // Added to the fewest states that settle, at least 1
+};
+
+struct AdcSstrResult {
+  AdcSstrTable table;                    // Sealed, and in the registers
+  unsigned char settled[ADC_SSTR_REGS];  // Fewest states inside tol_lsb, 0 for registers not tuned
+  unsigned int failed;                   // Channels outside tol_lsb even at 255 - left at 255
+  unsigned int before;                   // ICLK cycles for a single scan of the channels, old table
+  unsigned int after;                    // and new
+  unsigned long before_hz;
+  unsigned long after_hz;
+};
+
+// Fewest states for one channel bit to settle - 0 when 255 does not
+inline unsigned int adc_sstr_settle(unsigned int bit, const AdcSstrOptions &opt) {
+  unsigned int n = opt.repeats ? opt.repeats : 1;
+  unsigned int fs = ((mmio_read(ADC140_ADCER) >> ADCER_ADPCR_1_0) & 3) == ADC_ADPCR_14BIT ? 16383 : 4095;
+  unsigned int addr = adc_sstr_addr(adc_sstr_reg(bit));
+  mmio_write(ADC140_ADDISCR, (unsigned char)ADC_NDIS_OFF);
+  mmio_write<unsigned char>(addr, 255);
+  unsigned int ref = adc_sstr_sum(bit, n);
+
+  bool pchg = ref < n * fs / 2;  // Start from the rail further away
+  unsigned long long dist = pchg ? n * fs - ref : ref;
+  mmio_write(ADC140_ADDISCR, (unsigned char)((pchg ? 1u << ADDISCR_PCHG : 0) | (ADC_NDIS_MAX << ADDISCR_ADNDIS_3_0)));
+  auto settles = [&](unsigned int states) {
+    mmio_write<unsigned char>(addr, (unsigned char)states);
+    unsigned int sum = adc_sstr_sum(bit, n);
+    unsigned long long err = sum > ref ? sum - ref : ref - sum;
+    return err * fs <= (unsigned long long)opt.tol_lsb * dist;  // err * (n * fs / dist) <= tol * n
+  };
+  unsigned int lo = ADC_SSTR_MIN, hi = 255;
+  if(!settles(hi)) lo = hi = 0;
+  while(lo < hi) {
+    unsigned int mid = (lo + hi) / 2;
+    if(settles(mid)) hi = mid;
+    else lo = mid + 1;
+  }
+  mmio_write(ADC140_ADDISCR, (unsigned char)ADC_NDIS_OFF);
+  return lo;
+}
+
+// Sweep each ANn in 'channels' and write the fewest states that settle, plus the margin -
+// ADC stopped (ADCSR_ADST 0), inputs steady
+inline AdcSstrResult adc_sstr_tune(unsigned int channels, const AdcSstrOptions &opt = AdcSstrOptions()) {
+  AdcSstrResult r = {};
+  r.table = adc_sstr_read();
+  channels &= ADC_SSTR_TUNABLE & ADC_ON_PACKAGE;
+  if(!channels) return r;
+
+  unsigned short csr = mmio_read(ADC140_ADCSR), ads0 = mmio_read(ADC140_ADADS0), ads1 = mmio_read(ADC140_ADADS1);
+  unsigned char discr = mmio_read(ADC140_ADDISCR);
+  unsigned int sel = adc_selected(ADC_GROUP_A), ex = mmio_read(ADC140_ADEXICR);
+  cycles_enable();
+  adc_select(channels);
+  mmio_write(ADC140_ADCSR, (unsigned short)(ADC_ADCS_SINGLE << ADCSR_ADCS_1_0));  // No ADIE - polled
+  mmio_write(ADC140_ADADS0, (unsigned short)0);
+  mmio_write(ADC140_ADADS1, (unsigned short)0);
+  mmio_write(ADC140_ADEXICR, (unsigned short)(ex & ~((1u << ADEXICR_TSSAD) | (1u << ADEXICR_OCSAD))));
+  r.before = adc_sstr_scan_cycles();
+
+  for(unsigned int bit = 0; bit < 32; bit++) {
+    if(!((channels >> bit) & 1)) continue;
+    adc_select(1u << bit);
+    unsigned int s = adc_sstr_settle(bit, opt), reg = adc_sstr_reg(bit);
+    if(!s) {
+      r.failed |= 1u << bit;
+      s = 255;
+    }
+    if(s > r.settled[reg]) r.settled[reg] = (unsigned char)s;
+  }
+  for(unsigned int i = 0; i < ADC_SSTR_REGS; i++) {
+    if(!r.settled[i]) continue;
+    unsigned int add = (r.settled[i] * opt.margin_pct + 99) / 100;
+    unsigned int s = r.settled[i] + (add ? add : 1);
+    r.table.states[i] = (unsigned char)(s > 255 ? 255 : s);
+  }
+  r.table.channels |= channels;
+  r.table.check = adc_sstr_check(r.table);
+  adc_sstr_apply(r.table);
+
+  adc_select(channels);
+  r.after = adc_sstr_scan_cycles();
+  mmio_write(ADC140_ADADS0, ads0);
+  mmio_write(ADC140_ADADS1, ads1);
+  mmio_write(ADC140_ADDISCR, discr);
+  adc_select(sel);
+  mmio_write(ADC140_ADEXICR, (unsigned short)ex);
+  mmio_write(ADC140_ADCSR, (unsigned short)(csr & ~(1u << ADCSR_ADST)));
+
+  unsigned long long iclk = clock_iclk_now();
+  r.before_hz = r.before ? (unsigned long)(iclk / r.before) : 0;
+  r.after_hz = r.after ? (unsigned long)(iclk / r.after) : 0;
+  return r;
+}
+
+
+#ifdef RA4M1_HOST_SIM
+// ==== Simulated sampling ====
+// Each channel an ideal source 'level' (codes) behind an RC of 'tau' ADCLK states. The capacitor
+// starts each sampling where the last conversion left it, or at VREFH / VREFL with ADDISCR on, and
+// gets (start - level) * exp(-states / tau) of the way off. A write of ADCSR with ADST runs the
+// scan at once and moves cycles() on by the ADDISCR + sampling + conversion states of each channel.
+//
+//   ra4m1::sim_reset();
+//   ra4m1::SimAdc adc;
+//   ra4m1::SimAdcSettle rc;  rc.attach(adc);
+//   rc.level[3] = 2000;  rc.tau[3] = 4.0f;                     // AN00, a low impedance source
+//   ra4m1::AdcSstrResult r = ra4m1::adc_sstr_tune(ra4m1::adc_an(0));
+
+struct SimAdcSettle {
+  float level[32] = {};
+  float tau[32] = {};            // 0 - settles at once
+  float cap = 0;                 // Sampling capacitor, codes
+  unsigned int conv_states = 30;
+  unsigned int iclk_per_adclk = 1;
+  unsigned int conversions = 0;
+
+  void attach(SimAdc &adc) {
+    adc.input = [this](unsigned int bit, unsigned int) { return convert(bit); };
+    sim_on_write(phys(ADC140_ADCSR), [&adc](unsigned int a, unsigned int v) {
+      sim_poke<unsigned short>(a, (unsigned short)v);
+      adc.scan();
+      return (unsigned int)sim_peek<unsigned short>(a);
+    });
+  }
+
+  unsigned short convert(unsigned int bit) {
+    unsigned int reg = adc_sstr_reg(bit);
+    unsigned int states = reg == ADC_SSTR_NONE ? sim_peek<unsigned char>(phys(bit ? ADC140_ADSSTRO : ADC140_ADSSTRT))
+                                               : sim_peek<unsigned char>(adc_sstr_addr(reg));
+    unsigned int discr = sim_peek<unsigned char>(phys(ADC140_ADDISCR)), ndis = (discr >> ADDISCR_ADNDIS_3_0) & 0xF;
+    float fs = ((sim_peek<unsigned short>(phys(ADC140_ADCER)) >> ADCER_ADPCR_1_0) & 3) == ADC_ADPCR_14BIT ? 16383 : 4095;
+    if(ndis) cap = (discr >> ADDISCR_PCHG) & 1 ? fs : 0;
+    cap = tau[bit] > 0 ? level[bit] + (cap - level[bit]) * (float)__builtin_exp(-(double)states / tau[bit]) : level[bit];
+    sim_cycle_count += (unsigned long long)(ndis + states + conv_states) * iclk_per_adclk;
+    conversions++;
+    float v = cap + 0.5f;
+    return (unsigned short)(v < 0 ? 0 : v > fs ? fs : v);
+  }
+};
+#endif
+
+}  // namespace ra4m1
+
+#endif  // SUSAN_RA4M1_MINIMA_ADC_SSTR_H
@@ -0,0 +1,423 @@
+/*  Arduino UNO R4 Minima - continuous ADC scan streaming for the RA4M1 register defines:
+ *
+ *  The ADC14 in continuous scan mode starts the next scan as each one ends, at its own pace, with
+ *  IRQ_ADC140_ADI at every scan end. Here each scan's results are moved out of the result registers
+ *  into one half of a double buffer, by an interrupt handler, a DMAC channel or a DTC slot; when a
+ *  half is full it is handed to the sketch as a block, and the other half is filled meanwhile:
+ *
+ *    constexpr unsigned int chans = ra4m1::adc_pin(A0) | ra4m1::adc_pin(A1) | ra4m1::ADC_TEMP;
+ *    static_assert(ra4m1::adc_channels_ok(chans), "");
+ *    alignas(4) static unsigned short buf[ra4m1::adc_stream_words(chans, 64)];    // 2 x 64 scans
+ *
+ *    ra4m1::adc_stream_begin(chans, buf, 64, ra4m1::ADC_MOVE_DTC);               // false: no slot / channel
+ *    ...
+ *    if(const ra4m1::AdcBlock *b = ra4m1::adc_stream_get()) {
+ *      for(unsigned int f = 0; f < 64; f++) sum += ra4m1::adc_stream_at(b, f, ra4m1::adc_pin(A0));
+ *      ra4m1::adc_stream_release(b);                                             // Half free to fill again
+ *    }
+ *
+ *  Channels are one bit per result register, counted from ADTSDR: ADC_TEMP (ADTSDR), ADC_VREF
+ *  (ADOCDR), then adc_an(n) for ANn - adc_pin() gives it for an Arduino pin. The result registers
+ *  are at consecutive addresses in that order, so one scan is moved as one block of 16 bit words,
+ *  the lowest selected register to the highest - adc_span() words, the ones in between unselected
+ *  come along too. adc_stream_index() / adc_stream_at() find a channel in it.
+ *
+ *  Movers:
+ *    ADC_MOVE_ISR   a handler per scan copies the span - no DMAC channel or DTC needed
+ *    ADC_MOVE_DMAC  a DMAC block transfer per scan; the channel's end interrupt swaps halves
+ *    ADC_MOVE_DTC   a DTC block transfer per scan; the slot's end interrupt swaps halves
+ *  With DMAC and DTC the CPU only runs once per half. The buffer is adc_stream_words() long, both
+ *  halves and, at the end, the DTC's transfer record - 4 byte aligned for the DTC.
+ *
+ *  The sketch has the time to fill one half to work on the other and release it. Each block has a
+ *  sequence number and cycles() when its last scan was moved. When a half is due to be filled
+ *  again and has not been released, adc_stream.overruns counts one and the half is taken back -
+ *  its seq never comes out of adc_stream_get(), and the data under a pointer still held changes.
+ *
+ *  Group B: adc_stream_open(..., ADC_GROUP_B) sets up a second stream, adc_streams[1], on the
+ *  group B channels (ADANSB) and IRQ_ADC140_GBADI, for group scan mode - see
+ *  susan_ra4m1_minima_adc_sched.h. adc_stream is adc_streams[0], group A; the group argument
+ *  of adc_stream_get() etc. defaults to it.
+ *
+ *  Note: The swap runs in an interrupt at 'priority'; it has to be done within one scan, or the
+ *        scan is lost - keep the priority high and the span short at full rate. The ISR mover has
+ *        the same limit on every scan. Pins need ASEL (pmux(A0).analog() etc., or analogRead()
+ *        once); the resolution is whatever ADCER_ADPCR is - analogReadResolution() on the Arduino.
+ *        The temperature sensor wants a long sampling time in ADSSTRT.
+ *
+ *  With RA4M1_HOST_SIM, ra4m1::SimAdc runs scans in the simulated memory - the selected result
+ *  registers from a function, then IRQ_ADC140_ADI - for SimDma / SimDtc or the handler to move.
+ *
+ * This code is "AS IS" without warranty or liability.
+ * GPL v3 or later - see susan_ra4m1_minima_register_defines.h
+*/
+
+#ifndef SUSAN_RA4M1_MINIMA_ADC_STREAM_H
+#define SUSAN_RA4M1_MINIMA_ADC_STREAM_H
+
+#include "susan_ra4m1_minima_gpio.h"
+#include "susan_ra4m1_minima_dtc.h"
+#include "susan_ra4m1_minima_elc.h"
+
+namespace ra4m1 {
+
+// ==== Channels ====
+// One bit per result register, from ADTSDR up - bit 2 is ADRD, bit 18 would be AN15
+
+constexpr unsigned int ADC_RESULTS = 0xC01A;  // ADTSDR, off ADCBASE
+constexpr unsigned int ADC_TEMP = 1u << 0;
+constexpr unsigned int ADC_VREF = 1u << 1;
+
+constexpr unsigned int adc_an(unsigned int n) { return n <= 25 && n != 15 ? 1u << (n + 3) : 0; }
+
+// AN00 - AN10 and AN16 - AN22 have a pin on the Minima's 64 pin package
+constexpr unsigned int ADC_ON_PACKAGE = ADC_TEMP | ADC_VREF | (0x7FFu << 3) | (0x7Fu << 19);
+
+// ANn of an Arduino pin, 0xFF for none - P000 - P004, P010 - P015, P500 - P502, P100 - P103
+constexpr unsigned int adc_pin_an(unsigned int arduino_pin) {
+  if(arduino_pin >= GPIO_PINS) return 0xFF;
+  unsigned int port = GPIO_PIN_MAP[arduino_pin] >> 4, bit = GPIO_PIN_MAP[arduino_pin] & 0xF;
+  if(port == 0 && bit <= 4) return bit;
+  if(port == 0 && bit >= 10) return bit - 5;
+  if(port == 5 && bit <= 2) return 16 + bit;
+  if(port == 1 && bit <= 3) return 22 - bit;
+  return 0xFF;
+}
+
+constexpr unsigned int adc_pin(unsigned int arduino_pin) { return adc_pin_an(arduino_pin) == 0xFF ? 0 : adc_an(adc_pin_an(arduino_pin)); }
+
+constexpr bool adc_channels_ok(unsigned int channels) { return channels && !(channels & ~ADC_ON_PACKAGE); }
+
+constexpr unsigned int adc_first(unsigned int channels) { return channels ? __builtin_ctz(channels) : 0; }
+constexpr unsigned int adc_span(unsigned int channels) { return channels ? 32 - __builtin_clz(channels) - __builtin_ctz(channels) : 0; }
+
+// Word of a channel in one scan's span, or -1 when it is not in the set
+constexpr int adc_index(unsigned int channels, unsigned int channel) {
+  return (channels & channel) && !(channel & (channel - 1)) ? (int)(__builtin_ctz(channel) - adc_first(channels)) : -1;
+}
+
+inline unsigned int adc_result_addr(unsigned int bit) { return ADCBASE + ADC_RESULTS + bit * 2; }
+
+enum AdcGroup : unsigned char { ADC_GROUP_A = 0, ADC_GROUP_B = 1 };
+
+// Channels of a group as the ADC has them now
+inline unsigned int adc_selected(AdcGroup g = ADC_GROUP_A) {
+  unsigned int ex = mmio_read(ADC140_ADEXICR);
+  unsigned int an0 = mmio_read(g ? ADC140_ADANSB0 : ADC140_ADANSA0) & 0x7FFF, an1 = mmio_read(g ? ADC140_ADANSB1 : ADC140_ADANSA1) & 0x3FF;
+  return (an0 << 3) | (an1 << 19) | ((ex >> (g ? ADEXICR_TSSB : ADEXICR_TSSA)) & 1 ? ADC_TEMP : 0) |
+         ((ex >> (g ? ADEXICR_OCSB : ADEXICR_OCSA)) & 1 ? ADC_VREF : 0);
+}
+
+// A group's channels in - ADCSR_ADST has to be 0. The temperature sensor needs its module on too
+inline void adc_select(unsigned int channels, AdcGroup g = ADC_GROUP_A) {
+  unsigned int ts = g ? ADEXICR_TSSB : ADEXICR_TSSA, oc = g ? ADEXICR_OCSB : ADEXICR_OCSA;
+  mmio_write(MSTP_MSTPCRD, mmio_read(MSTP_MSTPCRD) & ~((1u << MSTPD16) | (channels & ADC_TEMP ? 1u << MSTPD22 : 0)));
+  mmio_write(g ? ADC140_ADANSB0 : ADC140_ADANSA0, (unsigned short)((channels >> 3) & 0x7FFF));
+  mmio_write(g ? ADC140_ADANSB1 : ADC140_ADANSA1, (unsigned short)((channels >> 19) & 0x3FF));
+  unsigned int ex = mmio_read(ADC140_ADEXICR) & ~((1u << ts) | (1u << oc));
+  mmio_write(ADC140_ADEXICR, (unsigned short)(ex | (channels & ADC_TEMP ? 1u << ts : 0) | (channels & ADC_VREF ? 1u << oc : 0)));
+}
+
+
+// ==== Stream ====
+// One per group - group A ends a scan with IRQ_ADC140_ADI, group B (group scan mode) with GBADI
+
+enum AdcMover : unsigned char { ADC_MOVE_ISR, ADC_MOVE_DMAC, ADC_MOVE_DTC };
+
+struct AdcBlock {
+  const volatile unsigned short *data;  // 'frames' scans of adc_span() words, scan after scan
+  unsigned int seq;                     // 0, 1, 2 ... - a gap is a block lost to an overrun
+  unsigned int stamp;                   // cycles() when the last scan was moved
+  AdcGroup group;
+};
+
+struct AdcStream {
+  bool running;
+  AdcMover mover;
+  AdcGroup group;
+  unsigned char event;                  // IRQ_ADC140_ADI / GBADI
+  unsigned int channels;
+  unsigned int frames;                  // Scans per half
+  unsigned int first, span;
+  unsigned int src;                     // Address of the first word moved, adc_result_addr(first)
+  unsigned short *buffer;
+  DtcInfo *dtc;
+  int slot;
+  int dma_ch;
+  IrqHandler on_scan;                   // ISR mover - called after each scan is moved
+  AdcBlock block[2];
+  volatile unsigned char ready;         // Bit per half - full, not released yet
+  volatile unsigned char filling;       // Half being written
+  volatile unsigned int frame;          // ISR mover - scans in the half so far
+  volatile unsigned int seq;
+  volatile unsigned int blocks;         // Halves filled
+  volatile unsigned int overruns;       // Halves taken back before release
+};
+
+inline AdcStream adc_streams[2] = {};
+inline AdcStream &adc_stream = adc_streams[ADC_GROUP_A];
+
+// Both halves and the DTC record, in 16 bit words
+constexpr unsigned int adc_stream_words(unsigned int channels, unsigned int frames) {
+  return 2 * frames * adc_span(channels) + sizeof(DtcInfo) / 2;
+}
+
+inline unsigned short *adc_stream_half(const AdcStream &s, unsigned int h) { return s.buffer + h * s.frames * s.span; }
+
+inline DmaTransfer adc_stream_dma(const AdcStream &s, unsigned int h) {
+  return dma_transfer(dma_addr(adc_stream_half(s, h)), s.src, 0, DMA_16)
+         .block(s.span, s.frames).area(DMA_AREA_SRC).on_event(s.event);
+}
+
+inline DtcInfo adc_stream_dtc(const AdcStream &s, unsigned int h) {
+  return dtc_transfer(dtc_addr(adc_stream_half(s, h)), s.src, 0, DMA_16).block(s.span, s.frames).area(DMA_AREA_SRC);
+}
+
+// The half just filled goes out as a block; returns the half to fill next
+inline unsigned int adc_stream_swap(AdcStream &s) {
+  unsigned int h = s.filling, next = h ^ 1;
+  s.block[h].seq = s.seq;
+  s.block[h].stamp = cycles();
+  s.seq = s.seq + 1;
+  s.blocks = s.blocks + 1;
+  if(s.ready & (1 << next)) s.overruns = s.overruns + 1;  // The unreleased block is written over
+  s.ready = (unsigned char)((s.ready | (1 << h)) & ~(1 << next));
+  s.filling = (unsigned char)next;
+  return next;
+}
+
+// Scans moved since the stream was opened, the half being filled included
+inline unsigned int adc_stream_scans(const AdcStream &s) {
+  unsigned int blocks, in_half;
+  do {  // Again if the swap came in between
+    blocks = s.blocks;
+    in_half = s.frame;
+    if(s.mover == ADC_MOVE_DMAC && s.dma_ch >= 0) in_half = s.frames - dma_blocks_remaining(s.dma_ch);
+    if(s.mover == ADC_MOVE_DTC && s.slot >= 0) in_half = s.frames - (((const volatile DtcInfo *)s.dtc)->cr & 0xFFFF);  // CRB
+  } while(blocks != s.blocks);
+  return blocks * s.frames + in_half;
+}
+
+template <unsigned int G> void adc_stream_isr() {
+  AdcStream &s = adc_streams[G];
+  irq_ack(s.slot);
+  unsigned short *to = adc_stream_half(s, s.filling) + s.frame * s.span;
+  for(unsigned int i = 0; i < s.span; i++) to[i] = mmio_read<unsigned short>(s.src + 2 * i);
+  if(++s.frame == s.frames) {
+    s.frame = 0;
+    adc_stream_swap(s);
+  }
+  if(s.on_scan) s.on_scan();
+}
+
+inline void adc_stream_dma_done(unsigned int ch, bool end, void *ctx) {
+  AdcStream &s = *(AdcStream *)ctx;
+  if(end) dma_rearm(ch, adc_stream_dma(s, adc_stream_swap(s)));
+}
+
+template <unsigned int G> void adc_stream_dtc_done() {
+  AdcStream &s = adc_streams[G];
+  *s.dtc = adc_stream_dtc(s, adc_stream_swap(s));
+  dtc_rearm(s.slot);
+}
+
+constexpr IrqHandler ADC_STREAM_ISRS[2] = {adc_stream_isr<0>, adc_stream_isr<1>};
+constexpr IrqHandler ADC_STREAM_DTC_DONE[2] = {adc_stream_dtc_done<0>, adc_stream_dtc_done<1>};
+
+// Stops the ADC - both groups - and unlinks the group's mover
+inline void adc_stream_stop(AdcGroup g = ADC_GROUP_A) {
+  AdcStream &s = adc_streams[g];
+  if(!s.running) return;
+  mmio_write(ADC140_ADCSR, (unsigned short)0);
+  while(mmio_read(ADC140_ADCSR) & (1u << ADCSR_ADST)) {}
+  if(s.dma_ch >= 0) dma_free(s.dma_ch);
+  if(s.slot >= 0) {
+    if(s.mover == ADC_MOVE_DTC) dtc_unlink(s.slot);
+    irq_free(s.slot);
+  }
+  s.dma_ch = s.slot = -1;
+  s.running = false;
+}
+
+// As adc_stream_open(), moving 'span' words from 'src' per scan in place of the channels' span
+inline bool adc_stream_open_at(unsigned int channels, unsigned int src, unsigned int span, unsigned short *buffer, unsigned int frames,
+                               AdcMover mover = ADC_MOVE_DTC, unsigned int priority = 2, AdcGroup g = ADC_GROUP_A) {
+  AdcStream &s = adc_streams[g];
+  if(s.running) adc_stream_stop(g);
+  if(!adc_channels_ok(channels) || !buffer || !frames || frames > 0xFFFF) return false;
+  if(mover == ADC_MOVE_DTC && (dtc_addr(buffer) & 3)) return false;
+  s = AdcStream{};
+  s.mover = mover;
+  s.group = g;
+  s.event = (unsigned char)(g ? IRQ_ADC140_GBADI : IRQ_ADC140_ADI);
+  s.channels = channels;
+  s.frames = frames;
+  s.first = adc_first(channels);
+  s.span = span;
+  s.src = src;
+  s.buffer = buffer;
+  s.dtc = (DtcInfo *)(buffer + 2 * frames * s.span);
+  s.slot = s.dma_ch = -1;
+  for(unsigned int h = 0; h < 2; h++) {
+    s.block[h].data = adc_stream_half(s, h);
+    s.block[h].group = g;
+  }
+  cycles_enable();
+
+  mmio_write(ADC140_ADCSR, (unsigned short)0);
+  adc_select(channels, g);
+  if(!g && !adc_streams[ADC_GROUP_B].running) adc_select(0, ADC_GROUP_B);
+
+  if(mover == ADC_MOVE_ISR) {
+    s.slot = irq_alloc(s.event, priority, ADC_STREAM_ISRS[g]);
+  } else if(mover == ADC_MOVE_DMAC) {
+    s.dma_ch = dma_alloc();
+    if(s.dma_ch >= 0) s.slot = irq_alloc_slot();
+    if(s.slot >= 0) dma_start(s.dma_ch, adc_stream_dma(s, 0), adc_stream_dma_done, &s, s.slot, priority);
+  } else {
+    s.slot = irq_alloc_slot();
+    if(s.slot >= 0) {
+      *s.dtc = adc_stream_dtc(s, 0);
+      dtc_begin();
+      dtc_link(s.slot, s.event, s.dtc, ADC_STREAM_DTC_DONE[g], priority);
+    }
+  }
+  s.running = true;
+  if(s.slot < 0) {
+    adc_stream_stop(g);
+    return false;
+  }
+  return true;
+}
+
+// Channels selected and the mover linked, the ADC stopped - for a start other than continuous
+// scan. False when the set or the buffer will not do, or there is no free slot / DMAC channel.
+// Group A clears the group B channels unless a group B stream is open.
+inline bool adc_stream_open(unsigned int channels, unsigned short *buffer, unsigned int frames,
+                            AdcMover mover = ADC_MOVE_DTC, unsigned int priority = 2, AdcGroup g = ADC_GROUP_A) {
+  return adc_stream_open_at(channels, adc_result_addr(adc_first(channels)), adc_span(channels), buffer, frames, mover, priority, g);
+}
+
+// Continuous scan of 'channels', 'frames' scans per half
+inline bool adc_stream_begin(unsigned int channels, unsigned short *buffer, unsigned int frames,
+                             AdcMover mover = ADC_MOVE_DTC, unsigned int priority = 2) {
+  if(!adc_stream_open(channels, buffer, frames, mover, priority)) return false;
+  constexpr unsigned short csr = (ADC_ADCS_CONT << ADCSR_ADCS_1_0) | (1 << ADCSR_ADIE);
+  mmio_write(ADC140_ADCSR, csr);
+  mmio_write(ADC140_ADCSR, (unsigned short)(csr | (1u << ADCSR_ADST)));
+  return true;
+}
+
+// The full block not released yet, or nullptr - never both halves, the swap takes one back
+inline const AdcBlock *adc_stream_get(AdcGroup g = ADC_GROUP_A) {
+  unsigned int r = adc_streams[g].ready;
+  return r ? &adc_streams[g].block[r >> 1] : nullptr;
+}
+
+inline void adc_stream_release(const AdcBlock *b) {
+  AdcStream &s = adc_streams[b->group];
+  unsigned int primask = irq_save();
+  s.ready = (unsigned char)(s.ready & ~(1 << (b - s.block)));
+  irq_restore(primask);
+}
+
+inline int adc_stream_index(unsigned int channel, AdcGroup g = ADC_GROUP_A) { return adc_index(adc_streams[g].channels, channel); }
+
+inline unsigned short adc_stream_at(const AdcBlock *b, unsigned int frame, unsigned int channel) {
+  return b->data[frame * adc_streams[b->group].span + adc_stream_index(channel, b->group)];
+}
+
+
+#ifdef RA4M1_HOST_SIM
+// ==== Simulated ADC14 ====
+// scan() is one group A scan while ADCSR_ADST is set: each selected result register from
+// input(channel bit, scan number) - called ADADC times and added for an ADADS channel - then
+// IRQ_ADC140_ADI when ADCSR_ADIE is set. ADST stays set in continuous scan and clears after a
+// single scan. trigger() is an ELC_AD00 / AD01 event arriving - a scan when ADCSR_TRGE is set,
+// EXTRG is 0 and ADSTRGR_TRSA takes that input.
+// scan(ADC_GROUP_B) is one group B scan in group scan mode with ADGSPCR_GBRP set, then
+// IRQ_ADC140_GBADI when ADCSR_GBADIE is set. With ADCSR_DBLE a scan is one conversion of DBLANS,
+// into its ADDRn and ADDBLDR by turns, with IRQ_ADC140_ADI after the second.
+//
+//   ra4m1::sim_reset();
+//   ra4m1::SimDtc dtc;  dtc.attach();
+//   ra4m1::SimAdc adc;  adc.input = [](unsigned int ch, unsigned int n) { return (unsigned short)(ch * 1000 + n); };
+//   ra4m1::adc_stream_begin(chans, buf, 16);
+//   adc.run(32);                   // 32 scans - both halves full
+
+struct SimAdc {
+  std::function<unsigned short(unsigned int channel, unsigned int scan)> input;
+  unsigned int scans = 0;
+  unsigned int triggers = 0;
+  unsigned int group_b = 0;      // Group B scans, also in 'scans'
+  unsigned int doubles = 0;      // Double trigger pairs done - each two conversions, also in 'scans'
+  bool second = false;           // Next double trigger conversion goes to ADDBLDR
+  std::function<void(AdcGroup)> on_scan;  // Results in, before the end interrupt - the compare unit model
+
+  // One result - ADADC addition / averaging on the channels in ADADS0 / 1 and ADEXICR_TSSAD / OCSAD
+  unsigned short convert(unsigned int bit) {
+    unsigned int adadc = sim_peek<unsigned char>(ADCBASE + 0xC00C), n = 1;
+    unsigned int ads = ((sim_peek<unsigned short>(ADCBASE + 0xC008) & 0x7FFFu) << 3) | ((sim_peek<unsigned short>(ADCBASE + 0xC00A) & 0x3FFu) << 19) |
+                       (sim_peek<unsigned short>(ADCBASE + 0xC012) & 3u);
+    if((ads >> bit) & 1) n = (adadc & 7) == ADC_AVG_16 ? 16 : (adadc & 7) + 1;
+    unsigned int sum = 0;
+    for(unsigned int i = 0; i < n; i++) sum += input ? input(bit, scans) : 0;
+    return (unsigned short)((adadc >> ADADC_AVEE) & 1 ? sum / n : sum);
+  }
+
+  void scan(AdcGroup g = ADC_GROUP_A) {
+    unsigned int csr = sim_peek<unsigned short>(ADCBASE + 0xC000);
+    if(g == ADC_GROUP_B) {
+      unsigned int gspcr = sim_peek<unsigned short>(ADCBASE + 0xC080);
+      if(((csr >> ADCSR_ADCS_1_0) & 3) != ADC_ADCS_GROUP || !((gspcr >> ADGSPCR_GBRP) & 1)) return;
+    } else if(!(csr & (1u << ADCSR_ADST))) {
+      return;
+    } else if(csr & (1u << ADCSR_DBLE)) {
+      double_trigger(csr);
+      return;
+    }
+    second = false;
+    unsigned int set = adc_selected(g);
+    for(unsigned int bit = 0; bit < 32; bit++)
+      if((set >> bit) & 1) sim_poke<unsigned short>(adc_result_addr(bit), convert(bit));
+    scans++;
+    if(on_scan) on_scan(g);
+    if(g == ADC_GROUP_B) {
+      group_b++;
+      if(csr & (1u << ADCSR_GBADIE)) sim_irq_raise(IRQ_ADC140_GBADI);
+      return;
+    }
+    if(((csr >> ADCSR_ADCS_1_0) & 3) != ADC_ADCS_CONT) sim_poke<unsigned short>(ADCBASE + 0xC000, (unsigned short)(csr & ~(1u << ADCSR_ADST)));
+    if(csr & (1u << ADCSR_ADIE)) sim_irq_raise(IRQ_ADC140_ADI);
+  }
+
+  // DBLANS once - the first into its ADDRn, the second into ADDBLDR and then ADI
+  void double_trigger(unsigned int csr) {
+    unsigned int bit = ((csr >> ADCSR_DBLANS_4_0) & 0x1F) + 3;
+    sim_poke<unsigned short>(second ? ADCBASE + 0xC018 : adc_result_addr(bit), convert(bit));
+    scans++;
+    sim_poke<unsigned short>(ADCBASE + 0xC000, (unsigned short)(csr & ~(1u << ADCSR_ADST)));
+    second = !second;
+    if(second) return;
+    doubles++;
+    if(on_scan) on_scan(ADC_GROUP_A);
+    if(csr & (1u << ADCSR_ADIE)) sim_irq_raise(IRQ_ADC140_ADI);
+  }
+
+  void run(unsigned int n) { while(n--) scan(); }
+
+  void trigger(ElcTarget target) {
+    unsigned int csr = sim_peek<unsigned short>(ADCBASE + 0xC000);
+    unsigned int trsa = (sim_peek<unsigned short>(ADCBASE + 0xC010) >> ADSTRGR_TRSA_5_0) & 0x3F;
+    if(!(csr & (1u << ADCSR_TRGE)) || (csr & (1u << ADCSR_EXTRG))) return;
+    if(trsa != ADC_TRS_ELC_BOTH && trsa != (target == ELC_AD00 ? ADC_TRS_ELC_AD00 : ADC_TRS_ELC_AD01)) return;
+    triggers++;
+    sim_poke<unsigned short>(ADCBASE + 0xC000, (unsigned short)(csr | (1u << ADCSR_ADST)));
+    scan();
+  }
+};
+#endif
+
+}  // namespace ra4m1
+
+#endif  // SUSAN_RA4M1_MINIMA_ADC_STREAM_H
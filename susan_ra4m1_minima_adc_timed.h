@@ -0,0 +1,302 @@
+/*  Arduino UNO R4 Minima - GPT timed ADC sampling for the RA4M1 register defines:
+ *
+ *  A scan started with ADCSR_ADST from a timer interrupt starts when the handler gets there - tens
+ *  of cycles late, by a different amount each time. Here a GPT channel's overflow goes through
+ *  ELC_ELSR08 (ELC_AD00) to the ADC's synchronous trigger, ADSTRGR_TRSA, so each scan starts on the
+ *  timer edge with no CPU in the path and the sample rate is set by GTPR alone. The results go
+ *  into the double buffer of susan_ra4m1_minima_adc_stream.h:
+ *
+ *    alignas(4) static unsigned short buf[ra4m1::adc_stream_words(chans, 256)];
+ *    ra4m1::adc_timed_begin(chans, buf, 256, 4, 10000);     // GPT164, 10 kHz, DTC mover
+ *    ...ra4m1::adc_stream_get() / adc_stream_release() as for continuous scan...
+ *
+ *    ra4m1::adc_timed_rate(12500);                          // Next period on, nothing stopped
+ *    ra4m1::adc_timed_phase(600);                           // Scans start 600 counts into the period
+ *
+ *  adc_timed_rate() writes GTPBR, which the GPT copies to GTPR at its next overflow, so the rate
+ *  changes on a period boundary with no short or long period and no scan lost. The GPT prescaler
+ *  picked by adc_timed_begin() stays - false when the new rate needs another one.
+ *
+ *  adc_timed_phase() moves the trigger from the overflow to compare match B (GTCCRB), e.g. to keep
+ *  the scans away from a PWM edge on another channel; 0 goes back to the overflow. Both return
+ *  false while adc_pair_begin() (susan_ra4m1_minima_adc_pair.h) has the GPT in triangle wave
+ *  mode - GTPBR is half the period there and GTCCRB sets the pair's skew.
+ *
+ *  Jitter, measured by the hardware: the scan end event (IRQ_ADC140_ADI) also goes through
+ *  ELC_ELSR00 (ELC_GPTA) to the same GPT's GTCCRA input capture, so each scan end is timestamped
+ *  in GPT counts from the trigger edge. A handler on the capture collects them:
+ *
+ *    ra4m1::adc_timed_jitter_start(1000);                   // 1000 scans
+ *    while(!ra4m1::adc_timed_jitter_done()) {}
+ *    ra4m1::AdcJitter j = ra4m1::adc_timed_jitter_stop();
+ *    // j.min / j.max - trigger to scan end, j.spread() - sample instant jitter, j.step - largest
+ *    // change from one scan to the next, i.e. how far any sample period was off GTPR + 1
+ *
+ *  Note: The GPT channel, ELC_ELSR08, ADSTRGR and, while measuring, ELC_ELSR00 and an IELSR slot
+ *        are taken until adc_timed_end(). The Arduino core uses GPT channels for analogWrite(),
+ *        pick one the sketch does not. The times are in GPT counts, PCLKD divided by the
+ *        prescaler - adc_timed_count_hz().
+ *
+ *  With RA4M1_HOST_SIM, ra4m1::SimAdcTimer runs GPT periods into a SimElc and a SimAdc, with a
+ *  modelled trigger to scan end time, so the stream, the retune and the jitter figures can be
+ *  checked on Linux.
+ *
+ * This code is "AS IS" without warranty or liability.
+ * GPL v3 or later - see susan_ra4m1_minima_register_defines.h
+*/
+
+#ifndef SUSAN_RA4M1_MINIMA_ADC_TIMED_H
+#define SUSAN_RA4M1_MINIMA_ADC_TIMED_H
+
+#include "susan_ra4m1_minima_adc_stream.h"
+#include "susan_ra4m1_minima_clocks.h"
+
+namespace ra4m1 {
+
+constexpr unsigned int GPT_UNITS = 8;  // GPT320, GPT321 (32 bit), GPT162 - GPT167 (16 bit)
+
+inline unsigned int gpt_base(unsigned int unit) { return GPTBASE + 0x100 * unit; }  // Add GTCR, GTPR, etc.
+constexpr unsigned int gpt_event(unsigned int unit, unsigned int event0) { return event0 + 8 * unit; }  // gpt_event(4, IRQ_GPT0_OVF)
+
+
+// ==== Jitter ====
+
+struct AdcJitter {
+  unsigned int samples;
+  unsigned int min;   // Trigger to scan end, GPT counts
+  unsigned int max;
+  unsigned int step;  // Largest change between two scans in a row
+  unsigned int last;
+
+  void clear() { samples = 0; min = ~0u; max = 0; step = 0; last = 0; }
+
+  void add(unsigned int t) {
+    if(samples) {
+      unsigned int d = t > last ? t - last : last - t;
+      if(d > step) step = d;
+    }
+    if(t < min) min = t;
+    if(t > max) max = t;
+    last = t;
+    samples++;
+  }
+
+  unsigned int spread() const { return samples ? max - min : 0; }
+};
+
+struct AdcTimed {
+  int unit;                    // GPT channel, -1 when stopped
+  unsigned int tpcs;           // GTCR_TPCS, kept by adc_timed_rate()
+  unsigned int event;          // Into ELC_AD00 - overflow or compare match B
+  bool triangle;               // Triangle wave, set by adc_pair_begin() - no rate or phase changes
+  int jitter_slot;
+  unsigned int jitter_want;
+  AdcJitter jitter;
+};
+
+inline AdcTimed adc_timed = {-1, 0, 0, false, -1, 0, {}};
+
+inline unsigned long adc_timed_count_hz() { return clock_pclkd_now() >> (2 * adc_timed.tpcs); }
+
+// GTPR + 1 for the rate at the running prescaler, 0 when it does not fit
+inline unsigned int adc_timed_counts(unsigned long hz) {
+  if(!hz) return 0;
+  unsigned long long max = adc_timed.unit < 2 ? 0xFFFFFFFFULL : 0x10000ULL;
+  unsigned long long n1 = ((unsigned long long)adc_timed_count_hz() + hz / 2) / hz;
+  return n1 >= 2 && n1 <= max ? (unsigned int)n1 : 0;
+}
+
+
+// ==== Sampler ====
+
+inline void adc_timed_jitter_end();
+
+inline void adc_timed_end() {
+  AdcTimed &t = adc_timed;
+  if(t.unit < 0) return;
+  adc_timed_jitter_end();
+  mmio_write(ELC_ELSR08, (unsigned short)0);
+  mmio_write<unsigned int>(gpt_base(t.unit) + GTCR, 0u);
+  adc_stream_stop();
+  mmio_write(ADC140_ADSTRGR, (unsigned short)((ADC_TRS_NONE << ADSTRGR_TRSA_5_0) | (ADC_TRS_NONE << ADSTRGR_TRSB_5_0)));
+  t.unit = -1;
+}
+
+// GPT channel 'unit' stopped and set to period 'g', GTPBR buffered
+inline void adc_timed_gpt(unsigned int unit, const GptPeriod &g) {
+  AdcTimed &t = adc_timed;
+  mmio_write(MSTP_MSTPCRD, mmio_read(MSTP_MSTPCRD) & ~(1u << (unit < 2 ? MSTPD5 : MSTPD6)));
+  unsigned int b = gpt_base(unit);
+  mmio_write<unsigned int>(b + GTCR, 0u);               // Stopped, saw wave, count up
+  mmio_write<unsigned int>(b + GTBER, 1u << GTBER_PR_1_0);  // GTPBR -> GTPR at each overflow
+  mmio_write<unsigned int>(b + GTPR, g.gtpr);
+  mmio_write<unsigned int>(b + GTPBR, g.gtpr);
+  mmio_write<unsigned int>(b + GTCNT, 0u);
+  t.unit = (int)unit;
+  t.tpcs = g.tpcs;
+  t.event = gpt_event(unit, IRQ_GPT0_OVF);
+  t.triangle = false;
+  t.jitter_slot = -1;
+}
+
+// Overflow into ELC_AD00 and the GPT counting - the ADC set up to take it first
+inline void adc_timed_go() {
+  AdcTimed &t = adc_timed;
+  elc_begin();
+  mmio_write(ELC_ELSR08, (unsigned short)t.event);
+  mmio_write<unsigned int>(gpt_base(t.unit) + GTCR, (t.tpcs << GTCR_TPCS_2_0) | (1u << GTCR_CST));
+}
+
+// A scan of 'channels' on every period of GPT channel 'unit' at 'hz', into the stream's double
+// buffer - false when the rate does not fit the channel, or as adc_stream_open()
+inline bool adc_timed_begin(unsigned int channels, unsigned short *buffer, unsigned int frames, unsigned int unit,
+                            unsigned long hz, AdcMover mover = ADC_MOVE_DTC, unsigned int priority = 2) {
+  adc_timed_end();
+  if(unit >= GPT_UNITS || !hz) return false;
+  GptPeriod g = gpt_period(clock_pclkd_now(), hz, unit < 2);
+  if(!g.ok || !adc_stream_open(channels, buffer, frames, mover, priority)) return false;
+
+  adc_timed_gpt(unit, g);
+  mmio_write(ADC140_ADSTRGR, (unsigned short)((ADC_TRS_ELC_AD00 << ADSTRGR_TRSA_5_0) | (ADC_TRS_NONE << ADSTRGR_TRSB_5_0)));
+  mmio_write(ADC140_ADCSR, (unsigned short)((ADC_ADCS_SINGLE << ADCSR_ADCS_1_0) | (1u << ADCSR_ADIE) | (1u << ADCSR_TRGE)));
+  adc_timed_go();
+  return true;
+}
+
+// New period from the next overflow on, GTPR + 1 'counts' - the acquisition keeps running
+inline bool adc_timed_period(unsigned int counts) {
+  AdcTimed &t = adc_timed;
+  if(t.unit < 0 || t.triangle || counts < 2 || (t.unit >= 2 && counts > 0x10000)) return false;
+  mmio_write<unsigned int>(gpt_base(t.unit) + GTPBR, counts - 1);
+  return true;
+}
+
+inline bool adc_timed_rate(unsigned long hz) { return adc_timed_period(adc_timed_counts(hz)); }
+
+// GPT periods a second - a triangle wave counts up to GTPR and back down, 2 * GTPR a period
+inline unsigned long adc_timed_hz() {
+  if(adc_timed.unit < 0) return 0;
+  unsigned long long pbr = mmio_read<unsigned int>(gpt_base(adc_timed.unit) + GTPBR);
+  return adc_timed_count_hz() / (adc_timed.triangle ? 2 * pbr : pbr + 1);
+}
+
+// Trigger 'counts' into each period (compare match B), or at the overflow for 0 - false when
+// not running, or on a triangle wave
+inline bool adc_timed_phase(unsigned int counts) {
+  AdcTimed &t = adc_timed;
+  if(t.unit < 0 || t.triangle) return false;
+  mmio_write<unsigned int>(gpt_base(t.unit) + GTCCRB, counts);
+  t.event = gpt_event(t.unit, counts ? IRQ_GPT0_CCMPB : IRQ_GPT0_OVF);
+  mmio_write(ELC_ELSR08, (unsigned short)t.event);
+  return true;
+}
+
+
+// ==== Jitter measurement ====
+
+inline void adc_timed_capture_isr() {
+  AdcTimed &t = adc_timed;
+  irq_ack(t.jitter_slot);
+  if(t.jitter.samples >= t.jitter_want) return;
+  t.jitter.add(mmio_read<unsigned int>(gpt_base(t.unit) + GTCCRA));
+  if(t.jitter.samples >= t.jitter_want) mmio_write<unsigned int>(gpt_base(t.unit) + GTICASR, 0u);
+}
+
+// Scan ends captured on GTCCRA for the next 'samples' scans - false when not running or no slot
+inline bool adc_timed_jitter_start(unsigned int samples, unsigned int priority = 3) {
+  AdcTimed &t = adc_timed;
+  if(t.unit < 0 || !samples) return false;
+  adc_timed_jitter_end();
+  t.jitter.clear();
+  t.jitter_want = samples;
+  t.jitter_slot = irq_alloc(gpt_event(t.unit, IRQ_GPT0_CCMPA), priority, adc_timed_capture_isr);
+  if(t.jitter_slot < 0) return false;
+  mmio_write(ELC_ELSR00, (unsigned short)IRQ_ADC140_ADI);
+  mmio_write<unsigned int>(gpt_base(t.unit) + GTICASR, 1u << GTICASR_ASELCA);
+  return true;
+}
+
+inline bool adc_timed_jitter_done() { return adc_timed.jitter.samples >= adc_timed.jitter_want; }
+
+inline void adc_timed_jitter_end() {
+  AdcTimed &t = adc_timed;
+  if(t.jitter_slot < 0) return;
+  mmio_write<unsigned int>(gpt_base(t.unit) + GTICASR, 0u);
+  mmio_write(ELC_ELSR00, (unsigned short)0);
+  irq_free(t.jitter_slot);
+  t.jitter_slot = -1;
+}
+
+inline AdcJitter adc_timed_jitter_stop() {
+  adc_timed_jitter_end();
+  return adc_timed.jitter;
+}
+
+
+#ifdef RA4M1_HOST_SIM
+// ==== Simulated GPT periods ====
+// Each period of the running unit: GTPBR into GTPR, GTCNT to the trigger point, the overflow
+// or compare B event - in triangle wave mode, compare B counting up and again counting down.
+// 'at' is the trigger's time in GPT counts from the first period. SimElc takes the event to the
+// SimAdc, and the scan end back to the GTCCRA capture, 'conversion' counts after the trigger
+// plus 0 .. jitter - 1, stepping one per scan.
+//
+//   ra4m1::sim_reset();
+//   ra4m1::SimElc elc;  elc.attach();
+//   ra4m1::SimDtc dtc;  dtc.attach();
+//   ra4m1::SimAdc adc;
+//   ra4m1::SimAdcTimer gpt;  gpt.jitter = 3;  gpt.attach(elc, adc);
+//   ra4m1::adc_timed_begin(chans, buf, 16, 4, 10000);
+//   gpt.run(32);
+
+struct SimAdcTimer {
+  unsigned int conversion = 40;
+  unsigned int jitter = 0;
+  unsigned int periods = 0;
+  unsigned long long counts = 0;  // GPT counts run, all periods
+  unsigned long long at = 0;      // Last trigger
+
+  void attach(SimElc &elc, SimAdc &adc) {
+    elc.on(ELC_AD00, [&adc] { adc.trigger(ELC_AD00); });
+    elc.on(ELC_GPTA, [this] { capture(); });
+  }
+
+  void run(unsigned int n) {
+    while(n--) {
+      if(adc_timed.unit < 0) return;
+      unsigned int b = gpt_base(adc_timed.unit);
+      if(!(sim_peek<unsigned int>(b + GTCR) & (1u << GTCR_CST))) return;
+      if((sim_peek<unsigned int>(b + GTBER) >> GTBER_PR_1_0) & 3) sim_poke<unsigned int>(b + GTPR, sim_peek<unsigned int>(b + GTPBR));
+      unsigned int event = sim_peek<unsigned short>(ELCBASE + ELSR + ELC_AD00 * 4);
+      if(((sim_peek<unsigned int>(b + GTCR) >> GTCR_MD_2_0) & 7) == GPT_MD_TRIANGLE) {
+        unsigned int top = sim_peek<unsigned int>(b + GTPR), ccrb = sim_peek<unsigned int>(b + GTCCRB);
+        sim_poke<unsigned int>(b + GTCNT, ccrb);
+        at = counts + ccrb;
+        sim_irq_raise(event);
+        at = counts + 2ULL * top - ccrb;
+        sim_irq_raise(event);
+        counts += 2ULL * top;
+        periods++;
+        continue;
+      }
+      sim_poke<unsigned int>(b + GTCNT, event == gpt_event(adc_timed.unit, IRQ_GPT0_CCMPB) ? sim_peek<unsigned int>(b + GTCCRB) : 0u);
+      at = counts + sim_peek<unsigned int>(b + GTCNT);
+      sim_irq_raise(event);
+      counts += sim_peek<unsigned int>(b + GTPR) + 1ULL;
+      periods++;
+    }
+  }
+
+  void capture() {
+    if(adc_timed.unit < 0) return;
+    unsigned int b = gpt_base(adc_timed.unit);
+    if(!((sim_peek<unsigned int>(b + GTICASR) >> GTICASR_ASELCA) & 1)) return;
+    sim_poke<unsigned int>(b + GTCCRA, sim_peek<unsigned int>(b + GTCNT) + conversion + (jitter ? periods % jitter : 0));
+    sim_irq_raise(gpt_event(adc_timed.unit, IRQ_GPT0_CCMPA));
+  }
+};
+#endif
+
+}  // namespace ra4m1
+
+#endif  // SUSAN_RA4M1_MINIMA_ADC_TIMED_H
@@ -0,0 +1,328 @@
+/*  Arduino UNO R4 Minima - ADC window comparator threshold monitoring for the RA4M1 register defines:
+ *
+ *  The ADC14 compares each conversion against two windows as it goes: window A on any set of
+ *  channels with one band (ADCMPDR0 - ADCMPDR1), window B on one channel with its own band
+ *  (ADWINLLB - ADWINULB). Here each watched channel gets a hysteresis comparator out of that: it
+ *  goes high when its value rises above the band and low when it falls below it, and the handler
+ *  is only called on those changes - no polling, and the ADC scans on with no CPU in between:
+ *
+ *    void on_cross(unsigned int channel, bool high, unsigned short value) { ... }
+ *
+ *    ra4m1::adc_watch_a(ra4m1::adc_pin(A0) | ra4m1::adc_pin(A1), 1000, 3000);  // Below 1000 / above 3000
+ *    ra4m1::adc_watch_b(ra4m1::ADC_TEMP, 1400, 1500);                         // Own band
+ *    ra4m1::adc_watch_begin(on_cross);                                        // CMPAI / CMPBI slots
+ *    ra4m1::adc_watch_scan(ra4m1::adc_pin(A0) | ra4m1::adc_pin(A1) | ra4m1::ADC_TEMP);
+ *    for(;;) {
+ *      ra4m1::adc_watch_sleep();                                              // WFI until an interrupt
+ *      if(ra4m1::adc_watch_high(ra4m1::adc_pin(A0))) ...
+ *    }
+ *
+ *  adc_watch_scan() is continuous scan with no scan end interrupt; adc_stream_begin(),
+ *  adc_timed_begin() etc. work as well, the compare unit looks at every conversion whoever
+ *  starts it. Channels are the bits of susan_ra4m1_minima_adc_stream.h, ADC_TEMP and ADC_VREF
+ *  too (ADCMPANSER, ADC_CMPCHB_TEMP / VREF for window B).
+ *
+ *  How it re-arms: the windows run in window mode (ADCMPCR_WCMPE), where each channel's condition
+ *  bit picks inside the band or outside it. A channel outside the band is armed for inside, one
+ *  inside for outside, so the compare interrupt comes when a value crosses a band edge and not on
+ *  every conversion. The handler clears the flags, reads the latest results, and re-arms each
+ *  channel that fired - leaving the band on the other side from the last time is a crossing and
+ *  calls the handler; stepping in and back out the same side is not. Until a channel has left
+ *  the band once its state is not known, adc_watch_known().
+ *
+ *  Composite: adc_watch_combine(ADC_CMPAB_AND, true, true) instead fixes the conditions - inside
+ *  or outside per window, no re-arm, no compare interrupts - and the A / B composite is on
+ *  ADWINMON_MONCOMB and goes to the ELC as IRQ_ADC140_WCMPM / WCMPUM, e.g. to start or stop a
+ *  GPT with no CPU. The manual wants window A on one channel for that.
+ *
+ *  Note: Set up with the ADC stopped - ADCMPCR wants ADCSR_ADST at 0. A signal sitting on a band
+ *        edge still wakes the CPU each time it steps in and out - make the band wider than the
+ *        noise. A step clean across the band between two conversions of a channel is not seen
+ *        until the value next comes into the band - the conditions can only tell inside from
+ *        outside, and the channel is armed for inside. The compare unit is not for use with
+ *        ADADC addition / averaging or double trigger. The levels are in result register units,
+ *        so they follow the resolution, ADCER_ADPCR_1_0.
+ *
+ *  With RA4M1_HOST_SIM, ra4m1::SimAdcCompare evaluates both windows on each SimAdc scan - flags,
+ *  ADWINMON, CMPAI / CMPBI and the WCMPM / WCMPUM events.
+ *
+ * This code is "AS IS" without warranty or liability.
+ * GPL v3 or later - see susan_ra4m1_minima_register_defines.h
+*/
+
+#ifndef SUSAN_RA4M1_MINIMA_ADC_WATCH_H
+#define SUSAN_RA4M1_MINIMA_ADC_WATCH_H
+
+#include "susan_ra4m1_minima_adc_stream.h"
+
+namespace ra4m1 {
+
+typedef void (*AdcWatchCallback)(unsigned int channel, bool high, unsigned short value);
+
+// ==== Compare registers ====
+// Window A registers come in threes laid out as ADANSA0 / ADANSA1 and ADEXICR's TSSA / OCSA
+
+inline void adc_cmp_write(volatile unsigned short *an0, volatile unsigned short *an1, volatile unsigned char *ex, unsigned int channels) {
+  mmio_write(an0, (unsigned short)((channels >> 3) & 0x7FFF));
+  mmio_write(an1, (unsigned short)((channels >> 19) & 0x3FF));
+  mmio_write(ex, (unsigned char)(channels & (ADC_TEMP | ADC_VREF)));
+}
+
+inline unsigned int adc_cmp_read(volatile unsigned short *an0, volatile unsigned short *an1, volatile unsigned char *ex) {
+  return ((mmio_read(an0) & 0x7FFFu) << 3) | ((mmio_read(an1) & 0x3FFu) << 19) | (mmio_read(ex) & (ADC_TEMP | ADC_VREF));
+}
+
+// ADCMPBNSR_CMPCHB for one channel bit
+constexpr unsigned int adc_cmp_chb(unsigned int channel) {
+  return channel == ADC_TEMP ? ADC_CMPCHB_TEMP : channel == ADC_VREF ? ADC_CMPCHB_VREF : adc_first(channel) - 3;
+}
+
+
+// ==== Monitor ====
+
+struct AdcWatch {
+  bool running;
+  bool combined;                 // Fixed conditions, the composite only
+  AdcWatchCallback on_cross;
+  unsigned int channels_a;
+  unsigned short lo_a, hi_a;
+  unsigned int channel_b;
+  unsigned short lo_b, hi_b;
+  unsigned int cmpab;
+  bool inside_a, inside_b;       // Composite conditions
+  int slot_a, slot_b;
+  volatile unsigned int armed;   // Bit per channel - waiting to enter the band
+  volatile unsigned int known;   // Bit per channel - has left the band once
+  volatile unsigned int high;    // Bit per channel - last left above the band
+  volatile unsigned int crossings;
+  volatile unsigned int wakeups; // Compare interrupts, crossings or not
+};
+
+inline AdcWatch adc_watch = {false, false, nullptr, 0, 0, 0, 0, 0, 0, 0, false, false, -1, -1, 0, 0, 0, 0, 0};
+
+// Window A on 'channels', high above 'hi' and low below 'lo' - false for an empty band
+inline bool adc_watch_a(unsigned int channels, unsigned short lo, unsigned short hi) {
+  AdcWatch &w = adc_watch;
+  if((channels && !adc_channels_ok(channels)) || (channels & w.channel_b) || lo >= hi) return false;
+  w.channels_a = channels;
+  w.lo_a = lo;
+  w.hi_a = hi;
+  return true;
+}
+
+// Window B on one channel, 0 for none
+inline bool adc_watch_b(unsigned int channel, unsigned short lo, unsigned short hi) {
+  AdcWatch &w = adc_watch;
+  if((channel && (!adc_channels_ok(channel) || (channel & (channel - 1)))) || (channel & w.channels_a) || lo >= hi) return false;
+  w.channel_b = channel;
+  w.lo_b = lo;
+  w.hi_b = hi;
+  return true;
+}
+
+// Composite mode, before adc_watch_begin() - ADC_CMPAB_OR / XOR / AND of window A's and window
+// B's fixed conditions, inside the band or outside it
+inline void adc_watch_combine(unsigned int cmpab, bool a_inside = true, bool b_inside = true) {
+  AdcWatch &w = adc_watch;
+  w.combined = true;
+  w.cmpab = cmpab & 3;
+  w.inside_a = a_inside;
+  w.inside_b = b_inside;
+}
+
+inline bool adc_watch_known(unsigned int channel) { return adc_watch.known & channel; }
+inline bool adc_watch_high(unsigned int channel) { return adc_watch.high & channel; }
+inline bool adc_watch_combined() { return (mmio_read(ADC140_ADWINMON) >> ADWINMON_MONCOMB) & 1; }
+
+// One channel after a compare interrupt - the latest value decides, whichever condition fired
+inline void adc_watch_step(unsigned int channel, unsigned short lo, unsigned short hi) {
+  AdcWatch &w = adc_watch;
+  unsigned short v = mmio_read<unsigned short>(adc_result_addr(adc_first(channel)));
+  if(v >= lo && v <= hi) {  // In the band - wait to leave it
+    w.armed = w.armed & ~channel;
+    return;
+  }
+  bool up = v > hi;
+  w.armed = w.armed | channel;
+  if((w.known & channel) && adc_watch_high(channel) == up) return;
+  w.known = w.known | channel;
+  w.high = up ? w.high | channel : w.high & ~channel;
+  w.crossings = w.crossings + 1;
+  if(w.on_cross) w.on_cross(channel, up, v);
+}
+
+// Flags cleared before re-arming - a match in between is another interrupt, not a lost one
+inline void adc_watch_isr_a() {
+  AdcWatch &w = adc_watch;
+  irq_ack(w.slot_a);
+  w.wakeups = w.wakeups + 1;
+  unsigned int hit = adc_cmp_read(ADC140_ADCMPSR0, ADC140_ADCMPSR1, ADC140_ADCMPSER) & w.channels_a;
+  adc_cmp_write(ADC140_ADCMPSR0, ADC140_ADCMPSR1, ADC140_ADCMPSER, ~hit);  // Write 0 to clear
+  for(unsigned int m = hit; m; m &= m - 1) adc_watch_step(m & -m, w.lo_a, w.hi_a);
+  adc_cmp_write(ADC140_ADCMPLR0, ADC140_ADCMPLR1, ADC140_ADCMPLER, w.armed & w.channels_a);
+}
+
+inline void adc_watch_isr_b() {
+  AdcWatch &w = adc_watch;
+  irq_ack(w.slot_b);
+  w.wakeups = w.wakeups + 1;
+  mmio_write(ADC140_ADCMPBSR, (unsigned char)0);
+  adc_watch_step(w.channel_b, w.lo_b, w.hi_b);
+  unsigned int cond = w.armed & w.channel_b ? 1u << ADCMPBNSR_CMPLB : 0;
+  mmio_write(ADC140_ADCMPBNSER, (unsigned char)(adc_cmp_chb(w.channel_b) | cond));
+}
+
+inline void adc_watch_end() {
+  AdcWatch &w = adc_watch;
+  if(!w.running) return;
+  mmio_write(ADC140_ADCMPCR, (unsigned short)0);
+  if(w.slot_a >= 0) irq_free(w.slot_a);
+  if(w.slot_b >= 0) irq_free(w.slot_b);
+  w.slot_a = w.slot_b = -1;
+  w.running = false;
+  w.combined = false;
+}
+
+// Windows set by adc_watch_a() / _b() into the compare unit - the ADC stopped. False when no
+// channel is watched or there is no free slot
+inline bool adc_watch_begin(AdcWatchCallback on_cross = nullptr, unsigned int priority = 3) {
+  AdcWatch &w = adc_watch;
+  bool combined = w.combined;
+  adc_watch_end();
+  w.combined = combined;
+  if(!w.channels_a && !w.channel_b) return false;
+  mmio_write(MSTP_MSTPCRD, mmio_read(MSTP_MSTPCRD) & ~(1u << MSTPD16));
+  w.on_cross = on_cross;
+  w.armed = w.known = w.high = 0;  // Armed for outside - the first value out of the band sets the state
+  w.crossings = w.wakeups = 0;
+
+  unsigned int cr = (1u << ADCMPCR_WCMPE) | (w.combined ? w.cmpab << ADCMPCR_CMPAB_1_0 : 0);
+  mmio_write(ADC140_ADCMPCR, (unsigned short)0);
+  adc_cmp_write(ADC140_ADCMPANSR0, ADC140_ADCMPANSR1, ADC140_ADCMPANSER, w.channels_a);
+  adc_cmp_write(ADC140_ADCMPLR0, ADC140_ADCMPLR1, ADC140_ADCMPLER, w.combined && w.inside_a ? w.channels_a : 0);
+  mmio_write(ADC140_ADCMPDR0, w.lo_a);
+  mmio_write(ADC140_ADCMPDR1, w.hi_a);
+  unsigned int chb = w.channel_b ? adc_cmp_chb(w.channel_b) : ADC_CMPCHB_NONE;
+  mmio_write(ADC140_ADCMPBNSER, (unsigned char)(chb | (w.combined && w.inside_b ? 1u << ADCMPBNSR_CMPLB : 0)));
+  mmio_write(ADC140_ADWINLLB, w.lo_b);
+  mmio_write(ADC140_ADWINULB, w.hi_b);
+  adc_cmp_write(ADC140_ADCMPSR0, ADC140_ADCMPSR1, ADC140_ADCMPSER, 0);
+  mmio_write(ADC140_ADCMPBSR, (unsigned char)0);
+  w.running = true;
+
+  if(w.channels_a) {
+    cr |= 1u << ADCMPCR_CMPAE;
+    if(!w.combined) {
+      w.slot_a = irq_alloc(IRQ_ADC140_CMPAI, priority, adc_watch_isr_a);
+      cr |= 1u << ADCMPCR_CMPAIE;
+    }
+  }
+  if(w.channel_b) {
+    cr |= 1u << ADCMPCR_CMPBE;
+    if(!w.combined) {
+      w.slot_b = irq_alloc(IRQ_ADC140_CMPBI, priority, adc_watch_isr_b);
+      cr |= 1u << ADCMPCR_CMPBIE;
+    }
+  }
+  if((w.channels_a && !w.combined && w.slot_a < 0) || (w.channel_b && !w.combined && w.slot_b < 0)) {
+    adc_watch_end();
+    return false;
+  }
+  mmio_write(ADC140_ADCMPCR, (unsigned short)cr);
+  return true;
+}
+
+// Continuous scan of 'channels' with no scan end interrupt - only the compare unit wakes the CPU
+inline bool adc_watch_scan(unsigned int channels) {
+  if(!adc_channels_ok(channels)) return false;
+  mmio_write(ADC140_ADCSR, (unsigned short)0);
+  adc_select(channels);
+  constexpr unsigned short csr = ADC_ADCS_CONT << ADCSR_ADCS_1_0;
+  mmio_write(ADC140_ADCSR, csr);
+  mmio_write(ADC140_ADCSR, (unsigned short)(csr | (1u << ADCSR_ADST)));
+  return true;
+}
+
+// Sleep mode until the next interrupt - SBYCR_SSBY left as the sketch has it, 0 out of reset
+inline void adc_watch_sleep() {
+#ifndef RA4M1_HOST_SIM
+  asm volatile("dsb\n wfi" ::: "memory");
+#endif
+}
+
+
+#ifdef RA4M1_HOST_SIM
+// ==== Simulated compare unit ====
+// After each SimAdc scan: window A on its selected channels in the scan, window B on its channel,
+// as the manual has the conditions - window mode strictly inside / outside the band, otherwise
+// above / below ADCMPDR0 (ADWINLLB). Flags are set on a match and cleared by writing 0; CMPAI /
+// CMPBI come on every matching scan with the interrupt enabled; ADWINMON and WCMPM / WCMPUM
+// follow the scan's composite.
+//
+//   ra4m1::sim_reset();
+//   ra4m1::SimAdc adc;  adc.input = [&](unsigned int ch, unsigned int) { return level; };
+//   ra4m1::SimAdcCompare cmp;  cmp.attach(adc);
+//   ra4m1::adc_watch_a(chans, 1000, 3000);  ra4m1::adc_watch_begin(on_cross);
+//   ra4m1::adc_watch_scan(chans);
+//   adc.run(10);
+
+struct SimAdcCompare {
+  unsigned int cmpai = 0;
+  unsigned int cmpbi = 0;
+
+  void attach(SimAdc &adc) {
+    adc.on_scan = [this](AdcGroup g) { compare(g); };
+    SimHook clear16 = [](unsigned int a, unsigned int v) { return sim_peek<unsigned short>(a) & v; };  // Write 0 to clear
+    SimHook clear8 = [](unsigned int a, unsigned int v) { return sim_peek<unsigned char>(a) & v; };
+    sim_on_write(phys(ADC140_ADCMPSR0), clear16);
+    sim_on_write(phys(ADC140_ADCMPSR1), clear16);
+    sim_on_write(phys(ADC140_ADCMPSER), clear8);
+    sim_on_write(phys(ADC140_ADCMPBSR), clear8);
+  }
+
+  static bool match(unsigned int v, bool cond, bool window, unsigned int lo, unsigned int hi) {
+    if(window) return cond ? lo < v && v < hi : v < lo || hi < v;
+    return cond ? lo < v : v < lo;
+  }
+
+  void compare(AdcGroup g) {
+    unsigned int cr = sim_peek<unsigned short>(phys(ADC140_ADCMPCR));
+    bool window = (cr >> ADCMPCR_WCMPE) & 1, a = false, b = false;
+    unsigned int set = adc_selected(g);
+    if((cr >> ADCMPCR_CMPAE) & 1) {
+      unsigned int chans = adc_cmp_read(ADC140_ADCMPANSR0, ADC140_ADCMPANSR1, ADC140_ADCMPANSER) & set;
+      unsigned int cond = adc_cmp_read(ADC140_ADCMPLR0, ADC140_ADCMPLR1, ADC140_ADCMPLER), hit = 0;
+      unsigned int lo = sim_peek<unsigned short>(phys(ADC140_ADCMPDR0)), hi = sim_peek<unsigned short>(phys(ADC140_ADCMPDR1));
+      for(unsigned int m = chans; m; m &= m - 1)
+        if(match(sim_peek<unsigned short>(adc_result_addr(adc_first(m & -m))), cond & m & -m, window, lo, hi)) hit |= m & -m;
+      if(hit) {
+        a = true;
+        sim_poke<unsigned short>(phys(ADC140_ADCMPSR0), (unsigned short)(sim_peek<unsigned short>(phys(ADC140_ADCMPSR0)) | ((hit >> 3) & 0x7FFF)));
+        sim_poke<unsigned short>(phys(ADC140_ADCMPSR1), (unsigned short)(sim_peek<unsigned short>(phys(ADC140_ADCMPSR1)) | ((hit >> 19) & 0x3FF)));
+        sim_poke<unsigned char>(phys(ADC140_ADCMPSER), (unsigned char)(sim_peek<unsigned char>(phys(ADC140_ADCMPSER)) | (hit & 3)));
+      }
+    }
+    if((cr >> ADCMPCR_CMPBE) & 1) {
+      unsigned int bnsr = sim_peek<unsigned char>(phys(ADC140_ADCMPBNSER)), chb = bnsr & 0x3F;
+      unsigned int bit = chb == ADC_CMPCHB_TEMP ? ADC_TEMP : chb == ADC_CMPCHB_VREF ? ADC_VREF : adc_an(chb);
+      unsigned int lo = sim_peek<unsigned short>(phys(ADC140_ADWINLLB)), hi = sim_peek<unsigned short>(phys(ADC140_ADWINULB));
+      if((set & bit) && match(sim_peek<unsigned short>(adc_result_addr(adc_first(bit))), (bnsr >> ADCMPBNSR_CMPLB) & 1, window, lo, hi)) {
+        b = true;
+        sim_poke<unsigned char>(phys(ADC140_ADCMPBSR), (unsigned char)1);
+      }
+    }
+    if(!((cr >> ADCMPCR_CMPAE) & 1) && !((cr >> ADCMPCR_CMPBE) & 1)) return;
+    unsigned int ab = (cr >> ADCMPCR_CMPAB_1_0) & 3;
+    bool comb = ab == ADC_CMPAB_AND ? a && b : ab == ADC_CMPAB_XOR ? a != b : a || b;
+    sim_poke<unsigned char>(phys(ADC140_ADWINMON), (unsigned char)((comb ? 1u << ADWINMON_MONCOMB : 0) |
+                                                                   (a ? 1u << ADWINMON_MONCMPA : 0) | (b ? 1u << ADWINMON_MONCMPB : 0)));
+    sim_irq_raise(comb ? IRQ_ADC140_WCMPM : IRQ_ADC140_WCMPUM);
+    if(a && ((cr >> ADCMPCR_CMPAIE) & 1)) { cmpai++; sim_irq_raise(IRQ_ADC140_CMPAI); }
+    if(b && ((cr >> ADCMPCR_CMPBIE) & 1)) { cmpbi++; sim_irq_raise(IRQ_ADC140_CMPBI); }
+  }
+};
+#endif
+
+}  // namespace ra4m1
+
+#endif  // SUSAN_RA4M1_MINIMA_ADC_WATCH_H
@@ -0,0 +1,338 @@
+/*  Arduino UNO R4 Minima - closed-loop HOCO / MOCO / LOCO user trimming with the CAC:
+ *
+ *  The Clock Frequency Accuracy Measurement Circuit counts one clock over a period of another.
+ *  Here it measures an on-chip oscillator against a reference - the main clock oscillator, or a
+ *  known frequency on the CACREF pin - and after each batch of measurements nudges the matching
+ *  user trimming register (HOCOUTCR / MOCOUTCR / LOCOUTCR) toward zero error. It runs in the
+ *  background off the CAC measurement-end interrupt, and publishes what it measured:
+ *
+ *    ra4m1::CacTrimConfig cfg;
+ *    cfg.target = ra4m1::CAC_HOCO;  cfg.ref = ra4m1::CAC_MOSC;  cfg.ref_hz = 12000000;
+ *    cfg.slot_mend = 12;  cfg.slot_ovf = 13;                  // Free IELSR slots
+ *    ra4m1::cac_trim_start(cfg);
+ *    ...
+ *    Serial.print(ra4m1::cac_trim_state.error_ppm);           // + is running fast
+ *
+ *  Or leave the slots at ra4m1::IRQ_SLOTS and call ra4m1::cac_trim_poll() from loop().
+ *
+ *  The counter, dividers, and which clock is counted are picked by cac_plan() for the most counts
+ *  per measurement - e.g. HOCO 48 MHz against a 12 MHz crystal /8192 is 32768 counts, 31 ppm each.
+ *  For LOCO, too slow to count against the crystal, the roles swap: the crystal is counted over a
+ *  LOCO period. How far one trim step moves the frequency is learnt from the measurements.
+ *
+ *  Note: Each trim write unlocks PRC0 and puts PRCR back as it was. A CACREF pin needs its PFS
+ *        set for CACREF first. HOCO error after trimming is limited by its temperature drift, so
+ *        leave this running rather than trimming once.
+ *
+ *  With RA4M1_HOST_SIM, ra4m1::SimCac models the CAC and the oscillators against the trim registers;
+ *  host/cac_trim.cpp runs the trim loop against it.
+ *
+ * This code is "AS IS" without warranty or liability.
+ * GPL v3 or later - see susan_ra4m1_minima_register_defines.h
+*/
+
+#ifndef SUSAN_RA4M1_MINIMA_CAC_TRIM_H
+#define SUSAN_RA4M1_MINIMA_CAC_TRIM_H
+
+#include "susan_ra4m1_minima_clocks.h"
+#include "susan_ra4m1_minima_irq.h"
+
+namespace ra4m1 {
+
+// CACR1_FMCS / CACR2_RSCS clock select values, plus the CACREF pin as a reference
+enum CacClock : unsigned char {
+  CAC_MOSC  = 0,
+  CAC_SOSC  = 1,
+  CAC_HOCO  = 2,
+  CAC_MOCO  = 3,
+  CAC_LOCO  = 4,
+  CAC_PCLKB = 5,
+  CAC_IWDT  = 6,
+  CAC_PIN   = 7   // Reference only - CACR2_RPS = 0
+};
+
+constexpr unsigned int CAC_COUNT_MAX = 60000;  // Leaves room for a -8% clock before CACNTBR overflows
+
+constexpr unsigned int cac_tcss_div(unsigned int tcss) { return tcss == 0 ? 1 : tcss == 1 ? 4 : tcss == 2 ? 8 : 32; }
+constexpr unsigned int cac_rcds_div(unsigned int rcds) { return rcds == 0 ? 32 : rcds == 1 ? 128 : rcds == 2 ? 1024 : 8192; }
+
+struct CacPlan {
+  unsigned char fmcs;      // Clock counted
+  unsigned char tcss;      // ... divided by 1, 4, 8, 32
+  unsigned char rscs;      // Clock giving the measurement period
+  unsigned char rcds;      // ... divided by 32, 128, 1024, 8192
+  bool pin;                // Period from the CACREF pin
+  bool swapped;            // The reference is counted over a period of the trimmed clock
+  unsigned int expected;   // CACNTBR when the trimmed clock is exactly right
+};
+
+constexpr CacPlan cac_plan(CacClock target, unsigned long target_hz, CacClock ref, unsigned long ref_hz) {
+  CacPlan best{0, 0, 0, 0, false, false, 0};
+  for(unsigned int swap = 0; swap <= 1; swap++) {
+    if(swap && ref == CAC_PIN) break;  // The pin can only be the reference
+    unsigned long long counted = swap ? ref_hz : target_hz;
+    unsigned long long period  = swap ? target_hz : ref_hz;
+    for(unsigned int tcss = 0; tcss <= 3; tcss++) {
+      for(unsigned int rcds = 0; rcds <= 3; rcds++) {
+        unsigned long long n = counted * cac_rcds_div(rcds) / (cac_tcss_div(tcss) * period);
+        if(n <= CAC_COUNT_MAX && n > best.expected)
+          best = CacPlan{(unsigned char)(swap ? ref : target), (unsigned char)tcss,
+                         (unsigned char)(swap ? target : (ref == CAC_PIN ? 0 : ref)), (unsigned char)rcds,
+                         ref == CAC_PIN, swap == 1, (unsigned int)n};
+      }
+    }
+  }
+  return best;
+}
+
+static_assert(cac_plan(CAC_HOCO, 48000000, CAC_MOSC, 12000000).expected == 32768, "HOCO against a 12 MHz crystal");
+static_assert(cac_plan(CAC_LOCO, 32768, CAC_MOSC, 12000000).swapped, "LOCO is the period, not the count");
+
+// Trimmed clock error from a count, ppm - + is running fast
+constexpr long cac_error_ppm(const CacPlan &p, unsigned int count) {
+  return p.swapped ? (long)(((long long)p.expected - count) * 1000000 / (long long)count)
+                   : (long)(((long long)count - p.expected) * 1000000 / (long long)p.expected);
+}
+
+
+// ==== Calibrator ====
+
+struct CacTrimConfig {
+  CacClock target = CAC_HOCO;        // CAC_HOCO, CAC_MOCO, or CAC_LOCO
+  CacClock ref = CAC_MOSC;           // CAC_MOSC, CAC_SOSC, or CAC_PIN
+  unsigned long ref_hz = 0;          // The crystal, or the CACREF pin frequency
+  long deadband_ppm = 500;           // No more trimming while within this, or half a trim step if more
+  long ppm_per_step = 0;             // Trim register sensitivity if known, 0: learn it
+  unsigned char average = 4;         // Measurements per trim decision
+  unsigned char settle = 1;          // Measurements dropped after a trim change
+  signed char max_step = 8;          // Largest trim change at once
+  unsigned int slot_mend = IRQ_SLOTS;  // IELSR slot for IRQ_CAC_MENDI, IRQ_SLOTS: no interrupt, poll
+  unsigned int slot_ovf = IRQ_SLOTS;   // IELSR slot for IRQ_CAC_OVFI
+  unsigned int priority = 14;
+};
+
+constexpr long CAC_TRIM_PPM_STEP_GUESS = 300;  // Where learning starts
+
+struct CacTrimState {
+  volatile long error_ppm;          // Last averaged measurement
+  volatile unsigned long hz;        // Trimmed clock, as measured
+  volatile signed char trim;        // *_UTRM now
+  volatile bool locked;             // Within the deadband
+  volatile unsigned int measurements;
+  volatile unsigned int overflows;
+  volatile unsigned int adjustments;
+  volatile long ppm_per_step;       // Learnt sensitivity
+};
+
+inline CacTrimState cac_trim_state;
+inline CacTrimConfig cac_trim_cfg;
+inline CacPlan cac_trim_plan;
+inline unsigned long cac_trim_nominal;  // Trimmed clock when exact
+inline long cac_trim_sum;
+inline unsigned int cac_trim_n;
+inline unsigned int cac_trim_skip;
+inline long cac_trim_last_err;
+inline int cac_trim_last_step;
+
+inline unsigned long cac_nominal_hz(CacClock c) {
+  return c == CAC_HOCO ? hoco_hz() : c == CAC_MOCO ? 8000000 : 32768;
+}
+
+inline signed char cac_trim_read(CacClock c) {
+  return (signed char)(c == CAC_HOCO ? HOCOUTCR::read() : c == CAC_MOCO ? MOCOUTCR::read() : LOCOUTCR::read());
+}
+
+inline void cac_trim_write(CacClock c, signed char v) {
+  unsigned short was = PRCR::read() & 0xFF;
+  PRCR::write((unsigned short)((PRCR_PRKEY << PRCR_PRKEY_7_0) | was | (1 << PRCR_PRC0)));
+  if(c == CAC_HOCO) HOCOUTCR::write((unsigned char)v);
+  else if(c == CAC_MOCO) MOCOUTCR::write((unsigned char)v);
+  else LOCOUTCR::write((unsigned char)v);
+  PRCR::write((unsigned short)((PRCR_PRKEY << PRCR_PRKEY_7_0) | was));
+}
+
+// One CACNTBR value in - averaged, published, and maybe a trim step out
+inline void cac_trim_update(unsigned int count) {
+  CacTrimState &s = cac_trim_state;
+  const CacTrimConfig &c = cac_trim_cfg;
+  s.measurements = s.measurements + 1;
+  if(cac_trim_skip) { cac_trim_skip--; return; }
+  cac_trim_sum += cac_error_ppm(cac_trim_plan, count);
+  if(++cac_trim_n < c.average) return;
+  long err = cac_trim_sum / (long)cac_trim_n;
+  cac_trim_sum = 0;
+  cac_trim_n = 0;
+  s.error_ppm = err;
+  s.hz = (unsigned long)((long long)cac_trim_nominal * (1000000 + err) / 1000000);
+
+  // Learn how far the last step moved it, ignoring noise-sized moves
+  if(cac_trim_last_step && c.ppm_per_step == 0) {
+    long moved = err - cac_trim_last_err;
+    long noise = c.deadband_ppm / 2;
+    if(moved > noise || moved < -noise) s.ppm_per_step = (s.ppm_per_step * 3 + moved / cac_trim_last_step) / 4;
+    if(s.ppm_per_step > -10 && s.ppm_per_step < 10) s.ppm_per_step = s.ppm_per_step < 0 ? -10 : 10;
+  }
+  cac_trim_last_step = 0;
+
+  // Within the deadband, or within half a step - another step would only overshoot
+  long band = c.deadband_ppm;
+  long half = (s.ppm_per_step < 0 ? -s.ppm_per_step : s.ppm_per_step) / 2;
+  if(half > band) band = half;
+  s.locked = err <= band && err >= -band;
+  if(s.locked) return;
+
+  long gain = s.ppm_per_step;
+  long step = -(err + (err * gain > 0 ? gain / 2 : -gain / 2)) / gain;  // Rounded
+  if(step == 0) step = (err * gain > 0) ? -1 : 1;
+  if(step > c.max_step) step = c.max_step;
+  if(step < -c.max_step) step = -c.max_step;
+  int trim = s.trim + step;
+  if(trim > 127) trim = 127;
+  if(trim < -128) trim = -128;
+  if(trim == s.trim) return;  // At the end of the trim range
+
+  cac_trim_write(c.target, (signed char)trim);
+  cac_trim_last_step = trim - s.trim;
+  cac_trim_last_err = err;
+  s.trim = (signed char)trim;
+  s.adjustments = s.adjustments + 1;
+  cac_trim_skip = c.settle;
+}
+
+// Check the CAC flags - from loop() when not using interrupts, and from the handlers
+inline bool cac_trim_poll() {
+  unsigned char st = CASTR::read();
+  if(st & (1 << CASTR_OVFF)) {
+    CAICR::modify(CAICR::OVFFCL.set<1>());
+    cac_trim_state.overflows = cac_trim_state.overflows + 1;
+  }
+  if(!(st & (1 << CASTR_MENDF))) return false;
+  unsigned int count = CACNTBR::read();
+  CAICR::modify(CAICR::MENDFCL.set<1>());
+  cac_trim_update(count);
+  return true;
+}
+
+inline void cac_trim_mendi_isr() { irq_ack(cac_trim_cfg.slot_mend); cac_trim_poll(); }
+inline void cac_trim_ovfi_isr()  { irq_ack(cac_trim_cfg.slot_ovf);  cac_trim_poll(); }
+
+inline bool cac_trim_start(const CacTrimConfig &cfg) {
+  if(cfg.target != CAC_HOCO && cfg.target != CAC_MOCO && cfg.target != CAC_LOCO) return false;
+  cac_trim_cfg = cfg;
+  cac_trim_nominal = cac_nominal_hz(cfg.target);
+  cac_trim_plan = cac_plan(cfg.target, cac_trim_nominal, cfg.ref, cfg.ref_hz);
+  if(cac_trim_plan.expected < 16) return false;  // Nothing gives a useful count
+
+  CacTrimState &s = cac_trim_state;
+  s.error_ppm = 0;
+  s.hz = 0;
+  s.trim = cac_trim_read(cfg.target);
+  s.locked = false;
+  s.measurements = s.overflows = s.adjustments = 0;
+  s.ppm_per_step = cfg.ppm_per_step ? cfg.ppm_per_step : CAC_TRIM_PPM_STEP_GUESS;
+  cac_trim_sum = 0;
+  cac_trim_n = 0;
+  cac_trim_skip = cfg.settle;  // The first measurement may have started before the setup
+  cac_trim_last_step = 0;
+
+  const CacPlan &p = cac_trim_plan;
+  Bit<MSTPCRC, MSTPC0>::write(0);  // CAC out of module-stop
+  CACR0::write(0);
+  CACR1::assign(CACR1::CACREFE = p.pin, CACR1::FMCS = p.fmcs, CACR1::TCSS = p.tcss, CACR1::EDGES.set<0>());
+  CACR2::assign(CACR2::RPS = !p.pin, CACR2::RSCS = p.rscs, CACR2::RCDS = p.rcds, CACR2::DFS.set<0>());
+  CAULVR::write(0xFFFF);  // No frequency error interrupt - the limits are not used
+  CALLVR::write(0);
+  bool irq = cfg.slot_mend < IRQ_SLOTS;
+  CAICR::assign(CAICR::FERRFCL.set<1>(), CAICR::MENDFCL.set<1>(), CAICR::OVFFCL.set<1>(), CAICR::MENDIE = irq, CAICR::OVFIE = cfg.slot_ovf < IRQ_SLOTS);
+  if(irq) irq_link(cfg.slot_mend, IRQ_CAC_MENDI, cfg.priority, cac_trim_mendi_isr);
+  if(cfg.slot_ovf < IRQ_SLOTS) irq_link(cfg.slot_ovf, IRQ_CAC_OVFI, cfg.priority, cac_trim_ovfi_isr);
+  CACR0::write(1 << CACR0_CFME);
+  return true;
+}
+
+inline void cac_trim_stop() {
+  CACR0::write(0);
+  CAICR::assign(CAICR::FERRFCL.set<1>(), CAICR::MENDFCL.set<1>(), CAICR::OVFFCL.set<1>());
+  if(cac_trim_cfg.slot_mend < IRQ_SLOTS) irq_unlink(cac_trim_cfg.slot_mend);
+  if(cac_trim_cfg.slot_ovf < IRQ_SLOTS) irq_unlink(cac_trim_cfg.slot_ovf);
+}
+
+
+#ifdef RA4M1_HOST_SIM
+// ==== Simulated CAC ====
+// Oscillator frequency = nominal * (1 + (offset + trim * ppm_per_step) / 10^6), trim from the
+// *_UTRM register in the image. measure() does one CAC measurement with the CACR1 / CACR2 settings
+// in the image: CACNTBR, CASTR, and the MENDI / OVFI interrupts.
+//
+//   ra4m1::sim_reset();
+//   ra4m1::SimCac cac;  cac.hoco_offset_ppm = 9000;  cac.attach();
+//   ra4m1::cac_trim_start(cfg);
+//   for(int i = 0; i < 200; i++) cac.measure();
+
+struct SimCac {
+  long hoco_offset_ppm = 0;
+  long moco_offset_ppm = 0;
+  long loco_offset_ppm = 0;
+  double ppm_per_step = 350;       // Trim register sensitivity
+  unsigned long mosc_hz = 12000000;
+  unsigned long sosc_hz = 32768;
+  unsigned long pclkb_hz = 24000000;
+  unsigned long iwdt_hz = 15000;
+  unsigned long pin_hz = 0;        // CACREF
+  unsigned int noise = 0;          // +/- counts of edge jitter
+  unsigned int seed = 1;
+
+  // CAICR flag clear bits clear CASTR, as on the chip
+  void attach() {
+    sim_on_write(CACBASE + 0x4603, [](unsigned int, unsigned int v) {
+      unsigned int clear = (v >> CAICR_FERRFCL) & 0x7;
+      sim_poke<unsigned char>(CACBASE + 0x4604, (unsigned char)(sim_peek<unsigned char>(CACBASE + 0x4604) & ~clear));
+      return v & 0x0F;
+    });
+  }
+
+  double trimmed(unsigned long nominal, long offset, unsigned int trim_addr) const {
+    return nominal * (1.0 + (offset + (signed char)sim_peek<unsigned char>(trim_addr) * ppm_per_step) / 1e6);
+  }
+
+  double clock_hz(unsigned int sel) const {
+    switch(sel) {
+      case CAC_MOSC:  return mosc_hz;
+      case CAC_SOSC:  return sosc_hz;
+      case CAC_HOCO:  return trimmed(hoco_hz(), hoco_offset_ppm, SYSTEM + 0xE062);
+      case CAC_MOCO:  return trimmed(8000000, moco_offset_ppm, SYSTEM + 0xE061);
+      case CAC_LOCO:  return trimmed(32768, loco_offset_ppm, SYSTEM + 0xE492);
+      case CAC_PCLKB: return pclkb_hz;
+      case CAC_IWDT:  return iwdt_hz;
+    }
+    return 0;
+  }
+
+  void measure() {
+    if(!(sim_peek<unsigned char>(CACBASE + 0x4600) & (1 << CACR0_CFME))) return;
+    unsigned char r1 = sim_peek<unsigned char>(CACBASE + 0x4601);
+    unsigned char r2 = sim_peek<unsigned char>(CACBASE + 0x4602);
+    unsigned char caicr = sim_peek<unsigned char>(CACBASE + 0x4603);
+    double counted = clock_hz((r1 >> CACR1_FMCS_2_0) & 7) / cac_tcss_div((r1 >> CACR1_TCSS_1_0) & 3);
+    double ref = (r2 & (1 << CACR2_RPS)) ? clock_hz((r2 >> CACR2_RSCS_2_0) & 7) : (double)pin_hz;
+    double n = counted * cac_rcds_div((r2 >> CACR2_RCDS_1_0) & 3) / ref;
+    if(noise) {
+      seed = seed * 1103515245 + 12345;
+      n += (double)((seed >> 16) % (2 * noise + 1)) - noise;
+    }
+    unsigned char st = sim_peek<unsigned char>(CACBASE + 0x4604);
+    if(n > 0xFFFF) {
+      sim_poke<unsigned char>(CACBASE + 0x4604, (unsigned char)(st | (1 << CASTR_OVFF)));
+      if(caicr & (1 << CAICR_OVFIE)) sim_irq_raise(IRQ_CAC_OVFI);
+      return;
+    }
+    sim_poke<unsigned short>(CACBASE + 0x460A, (unsigned short)(n + 0.5));
+    sim_poke<unsigned char>(CACBASE + 0x4604, (unsigned char)(st | (1 << CASTR_MENDF)));
+    if(caicr & (1 << CAICR_MENDIE)) sim_irq_raise(IRQ_CAC_MENDI);
+  }
+};
+#endif
+
+}  // namespace ra4m1
+
+#endif  // SUSAN_RA4M1_MINIMA_CAC_TRIM_H
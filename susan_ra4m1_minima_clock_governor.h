@@ -0,0 +1,483 @@
+/*  Arduino UNO R4 Minima - dynamic clock scaling with peripheral re-timing for the RA4M1:
+ *
+ *  Drop ICLK to the MOCO (or LOCO) when there is nothing to do, jump back to 48 MHz when there is,
+ *  and keep every registered peripheral running at the same baud / bit rate / PWM frequency across
+ *  the change. All new SCI BRR / MDDR, SPI SPBR, IIC ICBRL / ICBRH, GPT GTPR, and AGT compare values
+ *  are worked out first; then, with interrupts off, SCKSCR / SCKDIVCR are switched under PRCR and
+ *  the peripherals rewritten, all in one short critical section.
+ *
+ *    typedef ra4m1::ClockTree<ra4m1::CLK_MOCO, 8000000, 8000000, 8000000, 8000000, 8000000, 8000000, 8000000> Slow;
+ *    ra4m1::gov_points(ra4m1::clock_point<ra4m1::ClocksArduino>(), ra4m1::clock_point<Slow>());
+ *    ra4m1::gov_add_sci(2, 115200);          // Serial1 - SCI2
+ *    ra4m1::gov_add_agt(0, 1000);            // The Arduino millis() tick
+ *    ra4m1::gov_add_gpt(4, 20000);           // 20 kHz PWM on GPT164
+ *
+ *    loop: if(work) ra4m1::gov_busy(); else ra4m1::gov_idle();
+ *
+ *  A switch that would break a registered peripheral - 115200 baud from a 32 kHz PCLKB - is refused,
+ *  and the clock stays where it is. Before switching, the governor waits for each SCI to finish
+ *  sending (SSR_TEND), each SPI to go idle, and each IIC bus to be free, then checks again with
+ *  interrupts off.
+ *
+ *  GPT channels run with GTPR / GTCCRA / GTCCRB buffer operation (set by gov_add_gpt), so the new
+ *  period and duty land together at the next overflow - no runt pulse. The period in progress
+ *  finishes at the new clock. Only when the period no longer fits the prescaler is the timer
+ *  stopped and restarted, counted in gov_stats.restarts.
+ *
+ *  gov_stats has the latency of the last switch: oscillator start, waiting for the peripherals, and
+ *  the critical section itself, each with the ICLK its cycles were counted at.
+ *
+ *  Note: Characters arriving at an SCI in the few microseconds of the switch can be lost - there is
+ *        no receive-busy flag to wait on. Operating power mode (OPCCR) is left as it is.
+ *        USB runs from the HOCO on the Minima, so it is only stopped when stop_unused is set.
+ *
+ * This code is "AS IS" without warranty or liability.
+ * GPL v3 or later - see susan_ra4m1_minima_register_defines.h
+*/
+
+#ifndef SUSAN_RA4M1_MINIMA_CLOCK_GOVERNOR_H
+#define SUSAN_RA4M1_MINIMA_CLOCK_GOVERNOR_H
+
+#include "susan_ra4m1_minima_clocks.h"
+#include "susan_ra4m1_minima_irq.h"
+
+#ifndef RA4M1_GOV_PERIPHERALS
+#define RA4M1_GOV_PERIPHERALS 12
+#endif
+
+namespace ra4m1 {
+
+// A ClockTree at run time
+struct ClockPoint {
+  ClockSource source;
+  unsigned long source_hz;
+  unsigned long clock_hz;
+  unsigned int sckdivcr;
+  unsigned char sckscr;
+  unsigned char pllccr2;
+  unsigned char memwait;
+  unsigned long iclk, pclka, pclkb, pclkc, pclkd, fclk;
+};
+
+template <typename Tree>
+constexpr ClockPoint clock_point() {
+  return ClockPoint{Tree::source, Tree::source_hz, Tree::clock_hz, Tree::sckdivcr, Tree::sckscr, Tree::pllccr2, Tree::memwait,
+                    Tree::iclk, Tree::pclka, Tree::pclkb, Tree::pclkc, Tree::pclkd, Tree::fclk};
+}
+
+// What is running now, read back from the registers
+inline ClockPoint clock_point_now(unsigned long mosc_hz = 0) {
+  ClockPoint p{};
+  p.source = (ClockSource)SCKSCR::CKSEL.read();
+  p.source_hz = (p.source == CLK_MOSC || p.source == CLK_PLL) ? mosc_hz : clock_source_hz_now(mosc_hz);
+  p.clock_hz = clock_source_hz_now(mosc_hz);
+  p.sckdivcr = SCKDIVCR::read() & SCKDIVCR_FIELDS;
+  p.sckscr = SCKSCR::read();
+  p.pllccr2 = PLLCCR2::read();
+  p.memwait = MEMWAIT::read();
+  p.iclk  = p.clock_hz >> ((p.sckdivcr >> SCKDIVCR_ICK_2_0) & 7);
+  p.pclka = p.clock_hz >> ((p.sckdivcr >> SCKDIVCR_PCKA_2_0) & 7);
+  p.pclkb = p.clock_hz >> ((p.sckdivcr >> SCKDIVCR_PCKB_2_0) & 7);
+  p.pclkc = p.clock_hz >> ((p.sckdivcr >> SCKDIVCR_PCKC_2_0) & 7);
+  p.pclkd = p.clock_hz >> ((p.sckdivcr >> SCKDIVCR_PCKD_2_0) & 7);
+  p.fclk  = p.clock_hz >> ((p.sckdivcr >> SCKDIVCR_FCK_2_0) & 7);
+  return p;
+}
+
+
+// ==== Registered peripherals ====
+
+enum GovKind : unsigned char { GOV_SCI, GOV_SPI, GOV_IIC, GOV_GPT, GOV_AGT, GOV_CUSTOM };
+
+// Custom re-timing: called in the critical section after the clock switch, false refuses 'to'
+// when called with apply = false before it
+typedef bool (*GovRetime)(const ClockPoint &from, const ClockPoint &to, bool apply, void *ctx);
+
+struct GovPeripheral {
+  GovKind kind;
+  unsigned char unit;      // SCI 0 / 1 / 2 / 9, SPI 0 / 1, IIC 0 / 1, GPT 0 - 7, AGT 0 / 1
+  unsigned long rate;      // Baud, bit rate, or period frequency
+  unsigned short rise_ns;  // IIC SCL rise / fall
+  unsigned short fall_ns;
+  GovRetime fn;
+  void *ctx;
+  unsigned int staged[4];  // New register values, from gov_prepare()
+};
+
+inline GovPeripheral gov_table[RA4M1_GOV_PERIPHERALS];
+inline unsigned int gov_count = 0;
+
+constexpr long GOV_SCI_ERROR_PPM = 20000;  // Refuse a clock that puts a baud rate more than 2% out
+
+inline unsigned int gov_sci_base(unsigned int unit) { return SCIBASE + 0x20 * unit; }
+inline unsigned int gov_spi_base(unsigned int unit) { return SPIBASE + 0x2000 + 0x100 * unit; }
+inline unsigned int gov_iic_base(unsigned int unit) { return IICBASE + 0x3000 + 0x100 * unit; }
+inline unsigned int gov_gpt_base(unsigned int unit) { return GPTBASE + 0x100 * unit; }  // Add GTCR, GTPR, etc.
+inline unsigned int gov_agt_base(unsigned int unit) { return AGTBASE + 0x100 * unit; }
+
+inline bool gov_add(GovKind kind, unsigned int unit, unsigned long rate, GovRetime fn = nullptr, void *ctx = nullptr) {
+  if(gov_count >= RA4M1_GOV_PERIPHERALS) return false;
+  gov_table[gov_count++] = GovPeripheral{kind, (unsigned char)unit, rate, 0, 0, fn, ctx, {0, 0, 0, 0}};
+  return true;
+}
+
+inline bool gov_add_sci(unsigned int unit, unsigned long baud) { return gov_add(GOV_SCI, unit, baud); }
+inline bool gov_add_spi(unsigned int unit, unsigned long hz)   { return gov_add(GOV_SPI, unit, hz); }
+inline bool gov_add_agt(unsigned int unit, unsigned long hz)   { return gov_add(GOV_AGT, unit, hz); }
+inline bool gov_add_custom(GovRetime fn, void *ctx = nullptr)  { return gov_add(GOV_CUSTOM, 0, 0, fn, ctx); }
+
+inline bool gov_add_iic(unsigned int unit, unsigned long hz, unsigned short rise_ns = 120, unsigned short fall_ns = 120) {
+  if(!gov_add(GOV_IIC, unit, hz)) return false;
+  gov_table[gov_count - 1].rise_ns = rise_ns;
+  gov_table[gov_count - 1].fall_ns = fall_ns;
+  return true;
+}
+
+// Also turns on single buffer operation for GTPR / GTCCRA / GTCCRB - from then on, write new
+// duty values to GTCCRC / GTCCRE, and they take effect at the next overflow
+inline bool gov_add_gpt(unsigned int unit, unsigned long hz) {
+  if(!gov_add(GOV_GPT, unit, hz)) return false;
+  unsigned int b = gov_gpt_base(unit);
+  unsigned int gtber = mmio_read<unsigned int>(b + GTBER);
+  gtber &= ~((3u << GTBER_CCRA_1_0) | (3u << GTBER_CCRB_1_0) | (3u << GTBER_PR_1_0) | (0xFu << GTBER_BD_3_0));
+  mmio_write<unsigned int>(b + GTBER, gtber | (1u << GTBER_CCRA_1_0) | (1u << GTBER_CCRB_1_0) | (1u << GTBER_PR_1_0));
+  mmio_write<unsigned int>(b + GTPBR, mmio_read<unsigned int>(b + GTPR));
+  mmio_write<unsigned int>(b + GTCCRC, mmio_read<unsigned int>(b + GTCCRA));
+  mmio_write<unsigned int>(b + GTCCRE, mmio_read<unsigned int>(b + GTCCRB));
+  return true;
+}
+
+inline void gov_clear() { gov_count = 0; }
+
+// AGTMR1_TCK divider from PCLKB, 0 for a count source that does not come from PCLKB
+inline unsigned int gov_agt_div(unsigned int unit) {
+  switch((mmio_read<unsigned char>(gov_agt_base(unit) + 0x009) >> AGTMR1_TCK_2_0) & 7) {
+    case 0: return 1;
+    case 1: return 8;
+    case 3: return 2;
+  }
+  return 0;
+}
+
+// New register values for 'to', or false if a peripheral can't run from it
+inline bool gov_prepare(GovPeripheral &p, const ClockPoint &from, const ClockPoint &to) {
+  switch(p.kind) {
+    case GOV_SCI: {
+      SciBaud b = sci_baud(to.pclkb, p.rate);
+      if(!b.ok || b.error_ppm > GOV_SCI_ERROR_PPM || b.error_ppm < -GOV_SCI_ERROR_PPM) return false;
+      p.staged[0] = b.cks;
+      p.staged[1] = b.brr;
+      p.staged[2] = b.mddr;
+      p.staged[3] = sci_semr(b);
+      return true;
+    }
+    case GOV_SPI: {
+      SpiBitRate s = spi_bitrate(to.pclka, p.rate);
+      p.staged[0] = s.spbr;
+      p.staged[1] = s.brdv;
+      return s.ok;
+    }
+    case GOV_IIC: {
+      IicBitRate i = iic_bitrate(to.pclkb, p.rate, p.rise_ns, p.fall_ns);
+      p.staged[0] = i.cks;
+      p.staged[1] = i.icbrl;
+      p.staged[2] = i.icbrh;
+      return i.ok;
+    }
+    case GOV_GPT: {
+      unsigned int b = gov_gpt_base(p.unit);
+      unsigned int tpcs = (mmio_read<unsigned int>(b + GTCR) >> GTCR_TPCS_2_0) & 7;
+      unsigned long long max = p.unit < 2 ? 0x100000000ULL : 0x10000ULL;  // GPT320 / GPT321 are 32 bit
+      unsigned long long n1 = (((unsigned long long)to.pclkd >> (2 * tpcs)) + p.rate / 2) / p.rate;
+      if(n1 >= 2 && n1 <= max) {
+        p.staged[0] = (unsigned int)(n1 - 1);
+        p.staged[1] = tpcs;
+        p.staged[2] = 0;  // Buffered, no restart
+        return true;
+      }
+      GptPeriod g = gpt_period(to.pclkd, p.rate, p.unit < 2);
+      p.staged[0] = g.gtpr;
+      p.staged[1] = g.tpcs;
+      p.staged[2] = 1;  // New prescaler - stop and restart
+      return g.ok;
+    }
+    case GOV_AGT: {
+      unsigned int div = gov_agt_div(p.unit);
+      p.staged[2] = div;
+      if(div == 0) return true;  // LOCO / SOSC count source - not affected
+      unsigned long n_to = to.pclkb / div / p.rate;
+      unsigned long n_from = from.pclkb / div / p.rate;
+      p.staged[0] = (unsigned int)(n_to - 1);
+      p.staged[1] = (unsigned int)n_from;
+      return n_to >= 1 && n_to <= 0x10000 && n_from >= 1;
+    }
+    case GOV_CUSTOM:
+      return p.fn(from, to, false, p.ctx);
+  }
+  return false;
+}
+
+// Nothing in flight that a rate change would corrupt
+inline bool gov_quiet(const GovPeripheral &p) {
+  switch(p.kind) {
+    case GOV_SCI: {
+      unsigned int b = gov_sci_base(p.unit);
+      if(!(mmio_read<unsigned char>(b + 0x02) & (1 << SCR_TE))) return true;
+      return mmio_read<unsigned char>(b + 0x04) & (1 << SSR_TEND);
+    }
+    case GOV_SPI: {
+      unsigned int b = gov_spi_base(p.unit);
+      if(!(mmio_read<unsigned char>(b + 0x00) & (1 << SPCR_SPE))) return true;
+      return !(mmio_read<unsigned char>(b + 0x03) & (1 << SPSR_IDLNF));
+    }
+    case GOV_IIC:
+      return !(mmio_read<unsigned char>(gov_iic_base(p.unit) + 0x01) & (1 << ICCR2_BBSY));
+    default:
+      return true;
+  }
+}
+
+// In the critical section, with the new clock already running
+inline void gov_apply(GovPeripheral &p, const ClockPoint &from, const ClockPoint &to, unsigned int &restarts) {
+  switch(p.kind) {
+    case GOV_SCI: {
+      unsigned int b = gov_sci_base(p.unit);
+      unsigned char scr = mmio_read<unsigned char>(b + 0x02);
+      mmio_write<unsigned char>(b + 0x02, (unsigned char)(scr & ~((1 << SCR_TE) | (1 << SCR_RE))));  // BRR only changes with TE = RE = 0
+      mmio_write<unsigned char>(b + 0x00, (unsigned char)((mmio_read<unsigned char>(b + 0x00) & ~(3 << SCI_CKS_1_0)) | (p.staged[0] << SCI_CKS_1_0)));
+      mmio_write<unsigned char>(b + 0x01, (unsigned char)p.staged[1]);
+      mmio_write<unsigned char>(b + 0x12, (unsigned char)p.staged[2]);
+      unsigned char semr = mmio_read<unsigned char>(b + 0x07) & ~((1 << SEMR_BGDM) | (1 << SEMR_ABCS) | (1 << SEMR_BRME));
+      mmio_write<unsigned char>(b + 0x07, (unsigned char)(semr | p.staged[3]));
+      mmio_write<unsigned char>(b + 0x02, scr);
+      break;
+    }
+    case GOV_SPI: {
+      unsigned int b = gov_spi_base(p.unit);
+      unsigned char spcr = mmio_read<unsigned char>(b + 0x00);
+      mmio_write<unsigned char>(b + 0x00, (unsigned char)(spcr & ~(1 << SPCR_SPE)));
+      mmio_write<unsigned char>(b + 0x0A, (unsigned char)p.staged[0]);
+      unsigned short cmd = mmio_read<unsigned short>(b + 0x10) & ~(3 << SPCMD0_BRDV_0_1);
+      mmio_write<unsigned short>(b + 0x10, (unsigned short)(cmd | (p.staged[1] << SPCMD0_BRDV_0_1)));
+      mmio_write<unsigned char>(b + 0x00, spcr);
+      break;
+    }
+    case GOV_IIC: {
+      unsigned int b = gov_iic_base(p.unit);
+      unsigned char icmr1 = mmio_read<unsigned char>(b + 0x02) & ~(7 << ICMR1_CKS_2_0);
+      mmio_write<unsigned char>(b + 0x02, (unsigned char)(icmr1 | (p.staged[0] << ICMR1_CKS_2_0) | (1 << ICMR1_BCWP)));
+      mmio_write<unsigned char>(b + 0x10, (unsigned char)(0xE0 | p.staged[1]));
+      mmio_write<unsigned char>(b + 0x11, (unsigned char)(0xE0 | p.staged[2]));
+      break;
+    }
+    case GOV_GPT: {
+      unsigned int b = gov_gpt_base(p.unit);
+      unsigned long long was = (unsigned long long)mmio_read<unsigned int>(b + GTPBR) + 1;
+      unsigned long long now = (unsigned long long)p.staged[0] + 1;
+      unsigned int a = (unsigned int)(mmio_read<unsigned int>(b + GTCCRC) * now / was);  // Same duty
+      unsigned int c = (unsigned int)(mmio_read<unsigned int>(b + GTCCRE) * now / was);
+      if(p.staged[2]) {
+        unsigned int gtcr = mmio_read<unsigned int>(b + GTCR);
+        mmio_write<unsigned int>(b + GTCR, gtcr & ~(1u << GTCR_CST));
+        mmio_write<unsigned int>(b + GTCR, (gtcr & ~((1u << GTCR_CST) | (7u << GTCR_TPCS_2_0))) | (p.staged[1] << GTCR_TPCS_2_0));
+        mmio_write<unsigned int>(b + GTCNT, 0u);
+        mmio_write<unsigned int>(b + GTPR, p.staged[0]);
+        mmio_write<unsigned int>(b + GTCCRA, a);
+        mmio_write<unsigned int>(b + GTCCRB, c);
+      }
+      mmio_write<unsigned int>(b + GTPBR, p.staged[0]);
+      mmio_write<unsigned int>(b + GTCCRC, a);
+      mmio_write<unsigned int>(b + GTCCRE, c);
+      if(p.staged[2]) {
+        mmio_write<unsigned int>(b + GTCR, mmio_read<unsigned int>(b + GTCR) | (1u << GTCR_CST));
+        restarts++;
+      }
+      break;
+    }
+    case GOV_AGT: {
+      if(p.staged[2] == 0) break;
+      unsigned int b = gov_agt_base(p.unit);
+      unsigned long was = p.staged[1];
+      unsigned long now = p.staged[0] + 1;
+      mmio_write<unsigned short>(b + 0x000, (unsigned short)p.staged[0]);  // Reload - the counter picks it up at underflow
+      mmio_write<unsigned short>(b + 0x002, (unsigned short)(mmio_read<unsigned short>(b + 0x002) * now / was));
+      mmio_write<unsigned short>(b + 0x004, (unsigned short)(mmio_read<unsigned short>(b + 0x004) * now / was));
+      break;
+    }
+    case GOV_CUSTOM:
+      p.fn(from, to, true, p.ctx);
+      break;
+  }
+}
+
+
+// ==== Switching ====
+
+enum GovResult : unsigned char {
+  GOV_OK = 0,
+  GOV_SAME,          // Already there
+  GOV_REFUSED,       // A registered peripheral can't run at the new clock
+  GOV_BUSY,          // A peripheral stayed busy past the timeout
+  GOV_OSC_TIMEOUT    // The new clock source did not stabilize
+};
+
+struct GovConfig {
+  unsigned long mosc_hz = 0;           // Crystal, when MOSC or PLL points are used
+  unsigned long timeout_us = 20000;    // Oscillator start, and waiting for the peripherals
+  bool stop_unused = false;            // Stop the oscillator switched away from
+};
+
+struct GovStats {
+  ClockPhase osc;        // Starting the new source, at the old ICLK
+  ClockPhase quiet;      // Waiting for the peripherals, at the old ICLK
+  ClockPhase cs_old;     // Critical section up to the clock switch, at the old ICLK
+  ClockPhase cs_new;     // Critical section after the switch - peripheral rewrites, at the new ICLK
+  unsigned int switches;
+  unsigned int refused;
+  unsigned int restarts;  // GPT channels that had to be stopped for a new prescaler
+  GovResult last;
+  unsigned int latency_us() const { return osc.us() + quiet.us() + cs_old.us() + cs_new.us(); }
+  unsigned int critical_us() const { return cs_old.us() + cs_new.us(); }
+};
+
+inline GovConfig gov_cfg;
+inline GovStats gov_stats;
+inline ClockPoint gov_fast_point;
+inline ClockPoint gov_slow_point;
+
+inline bool gov_osc_running(ClockSource s) {
+  unsigned char sf = OSCSF::read();
+  switch(s) {
+    case CLK_HOCO: return !HOCOCR::HCSTP.read() && (sf & (1 << OSCSF_HOCOSF));
+    case CLK_MOSC: return !MOSCCR::MOSTP.read() && (sf & (1 << OSCSF_MOSCSF));
+    case CLK_PLL:  return !PLLCR::PLLSTP.read() && (sf & (1 << OSCSF_PLLSF));
+    case CLK_MOCO: return !MOCOCR::MCSTP.read();
+    case CLK_LOCO: return !LOCOCR::LCSTP.read();
+    default: return true;
+  }
+}
+
+// Start the source of 'to' if it is not already running - PRC0 must be unlocked
+inline bool gov_osc_start(const ClockPoint &to, ClockPhase &p) {
+  if(gov_osc_running(to.source) && (to.source != CLK_PLL || PLLCCR2::read() == to.pllccr2)) return true;
+  unsigned long timeout = gov_cfg.timeout_us;
+  switch(to.source) {
+    case CLK_HOCO:
+      HOCOWTCR::write(hoco_hz() == 64000000 ? HOCO_WAIT_64MHZ : HOCO_WAIT);
+      HOCOCR::write(0);
+      return clock_spin(OSCSF::HOCOSF, 1, timeout, p);
+    case CLK_MOCO:
+      MOCOCR::write(0);
+      return true;
+    case CLK_LOCO: {
+      LOCOCR::write(0);  // No stabilization flag - give it 100 us
+      unsigned int t0 = cycles(), wait = (unsigned int)((unsigned long long)p.iclk * 100 / 1000000);
+      while(cycles() - t0 < wait) {}
+      p.cycles += cycles() - t0;
+      return true;
+    }
+    case CLK_MOSC:
+    case CLK_PLL:
+      if(MOSCCR::MOSTP.read()) MOSCCR::write(0);  // MOMCR / MOSCWTCR as left by clock_start()
+      if(!clock_spin(OSCSF::MOSCSF, 1, timeout, p)) return false;
+      if(to.source == CLK_MOSC) return true;
+      if(SCKSCR::CKSEL.read() == CLK_PLL) return false;  // Can't reprogram the PLL the CPU runs from
+      if(!PLLCR::PLLSTP.read()) {
+        PLLCR::write(1);
+        if(!clock_spin(OSCSF::PLLSF, 0, timeout, p)) return false;
+      }
+      PLLCCR2::write(to.pllccr2);
+      PLLCR::write(0);
+      return clock_spin(OSCSF::PLLSF, 1, timeout, p);
+    default:
+      return false;
+  }
+}
+
+inline void gov_osc_stop(ClockSource s, const ClockPoint &to) {
+  if(s == to.source) return;
+  if(s == CLK_HOCO) HOCOCR::write(1);
+  if(s == CLK_PLL) PLLCR::write(1);
+  if(s == CLK_MOSC && to.source != CLK_PLL) MOSCCR::write(1);
+}
+
+inline GovResult gov_switch(const ClockPoint &to) {
+  constexpr unsigned short key = PRCR_PRKEY << PRCR_PRKEY_7_0;
+  GovStats &s = gov_stats;
+  ClockPoint from = clock_point_now(gov_cfg.mosc_hz);
+  if(from.sckscr == to.sckscr && from.sckdivcr == (to.sckdivcr & SCKDIVCR_FIELDS) && (to.source != CLK_PLL || from.pllccr2 == to.pllccr2))
+    return s.last = GOV_SAME;
+
+  s.osc = s.quiet = s.cs_old = ClockPhase();
+  s.osc.iclk = s.quiet.iclk = s.cs_old.iclk = from.iclk;
+  s.cs_new = ClockPhase();
+  s.cs_new.iclk = to.iclk;
+
+  // Everything worked out before anything changes
+  for(unsigned int i = 0; i < gov_count; i++) {
+    if(!gov_prepare(gov_table[i], from, to)) {
+      s.refused++;
+      return s.last = GOV_REFUSED;
+    }
+  }
+
+  unsigned short prcr = PRCR::read() & 0xFF;
+  PRCR::write((unsigned short)(key | prcr | (1 << PRCR_PRC0)));
+  bool ok = gov_osc_start(to, s.osc);
+  PRCR::write((unsigned short)(key | prcr));
+  if(!ok) return s.last = GOV_OSC_TIMEOUT;
+
+  unsigned int timeout = (unsigned int)((unsigned long long)from.iclk * gov_cfg.timeout_us / 1000000);
+  unsigned int q0 = cycles();
+  for(;;) {
+    bool quiet = true;
+    for(unsigned int i = 0; i < gov_count && quiet; i++) quiet = gov_quiet(gov_table[i]);
+    if(quiet) {
+      unsigned int primask = irq_save();
+      for(unsigned int i = 0; i < gov_count && quiet; i++) quiet = gov_quiet(gov_table[i]);  // An ISR may have started one
+      if(quiet) {
+        s.quiet.cycles = cycles() - q0;
+        unsigned int c0 = cycles();
+        prcr = PRCR::read() & 0xFF;
+        PRCR::write((unsigned short)(key | prcr | (1 << PRCR_PRC0)));
+        if(to.memwait && !MEMWAIT::WAIT.read()) MEMWAIT::write(to.memwait);
+        if(to.clock_hz >= from.clock_hz) {
+          SCKDIVCR::write(to.sckdivcr);
+          SCKSCR::write(to.sckscr);
+        } else {
+          SCKSCR::write(to.sckscr);
+          SCKDIVCR::write(to.sckdivcr);
+        }
+        if(!to.memwait && MEMWAIT::WAIT.read()) MEMWAIT::write(0);
+        unsigned int c1 = cycles();
+        for(unsigned int i = 0; i < gov_count; i++) gov_apply(gov_table[i], from, to, s.restarts);
+        if(gov_cfg.stop_unused) gov_osc_stop(from.source, to);
+        PRCR::write((unsigned short)(key | prcr));
+        unsigned int c2 = cycles();
+        irq_restore(primask);
+        s.cs_old.cycles = c1 - c0;
+        s.cs_new.cycles = c2 - c1;
+        s.switches++;
+        return s.last = GOV_OK;
+      }
+      irq_restore(primask);
+    }
+    if(cycles() - q0 > timeout) {
+      s.quiet.cycles = cycles() - q0;
+      return s.last = GOV_BUSY;
+    }
+  }
+}
+
+// Load / idle policy - two points, switch only on a change
+inline void gov_points(const ClockPoint &fast, const ClockPoint &slow) {
+  gov_fast_point = fast;
+  gov_slow_point = slow;
+}
+
+inline GovResult gov_busy() { return gov_switch(gov_fast_point); }
+inline GovResult gov_idle() { return gov_switch(gov_slow_point); }
+
+}  // namespace ra4m1
+
+#endif  // SUSAN_RA4M1_MINIMA_CLOCK_GOVERNOR_H
@@ -0,0 +1,500 @@
+/*  Arduino UNO R4 Minima - compile time clock tree solver and clock bring-up for the RA4M1 register defines:
+ *
+ *  Give it the clock source and the frequencies wanted, and it works out the SCKDIVCR, SCKSCR,
+ *  PLLCCR2, and MEMWAIT values - checking each of the ratio rules listed above SYSTEM_SCKDIVCR
+ *  with a static_assert, so a bad divider choice is a compile error rather than a hung board.
+ *  A frequency of 0 means as fast as that clock domain is allowed to run.
+ *
+ *    //                             source    source Hz  ICLK      PCLKA     PCLKB     PCLKC     PCLKD     FCLK
+ *    typedef ra4m1::ClockTree<ra4m1::CLK_HOCO, 48000000, 48000000, 48000000, 24000000, 48000000, 48000000, 24000000> Clocks;
+ *
+ *    *SYSTEM_SCKDIVCR = Clocks::sckdivcr;                      // 0x10000100 - what the Arduino bootloader sets
+ *    static_assert(Clocks::pclkb == 24000000);
+ *    constexpr auto baud = ra4m1::sci_baud(Clocks::pclkb, 115200);   // SMR_CKS, BRR, MDDR, SEMR bits
+ *
+ *  With CLK_PLL the source Hz is the main clock oscillator (MOSC) crystal, and PLLMUL / PLODIV are
+ *  chosen so that ICLK is reached exactly.
+ *
+ *  clock_start<Clocks>() then switches to it - see Bring-up below for the order and the timing.
+ *
+ *  Limits used, high-speed mode:
+ *    ICLK <= 48 MHz, PCLKA <= 48 MHz, PCLKB <= 32 MHz, PCLKC <= 64 MHz, PCLKD <= 64 MHz, FCLK <= 32 MHz
+ *    PLL input 4 MHz to 12.5 MHz, PLL output 24 MHz to 64 MHz, MEMWAIT = 1 when ICLK > 32 MHz
+ *
+ * This code is "AS IS" without warranty or liability.
+ * GPL v3 or later - see susan_ra4m1_minima_register_defines.h
+*/
+
+#ifndef SUSAN_RA4M1_MINIMA_CLOCKS_H
+#define SUSAN_RA4M1_MINIMA_CLOCKS_H
+
+#include "susan_ra4m1_minima_register_types.h"
+
+namespace ra4m1 {
+
+// SCKSCR_CKSEL values - See 8.2.2
+enum ClockSource : unsigned char {
+  CLK_HOCO = 0,
+  CLK_MOCO = 1,
+  CLK_LOCO = 2,
+  CLK_MOSC = 3,
+  CLK_SOSC = 4,
+  CLK_PLL  = 5
+};
+
+constexpr unsigned long ICLK_MAX  = 48000000;
+constexpr unsigned long PCLKA_MAX = 48000000;
+constexpr unsigned long PCLKB_MAX = 32000000;
+constexpr unsigned long PCLKC_MAX = 64000000;
+constexpr unsigned long PCLKD_MAX = 64000000;
+constexpr unsigned long FCLK_MAX  = 32000000;
+constexpr unsigned long MEMWAIT_ABOVE = 32000000;  // ICLK above this needs MEMWAIT = 1
+
+constexpr unsigned long PLL_IN_MIN  =  4000000;
+constexpr unsigned long PLL_IN_MAX  = 12500000;
+constexpr unsigned long PLL_OUT_MIN = 24000000;
+constexpr unsigned long PLL_OUT_MAX = 64000000;
+
+constexpr unsigned int CLOCK_DIV_NONE = 7;  // No SCKDIVCR divider code fits
+
+
+// ==== Solver ====
+
+// Frequency the source runs at - false for a HOCO frequency OFS1_HOCOFRQ1 can't select, etc.
+constexpr bool clock_source_valid(ClockSource src, unsigned long hz) {
+  switch(src) {
+    case CLK_HOCO: return hz == 24000000 || hz == 32000000 || hz == 48000000 || hz == 64000000;
+    case CLK_MOCO: return hz == 8000000;
+    case CLK_LOCO:
+    case CLK_SOSC: return hz == 32768;
+    case CLK_MOSC: return hz >= 1000000 && hz <= 20000000;
+    case CLK_PLL:  return hz >= PLL_IN_MIN && hz <= PLL_IN_MAX;  // MOSC into the PLL
+  }
+  return false;
+}
+
+// SCKDIVCR code 0 to 6 for /1 to /64: hz exactly, or with hz = 0 the fastest not above max
+constexpr unsigned int clock_div_code(unsigned long clk, unsigned long hz, unsigned long max) {
+  for(unsigned int k = 0; k <= 6; k++) {
+    unsigned long f = clk >> k;
+    if(hz ? (f == hz && (f << k) == clk) : f <= max) return k;
+  }
+  return CLOCK_DIV_NONE;
+}
+
+constexpr unsigned long clock_divide(unsigned long clk, unsigned int code) {
+  return code == CLOCK_DIV_NONE ? 0 : clk >> code;
+}
+
+// PLLCCR2: PLLMUL 7 to 31 is x8 to x32, PLODIV 0 / 1 / 2 is /1 / /2 / /4
+struct PllSetting {
+  unsigned char pllmul;
+  unsigned char plodiv;
+  unsigned long hz;  // 0: nothing fits
+};
+
+// Lowest multiplier, so lowest VCO current, that gives ICLK exactly; iclk = 0 takes the fastest
+constexpr PllSetting pll_solve(unsigned long mosc, unsigned long iclk) {
+  PllSetting best{0, 0, 0};
+  if(mosc < PLL_IN_MIN || mosc > PLL_IN_MAX) return best;
+  for(unsigned int div = 0; div <= 2; div++) {
+    for(unsigned int mul = 8; mul <= 32; mul++) {
+      unsigned long out = (mosc * mul) >> div;
+      if(((out << div) != mosc * mul) || out < PLL_OUT_MIN || out > PLL_OUT_MAX) continue;
+      if(iclk == 0) {
+        if(out > best.hz) best = PllSetting{(unsigned char)(mul - 1), (unsigned char)div, out};
+      } else if(clock_div_code(out, iclk, 0) != CLOCK_DIV_NONE) {
+        if(best.hz == 0 || mul < best.pllmul + 1u) best = PllSetting{(unsigned char)(mul - 1), (unsigned char)div, out};
+      }
+    }
+  }
+  return best;
+}
+
+// PCLKB:PCLKC = 1:1 or 1:2 or 1:4 or 2:1 or 4:1 or 8:1
+constexpr bool pclkb_pclkc_ok(unsigned int pckb, unsigned int pckc) {
+  return pckc + 2 >= pckb && pckc <= pckb + 3;
+}
+
+template <ClockSource Source, unsigned long SourceHz, unsigned long IclkHz = 0,
+          unsigned long PclkaHz = 0, unsigned long PclkbHz = 0, unsigned long PclkcHz = 0,
+          unsigned long PclkdHz = 0, unsigned long FclkHz = 0>
+struct ClockTree {
+  static_assert(clock_source_valid(Source, SourceHz), "Source frequency - HOCO 24/32/48/64 MHz, MOCO 8 MHz, LOCO/SOSC 32768 Hz, MOSC 1-20 MHz, PLL input 4-12.5 MHz");
+
+  static constexpr PllSetting pll = Source == CLK_PLL ? pll_solve(SourceHz, IclkHz) : PllSetting{0, 0, 0};
+  static_assert(Source != CLK_PLL || pll.hz != 0, "No PLLMUL / PLODIV gives 24-64 MHz with ICLK an exact divide of it");
+
+  static constexpr unsigned long clock_hz = Source == CLK_PLL ? pll.hz : SourceHz;  // Into the SCKDIVCR dividers
+
+  // Divider codes - fastest allowed first for the domains left at 0
+  static constexpr unsigned int ick  = clock_div_code(clock_hz, IclkHz, ICLK_MAX);
+  static constexpr unsigned long iclk = clock_divide(clock_hz, ick);
+  static constexpr unsigned int pcka = clock_div_code(clock_hz, PclkaHz, iclk < PCLKA_MAX ? iclk : PCLKA_MAX);
+  static constexpr unsigned long pclka = clock_divide(clock_hz, pcka);
+  static constexpr unsigned int pckb = clock_div_code(clock_hz, PclkbHz, pclka < PCLKB_MAX ? pclka : PCLKB_MAX);
+  static constexpr unsigned long pclkb = clock_divide(clock_hz, pckb);
+  static constexpr unsigned int pckc = clock_div_code(clock_hz, PclkcHz, (pclkb << 2) < PCLKC_MAX ? (pclkb << 2) : PCLKC_MAX);
+  static constexpr unsigned long pclkc = clock_divide(clock_hz, pckc);
+  static constexpr unsigned int pckd = clock_div_code(clock_hz, PclkdHz, PCLKD_MAX);
+  static constexpr unsigned long pclkd = clock_divide(clock_hz, pckd);
+  static constexpr unsigned int fck  = clock_div_code(clock_hz, FclkHz, iclk < FCLK_MAX ? iclk : FCLK_MAX);
+  static constexpr unsigned long fclk = clock_divide(clock_hz, fck);
+
+  static_assert(ick  != CLOCK_DIV_NONE, "ICLK is not the source clock /1, /2, /4 ... /64");
+  static_assert(pcka != CLOCK_DIV_NONE, "PCLKA is not the source clock /1, /2, /4 ... /64");
+  static_assert(pckb != CLOCK_DIV_NONE, "PCLKB is not the source clock /1, /2, /4 ... /64");
+  static_assert(pckc != CLOCK_DIV_NONE, "PCLKC is not the source clock /1, /2, /4 ... /64");
+  static_assert(pckd != CLOCK_DIV_NONE, "PCLKD is not the source clock /1, /2, /4 ... /64");
+  static_assert(fck  != CLOCK_DIV_NONE, "FCLK is not the source clock /1, /2, /4 ... /64");
+
+  // Maximum frequencies
+  static_assert(iclk  <= ICLK_MAX,  "ICLK above 48 MHz");
+  static_assert(pclka <= PCLKA_MAX, "PCLKA above 48 MHz");
+  static_assert(pclkb <= PCLKB_MAX, "PCLKB above 32 MHz");
+  static_assert(pclkc <= PCLKC_MAX, "PCLKC above 64 MHz");
+  static_assert(pclkd <= PCLKD_MAX, "PCLKD above 64 MHz");
+  static_assert(fclk  <= FCLK_MAX,  "FCLK above 32 MHz");
+
+  // Restrictions on setting the clock frequency: ICLK >= PCLKA >= PCLKB, PCLKD >= PCLKA >= PCLKB, ICLK >= FCLK
+  static_assert(iclk >= pclka,  "ICLK must be >= PCLKA");
+  static_assert(pclka >= pclkb, "PCLKA must be >= PCLKB");
+  static_assert(pclkd >= pclka, "PCLKD must be >= PCLKA");
+  static_assert(iclk >= fclk,   "ICLK must be >= FCLK");
+
+  // Ratios - all the domains share one source, so N:1 or 1:N is a divider code difference of 0 to 6
+  static_assert(fck >= ick && fck - ick <= 6,   "ICLK:FCLK must be N:1");
+  static_assert(pcka >= ick && pcka - ick <= 6, "ICLK:PCLKA must be N:1");
+  static_assert(pckb >= ick && pckb - ick <= 6, "ICLK:PCLKB must be N:1");
+  static_assert(pclkb_pclkc_ok(pckb, pckc),     "PCLKB:PCLKC must be 1:1, 1:2, 1:4, 2:1, 4:1, or 8:1");
+
+  // Register values
+  static constexpr unsigned int sckdivcr = (fck << SCKDIVCR_FCK_2_0) | (ick << SCKDIVCR_ICK_2_0) |
+                                           (pcka << SCKDIVCR_PCKA_2_0) | (pckb << SCKDIVCR_PCKB_2_0) |
+                                           (pckc << SCKDIVCR_PCKC_2_0) | (pckd << SCKDIVCR_PCKD_2_0);
+  static constexpr unsigned char sckscr  = (unsigned char)(Source << SCKSCR_CKSEL_2_0);
+  static constexpr unsigned char pllccr2 = (unsigned char)((pll.pllmul << PLLCCR2_PLLMUL_4_0) | (pll.plodiv << PLLCCR2_PLODIV_1_0));
+  static constexpr unsigned char memwait = (unsigned char)((iclk > MEMWAIT_ABOVE ? 1 : 0) << MEMWAIT_MEMWAIT);
+
+  static constexpr ClockSource source = Source;
+  static constexpr unsigned long source_hz = SourceHz;
+  static constexpr bool uses_pll = Source == CLK_PLL;
+};
+
+constexpr unsigned int SCKDIVCR_FIELDS = 0x77007777;  // The divider fields - the values read back above SYSTEM_SCKDIVCR include reserved bits
+
+// After reset: MOCO, everything /16
+typedef ClockTree<CLK_MOCO, 8000000, 500000, 500000, 500000, 500000, 500000, 500000> ClocksReset;
+static_assert(ClocksReset::sckdivcr == (0x44044444 & SCKDIVCR_FIELDS), "SCKDIVCR after reset");
+
+// What the Arduino bootloader / IDE sets up
+typedef ClockTree<CLK_HOCO, 48000000, 48000000, 48000000, 24000000, 48000000, 48000000, 24000000> ClocksArduino;
+static_assert(ClocksArduino::sckdivcr == (0x10010100 & SCKDIVCR_FIELDS), "SCKDIVCR from the Arduino bootloader");
+static_assert(ClocksArduino::memwait == 1, "48 MHz ICLK needs MEMWAIT");
+
+
+// ==== Peripheral dividers ====
+// Take the clock domain frequency, e.g. Clocks::pclkb, so they work at compile time and at run time
+
+// SCI asynchronous: BRR = PCLKB / (base * 4^CKS * baud) - 1, base 32 / 16 / 8 with
+// SEMR_BGDM and SEMR_ABCS, and bit rate modulation (SEMR_BRME, MDDR / 256) when that is closer
+struct SciBaud {
+  unsigned char cks;   // SMR_CKS, PCLKB / 1, 4, 16, 64
+  unsigned char brr;
+  unsigned char mddr;  // 128 to 255 with brme, else 255
+  bool bgdm;
+  bool abcs;
+  bool brme;
+  long error_ppm;      // Actual baud vs wanted, 0 == exact
+  bool ok;
+};
+
+constexpr long clock_error_ppm(unsigned long long actual, unsigned long long wanted) {
+  return (long)(((long long)actual - (long long)wanted) * 1000000LL / (long long)wanted);
+}
+
+constexpr SciBaud sci_baud(unsigned long pclkb, unsigned long baud) {
+  SciBaud best{0, 0, 255, false, false, false, 0, false};
+  long best_err = 0x7FFFFFFF;
+  for(unsigned int cks = 0; cks <= 3; cks++) {
+    for(unsigned int m = 0; m <= 2; m++) {  // base 8, 16, 32 - smallest first, finest resolution
+      unsigned long long div = (8ULL << m) << (2 * cks);
+      unsigned long long n1 = (pclkb + div * baud / 2) / (div * baud);  // BRR + 1, rounded
+      if(n1 >= 1 && n1 <= 256) {
+        long err = clock_error_ppm(pclkb / (div * n1), baud);
+        if((err < 0 ? -err : err) < (best_err < 0 ? -best_err : best_err)) {
+          best = SciBaud{(unsigned char)cks, (unsigned char)(n1 - 1), 255, m < 2, m == 0, false, err, true};
+          best_err = err;
+        }
+      }
+      // Modulated: BRR rounded down so the clock is fast, then MDDR / 256 slows it to the baud
+      unsigned long long f1 = pclkb / (div * baud);
+      if(f1 >= 1 && f1 <= 256) {
+        unsigned long long mddr = (256ULL * baud * div * f1 + pclkb / 2) / pclkb;
+        if(mddr >= 128 && mddr <= 255) {
+          long err = clock_error_ppm(pclkb * mddr / (256ULL * div * f1), baud);
+          if((err < 0 ? -err : err) < (best_err < 0 ? -best_err : best_err)) {
+            best = SciBaud{(unsigned char)cks, (unsigned char)(f1 - 1), (unsigned char)mddr, m < 2, m == 0, true, err, true};
+            best_err = err;
+          }
+        }
+      }
+    }
+    if(best.ok && best_err == 0) break;
+  }
+  return best;
+}
+
+// SEMR bits to go with sci_baud()
+constexpr unsigned char sci_semr(const SciBaud &b) {
+  return (unsigned char)((b.bgdm << SEMR_BGDM) | (b.abcs << SEMR_ABCS) | (b.brme << SEMR_BRME));
+}
+
+// SPI: bit rate = PCLKA / (2 * (SPBR + 1) * 2^BRDV), never faster than asked
+struct SpiBitRate {
+  unsigned char spbr;
+  unsigned char brdv;  // SPCMD0_BRDV
+  unsigned long hz;    // Actual
+  bool ok;
+};
+
+constexpr SpiBitRate spi_bitrate(unsigned long pclka, unsigned long hz) {
+  for(unsigned int brdv = 0; brdv <= 3; brdv++) {
+    unsigned long long div = 2ULL << brdv;
+    unsigned long long n1 = (pclka + div * hz - 1) / (div * hz);  // SPBR + 1, rounded up
+    if(n1 >= 1 && n1 <= 256)
+      return SpiBitRate{(unsigned char)(n1 - 1), (unsigned char)brdv, (unsigned long)(pclka / (div * n1)), true};
+  }
+  return SpiBitRate{255, 3, 0, false};
+}
+
+// GPT: period = (GTPR + 1) * prescaler / PCLKD, GTCR TPCS 0 to 5 for /1 to /1024
+struct GptPeriod {
+  unsigned char tpcs;
+  unsigned int gtpr;
+  long error_ppm;
+  bool ok;
+};
+
+constexpr GptPeriod gpt_period(unsigned long pclkd, unsigned long hz, bool bits32 = false) {
+  unsigned long long max = bits32 ? 0x100000000ULL : 0x10000ULL;
+  for(unsigned int tpcs = 0; tpcs <= 5; tpcs++) {
+    unsigned long long clk = (unsigned long long)pclkd >> (2 * tpcs);
+    unsigned long long n1 = (clk + hz / 2) / hz;  // GTPR + 1, rounded
+    if(n1 >= 2 && n1 <= max)
+      return GptPeriod{(unsigned char)tpcs, (unsigned int)(n1 - 1), clock_error_ppm(clk / n1, hz), true};
+  }
+  return GptPeriod{5, (unsigned int)(max - 1), 0, false};
+}
+
+// IIC: SCL = 1 / (((ICBRH + 1) + (ICBRL + 1)) / IICphi + rise + fall), IICphi = PCLKB / 2^CKS
+// Low period a little over half, as for I2C fast mode. Write ICBRL / ICBRH with the top 3 bits as 1s.
+struct IicBitRate {
+  unsigned char cks;    // ICMR1_CKS
+  unsigned char icbrl;
+  unsigned char icbrh;
+  unsigned long hz;     // Actual, including the rise and fall times
+  bool ok;
+};
+
+constexpr IicBitRate iic_bitrate(unsigned long pclkb, unsigned long hz, unsigned long rise_ns = 120, unsigned long fall_ns = 120) {
+  for(unsigned int cks = 0; cks <= 7; cks++) {
+    unsigned long long phi = (unsigned long long)pclkb >> cks;
+    long long counts = (long long)((phi + hz - 1) / hz) - (long long)(phi * (rise_ns + fall_ns) / 1000000000ULL);
+    if(counts < 4 || counts > 64) continue;
+    unsigned long long low = (counts * 53 + 99) / 100;
+    unsigned long long high = counts - low;
+    if(low > 32 || high > 32 || high < 1) continue;
+    unsigned long long ns = (counts * 1000000000ULL) / phi + rise_ns + fall_ns;
+    return IicBitRate{(unsigned char)cks, (unsigned char)(low - 1), (unsigned char)(high - 1), (unsigned long)(1000000000ULL / ns), true};
+  }
+  return IicBitRate{7, 31, 31, 0, false};
+}
+
+
+// ==== Bring-up ====
+// ra4m1::clock_start<Clocks>() - switch to a ClockTree from cold, or from whatever is running now:
+//   1. Unlock PRC0; still on MOCO out of reset, drop its /16 dividers so the rest runs at 8 MHz
+//   2. Set HOCOWTCR / MOMCR / MOSCWTCR and start every oscillator wanted at once - they stabilize in parallel
+//   3. Spin on OSCSF for the ones the new clock needs: MOSCSF, start the PLL, PLLSF, HOCOSF
+//   4. MEMWAIT to 1 first if ICLK goes above 32 MHz, SCKDIVCR / SCKSCR in whichever order never
+//      overclocks a domain, MEMWAIT back to 0 last if it is no longer needed - only written if it changes
+//   5. Wait for any extra oscillators at the new ICLK, and put PRCR back as it was
+// Each wait is timed with the DWT cycle counter, see clock_boot_times.
+//
+//   ra4m1::clock_start<ra4m1::ClocksArduino>();
+//   Serial.print(ra4m1::clock_boot_times.total_us());
+//
+// Note: The HOCO frequency comes from OFS1_HOCOFRQ1 in flash - a ClockTree HOCO Hz that does not
+//       match it fails rather than running every clock at the wrong speed.
+//       LOCO and SOSC have no stabilization flag, start those by hand.
+
+constexpr unsigned char HOCO_WAIT       = 5;  // HOCOWTCR_MSTS value after reset
+constexpr unsigned char HOCO_WAIT_64MHZ = 6;  // HOCOWTCR_MSTS needed before starting a 64 MHz HOCO
+constexpr unsigned char MOSC_WAIT       = 5;  // MOSCWTCR_MSTS value after reset
+
+struct ClockBootOptions {
+  unsigned char also_start = 0;       // Other oscillators to have running: (1 << OSCSF_HOCOSF) | (1 << OSCSF_MOSCSF)
+  unsigned long mosc_hz = 0;          // MOSC crystal, when it is only in also_start
+  bool mosc_external = false;         // MOMCR_MOSEL - a clock into EXTAL rather than a crystal
+  unsigned char mosc_wait = MOSC_WAIT; // MOSCWTCR_MSTS - 0 is fine for an external clock
+  unsigned long timeout_us = 100000;  // Per oscillator
+};
+
+// Cycles spent in one step, and the ICLK they were counted at
+struct ClockPhase {
+  unsigned int cycles = 0;
+  unsigned long iclk = 0;
+  unsigned int us() const { return iclk ? (unsigned int)((unsigned long long)cycles * 1000000 / iclk) : 0; }
+};
+
+struct ClockBootTimes {
+  ClockPhase start;  // Unlock, pre-speed, oscillator start writes
+  ClockPhase mosc;   // Spin on OSCSF_MOSCSF
+  ClockPhase pll;    // PLL start and spin on OSCSF_PLLSF
+  ClockPhase hoco;   // Spin on OSCSF_HOCOSF
+  ClockPhase sw;     // MEMWAIT, SCKDIVCR, SCKSCR
+  ClockPhase extra;  // Waiting on also_start oscillators, at the new ICLK
+  bool ok = false;   // false: an oscillator did not stabilize, or the HOCO is not the frequency asked for
+  unsigned int total_us() const { return start.us() + mosc.us() + pll.us() + hoco.us() + sw.us() + extra.us(); }
+};
+
+inline ClockBootTimes clock_boot_times;  // From the last clock_start()
+
+// HOCO frequency set by OFS1_HOCOFRQ1, 0 for a reserved setting
+inline unsigned long hoco_hz() {
+  switch((mmio_read(SYSTEM_OFS1) >> OFS1_HOCOFRQ1_2_0) & 0x7) {
+    case 0: return 24000000;
+    case 2: return 32000000;
+    case 4: return 48000000;
+    case 5: return 64000000;
+  }
+  return 0;
+}
+
+// Clock into the SCKDIVCR dividers right now - MOSC and PLL need the crystal frequency
+inline unsigned long clock_source_hz_now(unsigned long mosc_hz = 0) {
+  switch(SCKSCR::CKSEL.read()) {
+    case CLK_HOCO: return hoco_hz();
+    case CLK_MOCO: return 8000000;
+    case CLK_LOCO:
+    case CLK_SOSC: return 32768;
+    case CLK_MOSC: return mosc_hz;
+    case CLK_PLL:  return (mosc_hz * (PLLCCR2::PLLMUL.read() + 1)) >> PLLCCR2::PLODIV.read();
+  }
+  return 0;
+}
+
+inline unsigned long clock_iclk_now(unsigned long mosc_hz = 0) {
+  return clock_source_hz_now(mosc_hz) >> SCKDIVCR::ICK.read();
+}
+
+inline unsigned long clock_pclkd_now(unsigned long mosc_hz = 0) {
+  return clock_source_hz_now(mosc_hz) >> SCKDIVCR::PCKD.read();
+}
+
+// Spin until an OSCSF flag is 1 (or 0), counting the cycles
+template <typename F>
+inline bool clock_spin(F flag, unsigned int want, unsigned long timeout_us, ClockPhase &p) {
+  unsigned int timeout = p.iclk ? (unsigned int)((unsigned long long)p.iclk * timeout_us / 1000000) : 0xFFFFFFFF;
+  unsigned int t0 = cycles();
+  bool ok = true;
+  while(flag.read() != want) {
+    if(cycles() - t0 > timeout) { ok = false; break; }
+  }
+  p.cycles += cycles() - t0;
+  return ok;
+}
+
+template <typename Tree>
+inline bool clock_start(const ClockBootOptions &opt = ClockBootOptions(), ClockBootTimes &t = clock_boot_times) {
+  static_assert(Tree::source != CLK_LOCO && Tree::source != CLK_SOSC, "No stabilization flag for LOCO / SOSC - start them by hand");
+  constexpr unsigned short key = PRCR_PRKEY << PRCR_PRKEY_7_0;
+
+  const unsigned long mosc_hz = (Tree::source == CLK_MOSC || Tree::source == CLK_PLL) ? Tree::source_hz : opt.mosc_hz;
+  const bool need_hoco = Tree::source == CLK_HOCO;
+  const bool need_mosc = Tree::source == CLK_MOSC || Tree::source == CLK_PLL;
+  const bool run_hoco  = need_hoco || (opt.also_start & (1 << OSCSF_HOCOSF));
+  const bool run_mosc  = need_mosc || (opt.also_start & (1 << OSCSF_MOSCSF));
+
+  t = ClockBootTimes();
+  cycles_enable();
+  unsigned int t0 = cycles();
+  const unsigned short was = PRCR::read() & 0xFF;  // PRC1 / PRC3 as the sketch had them, put back on the way out
+  PRCR::write((unsigned short)(key | was | (1 << PRCR_PRC0)));
+
+  // Out of reset on MOCO /16 = 500 kHz: every domain at 8 MHz /1 is within the limits and ratios
+  if(SCKSCR::CKSEL.read() == CLK_MOCO && SCKDIVCR::read() != 0) SCKDIVCR::write(0);
+  const unsigned long clock_was = clock_source_hz_now(mosc_hz);
+  const unsigned long iclk_was  = clock_was >> SCKDIVCR::ICK.read();
+  t.start.iclk = t.mosc.iclk = t.pll.iclk = t.hoco.iclk = t.sw.iclk = iclk_was;
+  t.extra.iclk = Tree::iclk;
+
+  if(need_hoco && hoco_hz() != Tree::source_hz) {
+    PRCR::write((unsigned short)(key | was));
+    return false;
+  }
+
+  // Start everything together, wait settings first - they can only be written while stopped
+  if(run_hoco && HOCOCR::HCSTP.read()) {
+    HOCOWTCR::write(hoco_hz() == 64000000 ? HOCO_WAIT_64MHZ : HOCO_WAIT);
+    HOCOCR::write(0);
+  }
+  if(run_mosc && MOSCCR::MOSTP.read()) {
+    MOMCR::assign(MOMCR::MOSEL = opt.mosc_external, MOMCR::MODRV1 = (mosc_hz < 10000000));
+    MOSCWTCR::write(opt.mosc_wait);
+    MOSCCR::write(0);
+  }
+  if(Tree::source == CLK_MOCO && MOCOCR::MCSTP.read()) MOCOCR::write(0);  // Running after reset, no flag
+  t.start.cycles = cycles() - t0;
+
+  // The new clock's own chain first - the PLL can only start once MOSC is stable
+  bool ok = true;
+  if(need_mosc) ok = clock_spin(OSCSF::MOSCSF, 1, opt.timeout_us, t.mosc);
+  if(ok && Tree::uses_pll) {
+    unsigned int p0 = cycles();
+    if(PLLCCR2::read() != Tree::pllccr2 || PLLCR::PLLSTP.read()) {
+      if(SCKSCR::CKSEL.read() == CLK_PLL) ok = false;  // Can't change the PLL the CPU is running from
+      else {
+        if(!PLLCR::PLLSTP.read()) {
+          PLLCR::write(1);
+          ok = clock_spin(OSCSF::PLLSF, 0, opt.timeout_us, t.pll);
+        }
+        PLLCCR2::write(Tree::pllccr2);
+        PLLCR::write(0);
+      }
+    }
+    t.pll.cycles += cycles() - p0;
+    if(ok) ok = clock_spin(OSCSF::PLLSF, 1, opt.timeout_us, t.pll);
+  }
+  if(ok && need_hoco) ok = clock_spin(OSCSF::HOCOSF, 1, opt.timeout_us, t.hoco);
+  if(!ok) {
+    PRCR::write((unsigned short)(key | was));
+    return false;
+  }
+
+  // Switch - no domain ever above its limit, MEMWAIT set before ICLK goes up and cleared after it comes down
+  unsigned int s0 = cycles();
+  if(Tree::memwait && !MEMWAIT::WAIT.read()) MEMWAIT::write(Tree::memwait);
+  if(Tree::clock_hz >= clock_was) {
+    SCKDIVCR::write(Tree::sckdivcr);
+    SCKSCR::write(Tree::sckscr);
+  } else {
+    SCKSCR::write(Tree::sckscr);
+    SCKDIVCR::write(Tree::sckdivcr);
+  }
+  if(!Tree::memwait && MEMWAIT::WAIT.read()) MEMWAIT::write(0);
+  t.sw.cycles = cycles() - s0;
+
+  // Anything else asked for, now at full speed
+  if(run_hoco && !need_hoco) ok = clock_spin(OSCSF::HOCOSF, 1, opt.timeout_us, t.extra);
+  if(ok && run_mosc && !need_mosc) ok = clock_spin(OSCSF::MOSCSF, 1, opt.timeout_us, t.extra);
+
+  PRCR::write((unsigned short)(key | was));
+  t.ok = ok;
+  return ok;
+}
+
+}  // namespace ra4m1
+
+#endif  // SUSAN_RA4M1_MINIMA_CLOCKS_H
@@ -0,0 +1,205 @@
+/*  Arduino UNO R4 Minima - noinit DMA / DTC buffer arena for the RA4M1 register defines:
+ *
+ *  Buffers for the DMAC and the DTC from fixed pools in one block of RAM the C startup leaves alone
+ *  (the .noinit section, see the memfault link in the register defines), instead of the heap. The
+ *  pools are listed at compile time, so the total size is known and checked before it links:
+ *
+ *    //                           Block bytes  Blocks  Transfer unit  Alignment
+ *    typedef ra4m1::DmaArena<ra4m1::DmaPool<512, 4,      ra4m1::DMA_16>,             // ADC rings
+ *                            ra4m1::DmaPool<64,  8,      ra4m1::DMA_32>,             // DTC chains
+ *                            ra4m1::DmaPool<128, 1,      ra4m1::DMA_32, 1024>> Dma;  // DTC vector table
+ *
+ *    bool kept = Dma::begin();                           // true: warm start, buffers as they were
+ *    unsigned short *ring = Dma::alloc<0, unsigned short>();
+ *    ra4m1::DtcInfo *chain = Dma::alloc<1, ra4m1::DtcInfo>();
+ *    ...
+ *    Dma::free(ring);
+ *
+ *  Each pool's blocks start on a multiple of its transfer unit - 2 for DMA_16, 4 for DMA_32 - or
+ *  the alignment given, which must be a power of two. Dma::bytes is the arena size, and it has to
+ *  fit RA4M1_DMA_ARENA_MAX (16 KB unless defined before the include) or it will not compile.
+ *
+ *  Warm start: RSTSR2_CWSF is 0 after a power-on reset and stays 1, once begin() has set it,
+ *  through every other reset - watchdog, pin reset, or ra4m1::system_reset() through SCB_AIRCR.
+ *  begin() keeps the arena when CWSF is 1 and a header word matches the pool list, otherwise it
+ *  zeroes it. Blocks are handed out lowest free first, so the same alloc() calls after a reset
+ *  give back the same blocks, with the data in them.
+ *
+ *  Note: The RA4M1 has no data cache, so there is nothing to flush or invalidate around a transfer;
+ *        the noinit placement is only about the startup code. Nothing here stops a transfer that
+ *        is running - stop the DMAC channel / DTC slot before free() or a system_reset().
+ *
+ *  With RA4M1_HOST_SIM the arena is at 0x20002000 in the simulated SRAM, so dma_addr() works on
+ *  its blocks; sim_reset() is the power-on.
+ *
+ * This code is "AS IS" without warranty or liability.
+ * GPL v3 or later - see susan_ra4m1_minima_register_defines.h
+*/
+
+#ifndef SUSAN_RA4M1_MINIMA_DMA_ARENA_H
+#define SUSAN_RA4M1_MINIMA_DMA_ARENA_H
+
+#include "susan_ra4m1_minima_dmac.h"
+
+#ifndef RA4M1_DMA_ARENA_MAX
+#define RA4M1_DMA_ARENA_MAX 16384
+#endif
+
+// The Arduino core's linker script (fsp.ld) puts .noinit* in RAM as NOLOAD, after .bss
+#ifndef RA4M1_DMA_ARENA_SECTION
+#define RA4M1_DMA_ARENA_SECTION ".noinit.dma_arena"
+#endif
+
+namespace ra4m1 {
+
+constexpr unsigned int DMA_ARENA_MAGIC = 0x444D4152;  // "DMAR"
+
+#ifdef RA4M1_HOST_SIM
+constexpr unsigned int DMA_ARENA_SIM_BASE = 0x20002000;
+constexpr unsigned int DMA_ARENA_SIM_MAX = 0x20007C00 - DMA_ARENA_SIM_BASE;  // Up to the simulated DTC vector table
+#endif
+
+// Software reset - the next begin() sees a warm start
+inline void system_reset() {
+  dsb();
+  mmio_write(SCB_AIRCR, (unsigned int)((0x5FAu << SCB_AIRCR_VECTKEY_Pos) | SCB_AIRCR_SYSRESETREQ_Msk));
+  dsb();
+#ifndef RA4M1_HOST_SIM
+  for(;;) {}
+#endif
+}
+
+inline bool warm_start() { return (mmio_read(SYSTEM_RSTSR2) >> RSTSR2_CWSF) & 1; }
+
+
+// ==== Pools ====
+
+template <unsigned int Size, unsigned int Count, DmaSize Unit = DMA_8, unsigned int Align = 0>
+struct DmaPool {
+  static constexpr unsigned int align = Align > (1u << Unit) ? Align : (1u << Unit);
+  static constexpr unsigned int count = Count;
+  static constexpr unsigned int stride = (Size + align - 1) & ~(align - 1);  // Block size, rounded up to the alignment
+  static_assert((align & (align - 1)) == 0, "DmaPool alignment must be a power of two");
+  static_assert(Size >= 1 && Count >= 1 && Count <= 32, "DmaPool is 1 - 32 blocks of at least one byte");
+};
+
+struct DmaArenaHeader {
+  unsigned int magic;
+  unsigned int layout;      // Hash of the pool list - a new sketch with other pools starts clean
+  unsigned int warm_boots;  // Warm starts with the arena kept, since it was last zeroed
+  unsigned int reserved;
+};
+
+struct DmaArenaLayout {
+  unsigned int offset[8];
+  unsigned int bytes;
+  unsigned int align;
+  unsigned int hash;
+};
+
+template <typename... Pools>
+struct DmaArena {
+  static constexpr unsigned int pools = sizeof...(Pools);
+  static_assert(pools >= 1 && pools <= 8, "DmaArena is 1 - 8 pools");
+
+  static constexpr unsigned int stride_[pools] = {Pools::stride...};
+  static constexpr unsigned int count_[pools] = {Pools::count...};
+  static constexpr unsigned int align_[pools] = {Pools::align...};
+
+  static constexpr DmaArenaLayout make_layout() {
+    DmaArenaLayout l{};
+    unsigned int at = sizeof(DmaArenaHeader);
+    l.align = alignof(DmaArenaHeader);
+    l.hash = 2166136261u;  // FNV-1a over stride, count, align
+    for(unsigned int i = 0; i < pools; i++) {
+      at = (at + align_[i] - 1) & ~(align_[i] - 1);
+      l.offset[i] = at;
+      at += stride_[i] * count_[i];
+      if(align_[i] > l.align) l.align = align_[i];
+      const unsigned int words[3] = {stride_[i], count_[i], align_[i]};
+      for(unsigned int w : words) l.hash = (l.hash ^ w) * 16777619u;
+    }
+    l.bytes = (at + 3) & ~3u;
+    return l;
+  }
+
+  static constexpr DmaArenaLayout layout = make_layout();
+  static constexpr unsigned int bytes = layout.bytes;
+  static_assert(bytes <= RA4M1_DMA_ARENA_MAX, "DmaArena is bigger than RA4M1_DMA_ARENA_MAX");
+#ifdef RA4M1_HOST_SIM
+  static_assert(bytes <= DMA_ARENA_SIM_MAX && DMA_ARENA_SIM_BASE % layout.align == 0, "DmaArena does not fit the simulated SRAM");
+#endif
+
+  static constexpr unsigned int block_bytes(unsigned int pool) { return stride_[pool]; }
+  static constexpr unsigned int blocks(unsigned int pool) { return count_[pool]; }
+
+#ifndef RA4M1_HOST_SIM
+  alignas(layout.align) static inline unsigned char storage[bytes] __attribute__((section(RA4M1_DMA_ARENA_SECTION)));
+#endif
+  static inline unsigned int used[pools];  // In .bss - zero at every start, the blocks are handed out again
+
+  static unsigned char *base() {
+#ifdef RA4M1_HOST_SIM
+    return (unsigned char *)sim_map(DMA_ARENA_SIM_BASE);
+#else
+    return storage;
+#endif
+  }
+
+  static volatile DmaArenaHeader *header() { return (volatile DmaArenaHeader *)base(); }
+
+  // Returns true when the arena came through a warm reset intact
+  static bool begin() {
+    volatile DmaArenaHeader *h = header();
+    bool kept = warm_start() && h->magic == DMA_ARENA_MAGIC && h->layout == layout.hash;
+    if(kept) {
+      h->warm_boots = h->warm_boots + 1;
+    } else {
+      volatile unsigned int *w = (volatile unsigned int *)base();
+      for(unsigned int i = 0; i < bytes / 4; i++) w[i] = 0;
+      h->layout = layout.hash;
+      h->magic = DMA_ARENA_MAGIC;
+    }
+    mmio_write(SYSTEM_RSTSR2, (unsigned char)(1 << RSTSR2_CWSF));  // Write 1 only - cleared by power-on reset
+    for(unsigned int i = 0; i < pools; i++) used[i] = 0;
+    return kept;
+  }
+
+  static unsigned int warm_boots() { return header()->warm_boots; }
+
+  // A free block of the pool, or nullptr
+  template <unsigned int Pool, typename T = unsigned char>
+  static T *alloc() {
+    static_assert(Pool < pools, "No such pool");
+    static_assert(alignof(T) <= align_[Pool], "Type needs more alignment than the pool has");
+    static_assert(sizeof(T) <= stride_[Pool], "Type is bigger than the pool's blocks");
+    unsigned int primask = irq_save();
+    unsigned int free = ~used[Pool] & (count_[Pool] == 32 ? ~0u : (1u << count_[Pool]) - 1);
+    T *p = nullptr;
+    if(free) {
+      unsigned int i = __builtin_ctz(free);
+      used[Pool] |= 1u << i;
+      p = (T *)(base() + layout.offset[Pool] + i * stride_[Pool]);
+    }
+    irq_restore(primask);
+    return p;
+  }
+
+  static void free(const volatile void *p) {
+    unsigned int at = (unsigned int)((const volatile unsigned char *)p - base());
+    for(unsigned int i = 0; i < pools; i++) {
+      if(at - layout.offset[i] < stride_[i] * count_[i]) {
+        unsigned int primask = irq_save();
+        used[i] &= ~(1u << ((at - layout.offset[i]) / stride_[i]));
+        irq_restore(primask);
+        return;
+      }
+    }
+  }
+
+  static unsigned int in_use(unsigned int pool) { return __builtin_popcount(used[pool]); }
+};
+
+}  // namespace ra4m1
+
+#endif  // SUSAN_RA4M1_MINIMA_DMA_ARENA_H
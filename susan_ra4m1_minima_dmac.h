@@ -0,0 +1,350 @@
+/*  Arduino UNO R4 Minima - DMA transfers for the RA4M1 register defines:
+ *
+ *  Four DMAC channels, each started by software or by any ICU event (the IRQ_xxx list), so the
+ *  ADC, SCI, SPI or SSIE can move their data with no CPU. A transfer is a constexpr description,
+ *  a channel comes from a small allocator, and a callback runs when it is done:
+ *
+ *    static unsigned short samples[256];
+ *    int ch = ra4m1::dma_alloc();
+ *    ra4m1::dma_start(ch, ra4m1::dma_transfer(ra4m1::dma_addr(samples), ra4m1::dma_addr(ADC140_ADDR00), 256, ra4m1::DMA_16)
+ *                           .src(ra4m1::DMA_FIXED).on_event(IRQ_ADC140_ADI),
+ *                     adc_done, nullptr, 8);        // Callback via IELSR slot 8
+ *
+ *    void adc_done(unsigned int ch, bool end, void *ctx) { ... }
+ *
+ *  Modes - DMTMD_MD:
+ *    Normal  one unit per event, count units, then stop          dma_transfer(dst, src, count)
+ *    Repeat  one unit per event; after 'size' units the repeat   .repeat(size, times)
+ *            side goes back to its start - 'times' rounds
+ *    Block   'size' units per event, 'blocks' events             .block(size, blocks)
+ *  Repeat and block default to the destination as the repeat / block area - .area(DMA_AREA_SRC).
+ *  .repeat_interrupt() also calls back (end = false) after each repeat, for a ping-pong buffer;
+ *  the channel is re-enabled after the callback returns.
+ *
+ *  With no event, dma_start() starts a software transfer that runs to the end: a memcpy.
+ *
+ *  With RA4M1_HOST_SIM, ra4m1::SimDma moves the data in the simulated memory - SRAM addresses for
+ *  buffers, sim_irq_raise(IRQ_xxx) for the events that start a transfer.
+ *
+ *  Note: DMAC and DTC share MSTPCRA_MSTPA22, which needs PRCR_PRC1; dma_start() sets it up.
+ *        Buffers need a 32 bit address - on the Arduino that's any SRAM variable.
+ *
+ * This code is "AS IS" without warranty or liability.
+ * GPL v3 or later - see susan_ra4m1_minima_register_defines.h
+*/
+
+#ifndef SUSAN_RA4M1_MINIMA_DMAC_H
+#define SUSAN_RA4M1_MINIMA_DMAC_H
+
+#include "susan_ra4m1_minima_irq.h"
+
+namespace ra4m1 {
+
+constexpr unsigned int DMA_CHANNELS = 4;
+
+enum DmaMode : unsigned char { DMA_NORMAL = 0, DMA_REPEAT = 1, DMA_BLOCK = 2 };         // DMTMD_MD
+enum DmaSize : unsigned char { DMA_8 = 0, DMA_16 = 1, DMA_32 = 2 };                     // DMTMD_SZ
+enum DmaArea : unsigned char { DMA_AREA_DST = 0, DMA_AREA_SRC = 1, DMA_AREA_NONE = 2 }; // DMTMD_DTS
+enum DmaAddr : unsigned char { DMA_FIXED = 0, DMA_OFFSET = 1, DMA_INC = 2, DMA_DEC = 3 }; // DMAMD_SM / DM
+
+// A chip address for DMSAR / DMDAR - a register define or a buffer
+inline unsigned int dma_addr(const volatile void *p) {
+#ifdef RA4M1_HOST_SIM
+  return sim_phys(p);
+#else
+  return (unsigned int)p;
+#endif
+}
+
+
+// ==== A transfer ====
+
+struct DmaTransfer {
+  unsigned int sar, dar;
+  unsigned int cra;       // DMCRAH:DMCRAL
+  unsigned short crb;
+  unsigned short tmd;     // DMTMD, DCTG set from the event
+  unsigned short amd;
+  unsigned char dmint;
+  unsigned char event;    // IRQ_xxx, 0 for a software start
+  unsigned int ofr;
+
+  constexpr DmaTransfer src(DmaAddr m) const { DmaTransfer t = *this; t.amd = (unsigned short)((amd & ~(3u << DMAMD_SM_1_0)) | (m << DMAMD_SM_1_0)); return t; }
+  constexpr DmaTransfer dst(DmaAddr m) const { DmaTransfer t = *this; t.amd = (unsigned short)((amd & ~(3u << DMAMD_DM_1_0)) | (m << DMAMD_DM_1_0)); return t; }
+  constexpr DmaTransfer offset(int o) const { DmaTransfer t = *this; t.ofr = (unsigned int)o; return t; }
+  constexpr DmaTransfer on_event(unsigned int e) const { DmaTransfer t = *this; t.event = (unsigned char)e; return t; }
+  constexpr DmaTransfer area(DmaArea a) const {
+    DmaTransfer t = *this;
+    t.tmd = (unsigned short)((tmd & ~(3u << DMTMD_DTS_1_0)) | (a << DMTMD_DTS_1_0));
+    return t;
+  }
+  // Extended repeat area: the address wraps in a 2^bits byte ring, 0 for none
+  constexpr DmaTransfer src_ring(unsigned int bits) const { DmaTransfer t = *this; t.amd = (unsigned short)((amd & ~(0x1Fu << DMAMD_SARA_4_0)) | (bits << DMAMD_SARA_4_0)); return t; }
+  constexpr DmaTransfer dst_ring(unsigned int bits) const { DmaTransfer t = *this; t.amd = (unsigned short)((amd & ~(0x1Fu << DMAMD_DARA_4_0)) | (bits << DMAMD_DARA_4_0)); return t; }
+
+  // 'size' 1 - 1024 units a repeat / block, 'times' 1 - 65536; the destination is the area, .area() after to change
+  constexpr DmaTransfer mode(DmaMode m, unsigned int size, unsigned int times) const {
+    DmaTransfer t = *this;
+    t.tmd = (unsigned short)((tmd & ~((3u << DMTMD_MD_1_0) | (3u << DMTMD_DTS_1_0))) | (m << DMTMD_MD_1_0) | (DMA_AREA_DST << DMTMD_DTS_1_0));
+    t.cra = ((size & 0x3FF) << DMCRA_DMCRAH_9_0) | (size & 0x3FF);
+    t.crb = (unsigned short)times;
+    return t;
+  }
+  constexpr DmaTransfer repeat(unsigned int size, unsigned int times) const { return mode(DMA_REPEAT, size, times); }
+  constexpr DmaTransfer block(unsigned int size, unsigned int blocks) const { return mode(DMA_BLOCK, size, blocks); }
+  constexpr DmaTransfer repeat_interrupt() const { DmaTransfer t = *this; t.dmint |= 1 << DMINT_RPTIE; return t; }
+
+  constexpr DmaMode mode() const { return (DmaMode)((tmd >> DMTMD_MD_1_0) & 3); }
+};
+
+// Normal mode, both addresses incrementing - 'count' 1 - 65535 units
+constexpr DmaTransfer dma_transfer(unsigned int dst, unsigned int src, unsigned int count, DmaSize size = DMA_8) {
+  return DmaTransfer{src, dst, count & 0xFFFF, 0, (unsigned short)((size << DMTMD_SZ_1_0) | (DMA_AREA_NONE << DMTMD_DTS_1_0)),
+                     (unsigned short)((DMA_INC << DMAMD_SM_1_0) | (DMA_INC << DMAMD_DM_1_0)), 0, 0, 0};
+}
+
+
+// ==== Channels ====
+
+typedef void (*DmaCallback)(unsigned int channel, bool end, void *ctx);
+
+struct DmaChannel {
+  bool used;
+  unsigned char slot;                    // IELSR slot for the callback, IRQ_SLOTS for none
+  DmaCallback done;
+  void *ctx;
+  volatile unsigned int repeats;         // Repeat size end interrupts seen
+  volatile unsigned int ends;            // Transfer end interrupts seen
+};
+
+inline DmaChannel dma_channels[DMA_CHANNELS];
+
+inline unsigned int dma_base(unsigned int ch) { return DMACBASE + ch * 0x40; }
+inline unsigned int dma_delsr(unsigned int ch) { return ICUBASE + DELSR + ch * 4; }
+
+// A free channel, or -1
+inline int dma_alloc() {
+  unsigned int primask = irq_save();
+  int ch = -1;
+  for(unsigned int i = 0; i < DMA_CHANNELS && ch < 0; i++) {
+    if(!dma_channels[i].used) {
+      dma_channels[i] = DmaChannel{true, IRQ_SLOTS, nullptr, nullptr, 0, 0};
+      ch = (int)i;
+    }
+  }
+  irq_restore(primask);
+  return ch;
+}
+
+inline bool dma_busy(unsigned int ch) { return mmio_read<unsigned char>(dma_base(ch) + DMCNT) & (1 << DMCNT_DTE); }
+inline unsigned int dma_remaining(unsigned int ch) { return mmio_read<unsigned int>(dma_base(ch) + DMCRA) & 0xFFFF; }
+inline unsigned int dma_blocks_remaining(unsigned int ch) { return mmio_read<unsigned short>(dma_base(ch) + DMCRB); }
+
+inline void dma_stop(unsigned int ch) {
+  mmio_write<unsigned char>(dma_base(ch) + DMCNT, 0);
+  mmio_write<unsigned int>(dma_delsr(ch), 0u);
+}
+
+inline void dma_free(unsigned int ch) {
+  dma_stop(ch);
+  if(dma_channels[ch].slot < IRQ_SLOTS) irq_unlink(dma_channels[ch].slot);
+  dma_channels[ch].used = false;
+}
+
+// DMAC / DTC module on - MSTPCRA is behind PRC1
+inline void dmac_dtc_power_on() {
+  if(MSTPCRA::read() & (1u << MSTPA22)) {
+    constexpr unsigned short key = PRCR_PRKEY << PRCR_PRKEY_7_0;
+    unsigned short prcr = PRCR::read() & 0xFF;
+    PRCR::write((unsigned short)(key | prcr | (1 << PRCR_PRC1)));
+    MSTPCRA::write(MSTPCRA::read() & ~(1u << MSTPA22));
+    PRCR::write((unsigned short)(key | prcr));
+  }
+}
+
+inline void dma_module_start() {
+  dmac_dtc_power_on();
+  DMAST::write(1 << DMAST_DMST);
+}
+
+// DMACn_INT - clear the flags, count, call back, and carry on after a repeat
+inline void dma_interrupt(unsigned int ch) {
+  DmaChannel &c = dma_channels[ch];
+  unsigned int b = dma_base(ch);
+  if(c.slot < IRQ_SLOTS) irq_ack(c.slot);
+  bool end = mmio_read<unsigned char>(b + DMSTS) & (1 << DMSTS_DTIF);
+  mmio_write<unsigned char>(b + DMSTS, 0);
+  if(end) c.ends++;
+  else c.repeats++;
+  if(c.done) c.done(ch, end, c.ctx);
+  if(!end) mmio_write<unsigned char>(b + DMCNT, 1 << DMCNT_DTE);  // Repeat size end stops the channel
+}
+
+template <unsigned int Ch> void dma_isr() { dma_interrupt(Ch); }
+constexpr IrqHandler DMA_ISRS[DMA_CHANNELS] = {dma_isr<0>, dma_isr<1>, dma_isr<2>, dma_isr<3>};
+
+// Program and enable a channel; with no event the transfer starts now and runs to the end.
+// A callback needs an IELSR slot.
+inline void dma_start(unsigned int ch, const DmaTransfer &t, DmaCallback done = nullptr, void *ctx = nullptr,
+                      unsigned int slot = IRQ_SLOTS, unsigned int priority = 12) {
+  unsigned int b = dma_base(ch);
+  DmaChannel &c = dma_channels[ch];
+  dma_module_start();
+  mmio_write<unsigned char>(b + DMCNT, 0);
+  mmio_write<unsigned char>(b + DMSTS, 0);
+  mmio_write<unsigned int>(b + DMSAR, t.sar);
+  mmio_write<unsigned int>(b + DMDAR, t.dar);
+  mmio_write<unsigned int>(b + DMCRA, t.cra);
+  mmio_write<unsigned short>(b + DMCRB, t.crb);
+  mmio_write<unsigned int>(b + DMOFR, t.ofr);
+  mmio_write<unsigned short>(b + DMAMD, t.amd);
+  mmio_write<unsigned short>(b + DMTMD, (unsigned short)(t.tmd | (t.event ? 1u << DMTMD_DCTG_1_0 : 0)));
+  mmio_write<unsigned int>(dma_delsr(ch), (unsigned int)t.event << DELSR_DELS_7_0);
+  c.used = true;
+  c.done = done;
+  c.ctx = ctx;
+  c.slot = (unsigned char)(done ? slot : IRQ_SLOTS);
+  c.repeats = c.ends = 0;
+  if(c.slot < IRQ_SLOTS) {
+    mmio_write<unsigned char>(b + DMINT, (unsigned char)(t.dmint | (1 << DMINT_DTIE)));
+    irq_link(c.slot, IRQ_DMAC0_INT + ch, priority, DMA_ISRS[ch]);
+  } else {
+    mmio_write<unsigned char>(b + DMINT, 0);
+  }
+  mmio_write<unsigned char>(b + DMCNT, 1 << DMCNT_DTE);
+  if(!t.event) mmio_write<unsigned char>(b + DMREQ, (1 << DMREQ_SWREQ) | (1 << DMREQ_CLRS));
+}
+
+// From the callback at the end: new addresses and counts, same mode and event, enabled again -
+// a ping-pong between two buffers with no relinking
+inline void dma_rearm(unsigned int ch, const DmaTransfer &t) {
+  unsigned int b = dma_base(ch);
+  mmio_write<unsigned int>(b + DMSAR, t.sar);
+  mmio_write<unsigned int>(b + DMDAR, t.dar);
+  mmio_write<unsigned int>(b + DMCRA, t.cra);
+  mmio_write<unsigned short>(b + DMCRB, t.crb);
+  mmio_write<unsigned char>(b + DMCNT, 1 << DMCNT_DTE);
+}
+
+// Software request for one more unit / block on a software started channel
+inline void dma_request(unsigned int ch) { mmio_write<unsigned char>(dma_base(ch) + DMREQ, 1 << DMREQ_SWREQ); }
+
+// Spin until the channel stops, or the timeout in cycles - false on timeout
+inline bool dma_wait(unsigned int ch, unsigned int timeout_cycles) {
+  unsigned int t0 = cycles();
+  while(dma_busy(ch))
+    if(cycles() - t0 > timeout_cycles) return false;
+  return true;
+}
+
+
+#ifdef RA4M1_HOST_SIM
+// ==== Simulated DMAC ====
+// Each request moves one unit (normal / repeat) or one block, through sim_read / sim_write so
+// register hooks see the accesses. attach() hooks DMREQ and DMCNT and listens for events.
+//
+//   ra4m1::sim_reset();
+//   ra4m1::SimDma dmac;  dmac.attach();
+//   ra4m1::dma_start(ch, ...on_event(IRQ_ADC140_ADI));
+//   ra4m1::sim_irq_raise(IRQ_ADC140_ADI);    // One transfer
+
+struct SimDma {
+  unsigned int start_sar[DMA_CHANNELS];   // Repeat / block area start, taken when DTE is set
+  unsigned int start_dar[DMA_CHANNELS];
+  unsigned int transfers = 0;             // Units moved
+
+  void attach() {
+    for(unsigned int ch = 0; ch < DMA_CHANNELS; ch++) {
+      unsigned int b = DMACBASE + ch * 0x40;
+      sim_on_write(b + DMCNT, [this, ch, b](unsigned int, unsigned int v) {
+        if(v & (1 << DMCNT_DTE)) {
+          start_sar[ch] = sim_peek<unsigned int>(b + DMSAR);
+          start_dar[ch] = sim_peek<unsigned int>(b + DMDAR);
+        }
+        return v;
+      });
+      sim_on_write(b + DMREQ, [this, ch](unsigned int, unsigned int v) {
+        if(v & (1 << DMREQ_SWREQ)) {
+          request(ch);
+          if(v & (1 << DMREQ_CLRS))
+            while(enabled(ch) && !(sim_peek<unsigned short>(DMACBASE + ch * 0x40 + DMTMD) & (3u << DMTMD_DCTG_1_0))) request(ch);
+        }
+        return v & ~(1u << DMREQ_SWREQ);
+      });
+    }
+    sim_on_event([this](unsigned int event) { this->event(event); });
+  }
+
+  static bool enabled(unsigned int ch) {
+    return (sim_peek<unsigned char>(DMACBASE + 0x0200) & (1 << DMAST_DMST)) && (sim_peek<unsigned char>(DMACBASE + ch * 0x40 + DMCNT) & (1 << DMCNT_DTE));
+  }
+
+  void event(unsigned int event) {
+    for(unsigned int ch = 0; ch < DMA_CHANNELS; ch++) {
+      unsigned int b = DMACBASE + ch * 0x40;
+      if(enabled(ch) && (sim_peek<unsigned short>(b + DMTMD) & (1u << DMTMD_DCTG_1_0)) && (sim_peek<unsigned int>(dma_delsr(ch)) & 0xFF) == event)
+        request(ch);
+    }
+  }
+
+  static unsigned int step(unsigned int addr, unsigned int mode, unsigned int ring, unsigned int size, unsigned int ofr) {
+    unsigned int next = mode == DMA_INC ? addr + size : mode == DMA_DEC ? addr - size : mode == DMA_OFFSET ? addr + ofr : addr;
+    if(ring) next = (addr & ~((1u << ring) - 1)) | (next & ((1u << ring) - 1));
+    return next;
+  }
+
+  void unit(unsigned int b) {
+    unsigned int size = 1u << ((sim_peek<unsigned short>(b + DMTMD) >> DMTMD_SZ_1_0) & 3);
+    unsigned int amd = sim_peek<unsigned short>(b + DMAMD);
+    unsigned int sar = sim_peek<unsigned int>(b + DMSAR), dar = sim_peek<unsigned int>(b + DMDAR), ofr = sim_peek<unsigned int>(b + DMOFR);
+    if(size == 1) sim_write<unsigned char>(dar, sim_read<unsigned char>(sar));
+    else if(size == 2) sim_write<unsigned short>(dar, sim_read<unsigned short>(sar));
+    else sim_write<unsigned int>(dar, sim_read<unsigned int>(sar));
+    sim_poke<unsigned int>(b + DMSAR, step(sar, (amd >> DMAMD_SM_1_0) & 3, (amd >> DMAMD_SARA_4_0) & 0x1F, size, ofr));
+    sim_poke<unsigned int>(b + DMDAR, step(dar, (amd >> DMAMD_DM_1_0) & 3, (amd >> DMAMD_DARA_4_0) & 0x1F, size, ofr));
+    transfers++;
+  }
+
+  void finish(unsigned int ch, unsigned int flag_bit, unsigned int int_bit) {
+    unsigned int b = DMACBASE + ch * 0x40;
+    sim_poke<unsigned char>(b + DMCNT, 0);
+    if(flag_bit < 8) sim_poke<unsigned char>(b + DMSTS, (unsigned char)(sim_peek<unsigned char>(b + DMSTS) | (1 << flag_bit)));
+    if(sim_peek<unsigned char>(b + DMINT) & (1 << int_bit)) sim_irq_raise(IRQ_DMAC0_INT + ch);
+  }
+
+  void request(unsigned int ch) {
+    if(!enabled(ch)) return;
+    unsigned int b = DMACBASE + ch * 0x40;
+    unsigned int tmd = sim_peek<unsigned short>(b + DMTMD);
+    unsigned int md = (tmd >> DMTMD_MD_1_0) & 3, dts = (tmd >> DMTMD_DTS_1_0) & 3;
+    unsigned int cra = sim_peek<unsigned int>(b + DMCRA);
+    if(md == DMA_NORMAL) {
+      unit(b);
+      if((cra & 0xFFFF) == 0) return;  // Free running
+      sim_poke<unsigned int>(b + DMCRA, cra - 1);
+      if((cra & 0xFFFF) == 1) finish(ch, DMSTS_DTIF, DMINT_DTIE);
+      return;
+    }
+    unsigned int count = (cra & 0xFFFF) ? (cra & 0xFFFF) : 1024;
+    unsigned int n = md == DMA_BLOCK ? count : 1;
+    for(unsigned int i = 0; i < n; i++) unit(b);
+    unsigned int left = md == DMA_BLOCK ? 0 : count - 1;
+    if(left) {
+      sim_poke<unsigned int>(b + DMCRA, (cra & 0xFFFF0000u) | left);
+      return;
+    }
+    unsigned int size = (cra >> DMCRA_DMCRAH_9_0) & 0x3FF;
+    sim_poke<unsigned int>(b + DMCRA, (cra & 0xFFFF0000u) | (size ? size : 1024));
+    if(dts == DMA_AREA_DST) sim_poke<unsigned int>(b + DMDAR, start_dar[ch]);
+    if(dts == DMA_AREA_SRC) sim_poke<unsigned int>(b + DMSAR, start_sar[ch]);
+    unsigned int crb = sim_peek<unsigned short>(b + DMCRB);
+    sim_poke<unsigned short>(b + DMCRB, (unsigned short)(crb - 1));
+    if(crb == 1) finish(ch, DMSTS_DTIF, DMINT_DTIE);
+    else if(md == DMA_REPEAT && (sim_peek<unsigned char>(b + DMINT) & (1 << DMINT_RPTIE))) finish(ch, 8, DMINT_RPTIE);
+  }
+};
+#endif
+
+}  // namespace ra4m1
+
+#endif  // SUSAN_RA4M1_MINIMA_DMAC_H
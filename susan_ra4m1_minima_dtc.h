@@ -0,0 +1,243 @@
+/*  Arduino UNO R4 Minima - DTC chained transfers for the RA4M1 register defines:
+ *
+ *  The DTC is started by the event in an IELSRn slot, instead of the CPU, when IELSR_DTCE is set.
+ *  It reads its transfer information from entry n of a vector table in SRAM (DTCVBR), so every
+ *  slot can have its own transfer - up to 32 "channels" beside the four DMAC ones. Chained records
+ *  run back to back from one event: move the data, then reprogram a peripheral, no CPU at all.
+ *
+ *    // ADC scan end: copy the result into a ring, then load the next channel mask into ADANSA0
+ *    static ra4m1::DtcInfo adc_chain[2] = {
+ *      ra4m1::dtc_transfer(0, 0, 0, ra4m1::DMA_16).src(ra4m1::DMA_FIXED).repeat(64).chain(),
+ *      ra4m1::dtc_transfer(0, 0, 0, ra4m1::DMA_16).dst(ra4m1::DMA_FIXED).repeat(4).area(ra4m1::DMA_AREA_SRC),
+ *    };
+ *    adc_chain[0].from(ra4m1::dtc_addr(ADC140_ADDR00)).to(ra4m1::dtc_addr(ring));
+ *    adc_chain[1].from(ra4m1::dtc_addr(masks)).to(ra4m1::dtc_addr(ADC140_ADANSA0));
+ *    ra4m1::dtc_begin();
+ *    ra4m1::dtc_link(9, IRQ_ADC140_ADI, adc_chain);     // Slot 9, no CPU interrupt
+ *
+ *  Modes - word 0 MRA_MD, as the DMAC, but 8 bit sizes:
+ *    Normal  one unit per event, 'count' 1 - 65536, then the slot's interrupt goes to the CPU
+ *    Repeat  one unit per event, the area goes back to its start after 'size' 1 - 256 units, forever
+ *    Block   'size' 1 - 256 units per event, 'blocks' 1 - 65536 events, then the CPU interrupt
+ *  .chain() runs the next record after every transfer, .chain_at_end() only when the count ends.
+ *  .irq_each() interrupts the CPU after every transfer.
+ *
+ *  When a count ends the ICU clears IELSR_DTCE and the slot's handler runs; dtc_rearm() in the
+ *  handler puts the slot back on the DTC after the records are reloaded.
+ *
+ *  The DTC writes the updated addresses and counts back into the records, so they live in RAM,
+ *  in one array for a chain. If the Arduino core has already set DTCVBR its table is shared,
+ *  otherwise dtc_vector_table is used - 128 bytes, but 1 KB aligned.
+ *
+ *  With RA4M1_HOST_SIM, ra4m1::SimDtc runs the records in the simulated memory; its vector table
+ *  is at 0x20007C00 in the SRAM image and the records need to be in the image too.
+ *
+ * This code is "AS IS" without warranty or liability.
+ * GPL v3 or later - see susan_ra4m1_minima_register_defines.h
+*/
+
+#ifndef SUSAN_RA4M1_MINIMA_DTC_H
+#define SUSAN_RA4M1_MINIMA_DTC_H
+
+#include "susan_ra4m1_minima_dmac.h"
+
+namespace ra4m1 {
+
+inline unsigned int dtc_addr(const volatile void *p) { return dma_addr(p); }
+
+// ==== Transfer information ====
+
+struct DtcInfo {
+  unsigned int mode;  // MRA:MRB
+  unsigned int sar;
+  unsigned int dar;
+  unsigned int cr;    // CRA:CRB - CRA in b31-16, CRB in b15-0
+
+  constexpr DtcInfo with(unsigned int set, unsigned int clear) const { return DtcInfo{(mode & ~clear) | set, sar, dar, cr}; }
+
+  constexpr DtcInfo src(DmaAddr m) const { return with((unsigned int)m << DTC_MRA_SM_1_0, 3u << DTC_MRA_SM_1_0); }
+  constexpr DtcInfo dst(DmaAddr m) const { return with((unsigned int)m << DTC_MRB_DM_1_0, 3u << DTC_MRB_DM_1_0); }
+  constexpr DtcInfo area(DmaArea a) const { return with(a == DMA_AREA_SRC ? 1u << DTC_MRB_DTS : 0, 1u << DTC_MRB_DTS); }
+  constexpr DtcInfo chain() const { return with(1u << DTC_MRB_CHNE, 1u << DTC_MRB_CHNS); }
+  constexpr DtcInfo chain_at_end() const { return with((1u << DTC_MRB_CHNE) | (1u << DTC_MRB_CHNS), 0); }
+  constexpr DtcInfo irq_each() const { return with(1u << DTC_MRB_DISEL, 0); }
+
+  constexpr DtcInfo repeat(unsigned int size) const {
+    DtcInfo t = with((unsigned int)DMA_REPEAT << DTC_MRA_MD_1_0, 3u << DTC_MRA_MD_1_0);
+    t.cr = ((size & 0xFF) << 24) | ((size & 0xFF) << 16);
+    return t;
+  }
+  constexpr DtcInfo block(unsigned int size, unsigned int blocks) const {
+    DtcInfo t = with((unsigned int)DMA_BLOCK << DTC_MRA_MD_1_0, 3u << DTC_MRA_MD_1_0);
+    t.cr = ((size & 0xFF) << 24) | ((size & 0xFF) << 16) | (blocks & 0xFFFF);
+    return t;
+  }
+
+  // Run time addresses, for buffers
+  DtcInfo &from(unsigned int a) { sar = a; return *this; }
+  DtcInfo &to(unsigned int a) { dar = a; return *this; }
+};
+
+// Normal mode, both addresses incrementing
+constexpr DtcInfo dtc_transfer(unsigned int dst, unsigned int src, unsigned int count, DmaSize size = DMA_8) {
+  return DtcInfo{((unsigned int)size << DTC_MRA_SZ_1_0) | ((unsigned int)DMA_INC << DTC_MRA_SM_1_0) | ((unsigned int)DMA_INC << DTC_MRB_DM_1_0),
+                 src, dst, (count & 0xFFFF) << 16};
+}
+
+static_assert(sizeof(DtcInfo) == 16, "DTC transfer information is 4 words");
+static_assert(dtc_transfer(0, 0, 5).cr == 0x00050000u && dtc_transfer(0, 0, 0).block(4, 3).cr == 0x04040003u,
+              "Word 3 is CRA in b31-16, CRB in b15-0");
+
+
+// ==== Vector table ====
+
+#ifdef RA4M1_HOST_SIM
+constexpr unsigned int DTC_SIM_VECTORS = 0x20007C00;
+#else
+alignas(1024) inline volatile unsigned int dtc_vector_table[IRQ_SLOTS];
+#endif
+
+inline volatile unsigned int *dtc_vectors() {
+  unsigned int vbr = mmio_read(DTC_DTCVBR);
+#ifdef RA4M1_HOST_SIM
+  return (volatile unsigned int *)sim_map(vbr ? vbr : DTC_SIM_VECTORS);
+#else
+  return vbr ? (volatile unsigned int *)vbr : dtc_vector_table;
+#endif
+}
+
+inline void dtc_begin(bool read_skip = false) {
+  dmac_dtc_power_on();
+  mmio_write(DTC_DTCST, (unsigned char)0);
+  if(!mmio_read(DTC_DTCVBR)) {
+#ifdef RA4M1_HOST_SIM
+    mmio_write(DTC_DTCVBR, DTC_SIM_VECTORS);
+#else
+    mmio_write(DTC_DTCVBR, (unsigned int)dtc_vector_table);
+#endif
+  }
+  mmio_write(DTC_DTCCR, (unsigned char)(read_skip ? 1 << DTCCR_RRS : 0));
+  mmio_write(DTC_DTCST, (unsigned char)(1 << DTCST_DTCST));
+}
+
+// Event into the slot, the slot onto the DTC. 'done' runs when a count ends, or after every
+// transfer with .irq_each()
+inline void dtc_link(unsigned int slot, unsigned int event, DtcInfo *chain, IrqHandler done = nullptr, unsigned int priority = 12) {
+  irq_disable(slot);
+  mmio_write(ICU_IELSR00 + slot, 0u);
+  dtc_vectors()[slot] = dtc_addr(chain);
+  irq_priority(slot, priority);
+  if(done) irq_vector(slot, done);
+  mmio_write(NVIC_ICPR0, 1u << slot);
+  mmio_write(ICU_IELSR00 + slot, (event << IELSR_IELS_7_0) | (1u << IELSR_DTCE));
+  if(done) irq_enable(slot);
+}
+
+// In the handler: clear IELSR_IR and hand the slot back to the DTC
+inline void dtc_rearm(unsigned int slot) {
+  volatile unsigned int *ielsr = ICU_IELSR00 + slot;
+  mmio_write(ielsr, (mmio_read(ielsr) & ~(1u << IELSR_IR)) | (1u << IELSR_DTCE));
+}
+
+inline void dtc_unlink(unsigned int slot) {
+  irq_unlink(slot);
+  dtc_vectors()[slot] = 0;
+}
+
+inline bool dtc_active() { return mmio_read(DTC_DTCSTS) & (1u << DTCSTS_ACT); }
+
+
+#ifdef RA4M1_HOST_SIM
+// ==== Simulated DTC ====
+// An event on a slot with IELSR_DTCE runs the records from the slot's vector, writing them back
+// as the DTC does. When the last record run has ended its count (or has DISEL) DTCE is cleared
+// on an end and sim_irq_slot() interrupts the CPU.
+//
+//   ra4m1::sim_reset();
+//   ra4m1::SimDtc dtc;  dtc.attach();
+//   ra4m1::dtc_begin();
+//   ra4m1::dtc_link(9, IRQ_ADC140_ADI, chain);     // chain in the SRAM image
+//   ra4m1::sim_irq_raise(IRQ_ADC140_ADI);
+
+struct SimDtc {
+  unsigned int activations = 0;
+  unsigned int records = 0;   // Transfer information records run
+  unsigned int transfers = 0; // Units moved
+
+  void attach() { sim_on_event([this](unsigned int event) { this->event(event); }); }
+
+  void event(unsigned int event) {
+    if(!(sim_peek<unsigned char>(DTCBASE + 0x0C) & (1 << DTCST_DTCST))) return;
+    for(unsigned int slot = 0; slot < IRQ_SLOTS; slot++) {
+      unsigned int v = sim_peek<unsigned int>(ICUBASE + IELSR + slot * 4);
+      if(((v >> IELSR_IELS_7_0) & 0xFF) == event && (v & (1u << IELSR_DTCE))) activate(slot);
+    }
+  }
+
+  void unit(unsigned int sar, unsigned int dar, unsigned int size) {
+    if(size == 1) sim_write<unsigned char>(dar, sim_read<unsigned char>(sar));
+    else if(size == 2) sim_write<unsigned short>(dar, sim_read<unsigned short>(sar));
+    else sim_write<unsigned int>(dar, sim_read<unsigned int>(sar));
+    transfers++;
+  }
+
+  static unsigned int step(unsigned int addr, unsigned int mode, int n) { return mode == DMA_INC ? addr + n : mode == DMA_DEC ? addr - n : addr; }
+
+  void activate(unsigned int slot) {
+    activations++;
+    unsigned int rec = sim_peek<unsigned int>(sim_peek<unsigned int>(DTCBASE + 0x04) + slot * 4);
+    for(;;) {
+      records++;
+      unsigned int mode = sim_peek<unsigned int>(rec), sar = sim_peek<unsigned int>(rec + 4), dar = sim_peek<unsigned int>(rec + 8), cr = sim_peek<unsigned int>(rec + 12);
+      unsigned int md = (mode >> DTC_MRA_MD_1_0) & 3, size = 1u << ((mode >> DTC_MRA_SZ_1_0) & 3);
+      unsigned int sm = (mode >> DTC_MRA_SM_1_0) & 3, dm = (mode >> DTC_MRB_DM_1_0) & 3;
+      bool src_area = mode & (1u << DTC_MRB_DTS), end = false, count_end = false;
+      if(md == DMA_NORMAL) {
+        unit(sar, dar, size);
+        sar = step(sar, sm, (int)size);
+        dar = step(dar, dm, (int)size);
+        cr = ((((cr >> 16) - 1) & 0xFFFF) << 16) | (cr & 0xFFFF);  // CRA
+        end = count_end = (cr >> 16) == 0;
+      } else {
+        unsigned int area = (cr >> 24) & 0xFF ? (cr >> 24) & 0xFF : 256;  // CRAH
+        unsigned int n = md == DMA_BLOCK ? area : 1;
+        for(unsigned int i = 0; i < n; i++) {
+          unit(sar, dar, size);
+          sar = step(sar, sm, (int)size);
+          dar = step(dar, dm, (int)size);
+        }
+        unsigned int cral = md == DMA_BLOCK ? 0 : (((cr >> 16) & 0xFF) ? ((cr >> 16) & 0xFF) : 256) - 1;
+        if(cral == 0) {
+          count_end = true;
+          cral = area & 0xFF;
+          if(src_area) sar = step(sar, sm, -(int)(area * size));
+          else dar = step(dar, dm, -(int)(area * size));
+          if(md == DMA_BLOCK) {
+            cr = (cr & 0xFFFF0000u) | ((cr - 1) & 0xFFFF);  // CRB
+            end = (cr & 0xFFFF) == 0;
+          }
+        }
+        cr = (cr & 0xFF00FFFFu) | ((cral & 0xFF) << 16);
+      }
+      sim_poke<unsigned int>(rec + 4, sar);
+      sim_poke<unsigned int>(rec + 8, dar);
+      sim_poke<unsigned int>(rec + 12, cr);
+      bool chain = (mode & (1u << DTC_MRB_CHNE)) && (!(mode & (1u << DTC_MRB_CHNS)) || count_end);
+      if(chain) {
+        rec += 16;
+        continue;
+      }
+      if(end || (mode & (1u << DTC_MRB_DISEL))) {
+        unsigned int ielsr = ICUBASE + IELSR + slot * 4;
+        if(end) sim_poke<unsigned int>(ielsr, sim_peek<unsigned int>(ielsr) & ~(1u << IELSR_DTCE));
+        sim_irq_slot(slot);
+      }
+      return;
+    }
+  }
+};
+#endif
+
+}  // namespace ra4m1
+
+#endif  // SUSAN_RA4M1_MINIMA_DTC_H
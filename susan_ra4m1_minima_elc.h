@@ -0,0 +1,181 @@
+/*  Arduino UNO R4 Minima - ELC event routes for the RA4M1 register defines:
+ *
+ *  The Event Link Controller passes an event (the IRQ_xxx numbers) straight to a peripheral input,
+ *  with no CPU and no interrupt: ELC_ELSRnn holds the event for input nn - GPT ELC_GPTA - H, the
+ *  ADC14 triggers ELC_AD00 / AD01, the DAC12 ELC_DA0, the port groups ELC_PORT1 - 4, the CTSU.
+ *  Routes can go in a constexpr table, checked at compile time, and written in one go:
+ *
+ *    // GPT0 overflow starts an ADC scan, scan end starts a DAC conversion - no ISR anywhere
+ *    constexpr ra4m1::ElcRoute chain[] = {
+ *      ra4m1::elc_route(IRQ_GPT0_OVF,   ra4m1::ELC_AD00),
+ *      ra4m1::elc_route(IRQ_ADC140_ADI, ra4m1::ELC_DA0),
+ *    };
+ *    typedef ra4m1::ElcGraph<chain> Chain;
+ *    Chain::apply();                                     // ELC on, ELCR_ELCON, both ELSRs
+ *
+ *  Or one at a time, getting a handle back to re-route or cut later:
+ *
+ *    ra4m1::ElcLink edge = ra4m1::elc_link<IRQ_IOPORT_GROUP1, ra4m1::ELC_GPTA>();
+ *    edge.connect(IRQ_PORT_IRQ0);                        // Run time - false if not allowed
+ *    edge.disconnect();
+ *
+ *  Checked, at compile time for the table and elc_link<>(), at run time for connect(): the
+ *  event number exists; the input exists (there is no ELSR10, 11 or 13); a peripheral does not
+ *  start itself - ADC14 events to ELC_AD00 / AD01 (use continuous scan), CTSU events to ELC_CTSU,
+ *  port group n to ELC_PORTn; and in a table, no input driven twice.
+ *
+ *  Note: The peripheral still has to take its ELC input - ADSTRGR for the ADC, GTSSR / GTICASR etc.
+ *        for a GPT, the PEL / group registers for the ports. An ELSR of 0 leaves the input free.
+ *
+ *  With RA4M1_HOST_SIM, ra4m1::SimElc passes events raised with sim_irq_raise() on to a function
+ *  per input, so models of the inputs (an ADC scan, a DAC) can run on them.
+ *
+ * This code is "AS IS" without warranty or liability.
+ * GPL v3 or later - see susan_ra4m1_minima_register_defines.h
+*/
+
+#ifndef SUSAN_RA4M1_MINIMA_ELC_H
+#define SUSAN_RA4M1_MINIMA_ELC_H
+
+#include "susan_ra4m1_minima_irq.h"
+
+namespace ra4m1 {
+
+// ELC_ELSRnn number of each input
+enum ElcTarget : unsigned char {
+  ELC_GPTA = 0, ELC_GPTB = 1, ELC_GPTC = 2, ELC_GPTD = 3, ELC_GPTE = 4, ELC_GPTF = 5, ELC_GPTG = 6, ELC_GPTH = 7,
+  ELC_AD00 = 8, ELC_AD01 = 9, ELC_DA0 = 12, ELC_PORT1 = 14, ELC_PORT2 = 15, ELC_PORT3 = 16, ELC_PORT4 = 17, ELC_CTSU = 18
+};
+
+constexpr unsigned int ELC_TARGETS = 19;
+constexpr unsigned int ELC_EVENT_LAST = IRQ_SPI1_SPTEND;
+
+inline unsigned int elc_elsr(unsigned int target) { return ELCBASE + ELSR + target * 4; }
+
+constexpr bool elc_target_ok(unsigned int target) {
+  return target < ELC_TARGETS && target != 10 && target != 11 && target != 13;
+}
+
+// Numbers with no event behind them - see the IRQ_UNUSED lines of the register defines
+constexpr bool elc_event_ok(unsigned int event) {
+  return event >= IRQ_PORT_IRQ0 && event <= ELC_EVENT_LAST && event != 0x0E && event != 0x16 && event != 0x40;
+}
+
+constexpr bool elc_compatible(unsigned int event, unsigned int target) {
+  if(!elc_event_ok(event) || !elc_target_ok(target)) return false;
+  if((target == ELC_AD00 || target == ELC_AD01) && event >= IRQ_ADC140_ADI && event <= IRQ_ADC140_WCMPUM) return false;
+  if(target == ELC_CTSU && event >= IRQ_CTSU_CTSUWR && event <= IRQ_CTSU_CTSUFN) return false;
+  if(target >= ELC_PORT1 && target <= ELC_PORT4 && event == IRQ_IOPORT_GROUP1 + (target - ELC_PORT1)) return false;
+  return true;
+}
+
+// Module out of stop, links on - the ELSRs are kept
+inline void elc_begin() {
+  mmio_write(MSTP_MSTPCRC, mmio_read(MSTP_MSTPCRC) & ~(1u << MSTPC14));
+  mmio_write(ELC_ELCR, (unsigned char)(1 << ELCR_ELCON));
+}
+
+
+// ==== One route, at run time ====
+
+struct ElcLink {
+  unsigned char target;
+
+  bool connect(unsigned int event) const {
+    if(!elc_compatible(event, target)) return false;
+    mmio_write<unsigned short>(elc_elsr(target), (unsigned short)event);
+    return true;
+  }
+  void disconnect() const { mmio_write<unsigned short>(elc_elsr(target), (unsigned short)0); }
+  unsigned int event() const { return mmio_read<unsigned short>(elc_elsr(target)) & 0x1FF; }
+  bool connected() const { return event() != 0; }
+};
+
+template <unsigned int Event, ElcTarget Target>
+inline ElcLink elc_link() {
+  static_assert(elc_compatible(Event, Target), "ElcLink: no such event, or the peripheral would start itself");
+  elc_begin();
+  ElcLink l{Target};
+  l.connect(Event);
+  return l;
+}
+
+
+// ==== A set of routes ====
+
+struct ElcRoute {
+  unsigned char event;
+  unsigned char target;
+};
+
+constexpr ElcRoute elc_route(unsigned int event, ElcTarget target) { return ElcRoute{(unsigned char)event, (unsigned char)target}; }
+
+enum ElcRule : unsigned char { ELC_RULE_COMPATIBLE, ELC_RULE_UNIQUE };
+
+// Index of the first route breaking the rule, or -1
+template <unsigned int N>
+constexpr int elc_check(const ElcRoute (&table)[N], ElcRule rule) {
+  for(unsigned int i = 0; i < N; i++) {
+    if(rule == ELC_RULE_COMPATIBLE && !elc_compatible(table[i].event, table[i].target)) return (int)i;
+    if(rule == ELC_RULE_UNIQUE)
+      for(unsigned int j = i + 1; j < N; j++)
+        if(table[i].target == table[j].target) return (int)j;
+  }
+  return -1;
+}
+
+template <const auto &Table>
+struct ElcGraph {
+  static constexpr unsigned int count = sizeof(Table) / sizeof(Table[0]);
+  static_assert(elc_check(Table, ELC_RULE_COMPATIBLE) < 0, "ElcGraph: no such event or input, or a peripheral starting itself");
+  static_assert(elc_check(Table, ELC_RULE_UNIQUE) < 0, "ElcGraph: input driven by two routes");
+
+  static void apply() {
+    elc_begin();
+    for(unsigned int i = 0; i < count; i++)
+      mmio_write<unsigned short>(elc_elsr(Table[i].target), (unsigned short)Table[i].event);
+  }
+
+  static void remove() {
+    for(unsigned int i = 0; i < count; i++)
+      mmio_write<unsigned short>(elc_elsr(Table[i].target), (unsigned short)0);
+  }
+
+  static ElcLink link(unsigned int i) { return ElcLink{Table[i].target}; }
+};
+
+
+#ifdef RA4M1_HOST_SIM
+// ==== Simulated ELC ====
+// Each event raised goes to every input whose ELSR holds it, while ELCR_ELCON is set. The input
+// functions can raise events of their own - an ADC model raising IRQ_ADC140_ADI, and so on.
+//
+//   ra4m1::sim_reset();
+//   ra4m1::SimElc elc;  elc.attach();
+//   elc.on(ra4m1::ELC_AD00, [] { ...scan...; ra4m1::sim_irq_raise(IRQ_ADC140_ADI); });
+//   ra4m1::sim_irq_raise(IRQ_GPT0_OVF);
+
+struct SimElc {
+  std::function<void()> input[ELC_TARGETS];
+  unsigned int count[ELC_TARGETS] = {};  // Events delivered per input
+
+  void on(ElcTarget target, std::function<void()> fn) { input[target] = fn; }
+
+  void attach() {
+    sim_on_event([this](unsigned int event) { deliver(event); });
+  }
+
+  void deliver(unsigned int event) {
+    if(!((sim_peek<unsigned char>(ELCBASE + 0x1000) >> ELCR_ELCON) & 1)) return;
+    for(unsigned int t = 0; t < ELC_TARGETS; t++) {
+      if(!elc_target_ok(t) || (sim_peek<unsigned short>(elc_elsr(t)) & 0x1FF) != event) continue;
+      count[t]++;
+      if(input[t]) input[t]();
+    }
+  }
+};
+#endif
+
+}  // namespace ra4m1
+
+#endif  // SUSAN_RA4M1_MINIMA_ELC_H
@@ -0,0 +1,155 @@
+/*  Arduino UNO R4 Minima - single store GPIO for the RA4M1 register defines:
+ *
+ *  Pin<D13> turns an Arduino pin number into its port and bit at compile time, so each of these is
+ *  one 32 bit store to the port PCNTR3 (POSR in b15-0, PORR in b31-16) or one load from PCNTR2:
+ *
+ *    ra4m1::Pin<D13>::set();                 // P111 high - str to PORT1_PCNTR3
+ *    ra4m1::Pin<D13>::clear();               // P111 low
+ *    ra4m1::Pin<D13>::toggle();              // Load PODR, one store - see note
+ *    bool b = ra4m1::Pin<D12>::read();       // ldr from PORT1_PCNTR2
+ *
+ *  Pins on the same port go together, still one store - D10 / D11 / D13 are all on port 1:
+ *
+ *    typedef ra4m1::PinGroup<D10, D11, D13> Spi;
+ *    Spi::set();                             // All three high
+ *    Spi::write(0b101);                      // D10 high, D11 low, D13 high - bit n for the nth pin
+ *
+ *  Unlike digitalWrite() there is no table lookup, and unlike a PFS_PmnPFS_BY write there is no
+ *  read-modify-write of the other pin bits and no PWPR to worry about. PCNTR3 only changes the
+ *  pins with a 1 in the word, so an interrupt writing other pins of the port can't be undone.
+ *
+ *  Pin numbers are the Arduino ones, D0 - D19 (A0 - A5 are D14 - D19). PortPin<1, 11> names a port
+ *  pin directly, for the ones without an Arduino number - PortPin<0, 12> is the TX LED.
+ *
+ *  Note: toggle() reads PODR then writes PCNTR3; if an ISR sets the same pin between the two, the
+ *        toggle is from the old level. The pins still have to be outputs - output() / input() do
+ *        that through PCNTR1 (PODR in b31-16, PDR in b15-0) with interrupts off.
+ *
+ * This code is "AS IS" without warranty or liability.
+ * GPL v3 or later - see susan_ra4m1_minima_register_defines.h
+*/
+
+#ifndef SUSAN_RA4M1_MINIMA_GPIO_H
+#define SUSAN_RA4M1_MINIMA_GPIO_H
+
+#include "susan_ra4m1_minima_irq.h"
+
+namespace ra4m1 {
+
+// ==== Arduino pin numbers ====
+// The Arduino core may already have these - D0 and A0 are skipped then
+
+#ifndef D0
+constexpr unsigned int D0 = 0, D1 = 1, D2 = 2, D3 = 3, D4 = 4, D5 = 5, D6 = 6, D7 = 7, D8 = 8, D9 = 9,
+                       D10 = 10, D11 = 11, D12 = 12, D13 = 13, D14 = 14, D15 = 15, D16 = 16, D17 = 17, D18 = 18, D19 = 19;
+#endif
+#ifndef A0
+constexpr unsigned int A0 = 14, A1 = 15, A2 = 16, A3 = 17, A4 = 18, A5 = 19;
+#endif
+
+constexpr unsigned int GPIO_PINS = 20;
+
+// Port * 16 + bit, for D0 - D19 - see the PFS_PmnPFS comments in the register defines
+constexpr unsigned char GPIO_PIN_MAP[GPIO_PINS] = {
+  0x31, 0x32, 0x15, 0x14, 0x13, 0x12, 0x16, 0x17,  // D0 P301, D1 P302, D2 P105, D3 P104, D4 P103, D5 P102, D6 P106, D7 P107
+  0x34, 0x33, 0x1C, 0x19, 0x1A, 0x1B,              // D8 P304, D9 P303, D10 P112, D11 P109, D12 P110, D13 P111
+  0x0E, 0x00, 0x01, 0x02, 0x11, 0x10               // A0 P014, A1 P000, A2 P001, A3 P002, A4 P101, A5 P100
+};
+
+constexpr unsigned int gpio_port(unsigned int pin) { return GPIO_PIN_MAP[pin] >> 4; }
+constexpr unsigned int gpio_bit(unsigned int pin)  { return GPIO_PIN_MAP[pin] & 0xF; }
+
+constexpr unsigned int gpio_port_addr(unsigned int port, unsigned int reg) { return PORTBASE + reg + port * 0x20; }
+
+
+// ==== One port, a set of its pins ====
+
+template <unsigned int Port, unsigned short Mask>
+struct PortPins {
+  static_assert(Port <= 9, "RA4M1 ports are 0 - 9");
+  static constexpr unsigned int port = Port;
+  static constexpr unsigned short mask = Mask;
+  static constexpr unsigned int pcntr1 = gpio_port_addr(Port, PCNTR1);
+  static constexpr unsigned int pcntr2 = gpio_port_addr(Port, PCNTR2);
+  static constexpr unsigned int pcntr3 = gpio_port_addr(Port, PCNTR3);
+
+  static void set()   { mmio_write<unsigned int>(pcntr3, Mask); }
+  static void clear() { mmio_write<unsigned int>(pcntr3, (unsigned int)Mask << 16); }
+
+  // Port bits in place: 1s in 'bits' go high, the rest of Mask low - one store
+  static void write_port(unsigned short bits) {
+    mmio_write<unsigned int>(pcntr3, (bits & Mask) | ((unsigned int)(~bits & Mask) << 16));
+  }
+
+  static void toggle() {
+    unsigned int podr = (mmio_read<unsigned int>(pcntr1) >> 16) & Mask;
+    mmio_write<unsigned int>(pcntr3, (~podr & Mask) | (podr << 16));
+  }
+
+  static unsigned short read_port() { return mmio_read<unsigned int>(pcntr2) & Mask; }  // PIDR
+  static unsigned short output_level() { return (mmio_read<unsigned int>(pcntr1) >> 16) & Mask; }  // PODR
+
+  static void output() {
+    unsigned int primask = irq_save();
+    mmio_write<unsigned int>(pcntr1, mmio_read<unsigned int>(pcntr1) | Mask);
+    irq_restore(primask);
+  }
+
+  static void input() {
+    unsigned int primask = irq_save();
+    mmio_write<unsigned int>(pcntr1, mmio_read<unsigned int>(pcntr1) & ~(unsigned int)Mask);
+    irq_restore(primask);
+  }
+};
+
+template <unsigned int Port, unsigned int Bit>
+struct PortPin : PortPins<Port, (unsigned short)(1u << Bit)> {
+  static_assert(Bit < 16, "Port pins are 0 - 15");
+  typedef PortPins<Port, (unsigned short)(1u << Bit)> base;
+  static constexpr unsigned int bit = Bit;
+
+  static void write(bool b) { mmio_write<unsigned int>(base::pcntr3, b ? (1u << Bit) : (1u << (Bit + 16))); }
+  static bool read() { return (mmio_read<unsigned int>(base::pcntr2) >> Bit) & 1; }
+};
+
+template <unsigned int N>
+struct Pin : PortPin<gpio_port(N < GPIO_PINS ? N : 0), gpio_bit(N < GPIO_PINS ? N : 0)> {
+  static_assert(N < GPIO_PINS, "Arduino pins are D0 - D19");
+  static constexpr unsigned int number = N;
+};
+
+
+// ==== Several Arduino pins, all on one port ====
+
+template <unsigned int First, unsigned int... Rest>
+struct PinGroup : PortPins<gpio_port(First), (unsigned short)((1u << gpio_bit(First)) | ... | (1u << gpio_bit(Rest)))> {
+  static_assert(First < GPIO_PINS && ((Rest < GPIO_PINS) && ...), "Arduino pins are D0 - D19");
+  static_assert(((gpio_port(Rest) == gpio_port(First)) && ...), "PinGroup pins must all be on the same port");
+  typedef PortPins<gpio_port(First), (unsigned short)((1u << gpio_bit(First)) | ... | (1u << gpio_bit(Rest)))> base;
+  static constexpr unsigned int count = 1 + sizeof...(Rest);
+
+  // Bit n of 'value' for the nth pin in the list, into port bit positions
+  static constexpr unsigned short spread(unsigned int value) {
+    constexpr unsigned char bits[] = {(unsigned char)gpio_bit(First), (unsigned char)gpio_bit(Rest)...};
+    unsigned short out = 0;
+    for(unsigned int i = 0; i < count; i++)
+      if((value >> i) & 1) out |= (unsigned short)(1u << bits[i]);
+    return out;
+  }
+
+  // And back: port bits to bit n for the nth pin
+  static constexpr unsigned int gather(unsigned short port_bits) {
+    constexpr unsigned char bits[] = {(unsigned char)gpio_bit(First), (unsigned char)gpio_bit(Rest)...};
+    unsigned int out = 0;
+    for(unsigned int i = 0; i < count; i++)
+      if((port_bits >> bits[i]) & 1) out |= 1u << i;
+    return out;
+  }
+
+  static void write(unsigned int value) { base::write_port(spread(value)); }
+  static unsigned int read() { return gather(base::read_port()); }
+};
+
+}  // namespace ra4m1
+
+#endif  // SUSAN_RA4M1_MINIMA_GPIO_H
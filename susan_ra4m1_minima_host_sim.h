@@ -0,0 +1,245 @@
+/*  Arduino UNO R4 Minima - host (Linux) simulated register space for the RA4M1 register defines:
+ *
+ *  Build with -DRA4M1_HOST_SIM and susan_ra4m1_minima_register_defines.h includes this file and
+ *  turns every base address (SYSTEM, ICUBASE, PORTBASE, ADCBASE, SCIBASE, NVICBASE, etc.) into an
+ *  ra4m1::SimAddr, which points into a memory image here rather than at the real peripherals.
+ *  Code written with the defines then compiles and runs unchanged in a unit test or benchmark:
+ *
+ *    *PORT1_PODR = 0x1234;                                   // Plain store into the image
+ *    ra4m1::sim_on_read(SYSTEM + 0xE03C, [](unsigned int, unsigned int v) { return v | 0x29; });
+ *    while(!(*SYSTEM_OSCSF & (1 << OSCSF_PLLSF))) {};        // Raw macro: reads the image as-is
+ *    ra4m1::OSCSF::PLLSF.read();                              // Typed layer: goes via the hook
+ *
+ *  Memory image, byte for byte the same layout as the chip:
+ *    0x00000000 - 0x00000FFF  Option-setting memory
+ *    0x20000000 - 0x20007FFF  SRAM - for DMA / DTC buffers and tables the hardware reads by address
+ *    0x40000000 - 0x400FFFFF  Peripherals  (+ bit-band alias 0x42000000 - 0x43FFFFFF)
+ *    0xE0000000 - 0xE000FFFF  Cortex-M4 private peripherals - NVIC, SCB, DWT
+ *
+ *  The NVIC set / clear enable and pending registers act as on the chip, when written through the
+ *  typed layer or ra4m1::mmio_write(). So does a 32 bit port PCNTR3 write: POSR / PORR bits set
+ *  and clear PODR, and output pins follow in PIDR.
+ *
+ *  Note: Read/write hooks only see accesses made through the typed layer (register_types.h) and
+ *        the bit-band macros; a raw *REG = x is a plain host memory store, the same as on the chip.
+ *
+ *  Host only - needs a C++17 compiler and the standard library.
+ *
+ * This code is "AS IS" without warranty or liability.
+ * GPL v3 or later - see susan_ra4m1_minima_register_defines.h
+*/
+
+#ifndef SUSAN_RA4M1_MINIMA_HOST_SIM_H
+#define SUSAN_RA4M1_MINIMA_HOST_SIM_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+namespace ra4m1 {
+
+alignas(8) inline unsigned char sim_option[0x1000];       // 0x00000000
+alignas(8) inline unsigned char sim_sram[0x8000];         // 0x20000000
+alignas(8) inline unsigned char sim_peripheral[0x100000]; // 0x40000000
+alignas(8) inline unsigned char sim_ppb[0x10000];         // 0xE0000000
+
+// Stands in for DWT_CYCCNT: one count per typed access, tests can add more to model time passing
+inline unsigned long long sim_cycle_count = 0;
+
+// Physical address to host pointer - anything outside the image is a bug in the code under test
+inline void *sim_map(unsigned int addr) {
+  if(addr < 0x00001000) return sim_option + addr;
+  if(addr - 0x20000000u < 0x8000) return sim_sram + (addr - 0x20000000u);
+  if(addr - 0x40000000u < 0x100000) return sim_peripheral + (addr - 0x40000000u);
+  if(addr - 0xE0000000u < 0x10000) return sim_ppb + (addr - 0xE0000000u);
+  std::fprintf(stderr, "ra4m1 sim: access to 0x%08X is outside the simulated register space\n", addr);
+  std::abort();
+}
+
+// A base address define, as seen by a host build: adds offsets like an integer, converts to a
+// register pointer into the image, and still gives the chip address to the typed layer templates
+struct SimAddr {
+  unsigned int phys;
+  constexpr explicit SimAddr(unsigned int addr) : phys(addr) {}
+  template <typename I> constexpr SimAddr operator+(I offset) const { return SimAddr(phys + (unsigned int)offset); }
+  template <typename I> constexpr SimAddr operator-(I offset) const { return SimAddr(phys - (unsigned int)offset); }
+  constexpr operator unsigned int() const { return phys; }
+  template <typename T> operator T *() const { return (T *)sim_map(phys); }
+};
+
+
+// ==== Read / write hooks ====
+// Read hook:  (address, value in image) -> value the code sees
+// Write hook: (address, value written)  -> value stored in the image
+
+typedef std::function<unsigned int(unsigned int addr, unsigned int value)> SimHook;
+
+struct SimHookEntry {
+  unsigned int addr;
+  SimHook read;
+  SimHook write;
+};
+
+inline std::vector<SimHookEntry> sim_hooks;
+
+inline SimHookEntry *sim_hook_find(unsigned int addr) {
+  for(SimHookEntry &h : sim_hooks) if(h.addr == addr) return &h;
+  return nullptr;
+}
+
+inline SimHookEntry &sim_hook_entry(unsigned int addr) {
+  if(SimHookEntry *h = sim_hook_find(addr)) return *h;
+  sim_hooks.push_back(SimHookEntry{addr, SimHook(), SimHook()});
+  return sim_hooks.back();
+}
+
+inline void sim_on_read(unsigned int addr, SimHook hook)  { sim_hook_entry(addr).read  = hook; }
+inline void sim_on_write(unsigned int addr, SimHook hook) { sim_hook_entry(addr).write = hook; }
+
+// Models that act on ICU events (the DMAC, the DTC) - sim_irq_raise() calls each with the event
+// number before it looks at the NVIC
+inline std::vector<std::function<void(unsigned int event)>> sim_event_hooks;
+
+inline void sim_on_event(std::function<void(unsigned int event)> hook) { sim_event_hooks.push_back(hook); }
+
+// Clear the whole image and drop all hooks - call at the start of each test
+inline void sim_reset() {
+  std::memset(sim_option, 0, sizeof(sim_option));
+  std::memset(sim_sram, 0, sizeof(sim_sram));
+  std::memset(sim_peripheral, 0, sizeof(sim_peripheral));
+  std::memset(sim_ppb, 0, sizeof(sim_ppb));
+  sim_hooks.clear();
+  sim_event_hooks.clear();
+  sim_cycle_count = 0;
+}
+
+// Direct image access, bypassing hooks - for setting up and checking register state in tests
+template <typename T> inline T sim_peek(unsigned int addr) { T v; std::memcpy(&v, sim_map(addr), sizeof(T)); return v; }
+template <typename T> inline void sim_poke(unsigned int addr, T v) { std::memcpy(sim_map(addr), &v, sizeof(T)); }
+
+
+// ==== Register accesses from the typed layer ====
+// Bit-band alias words are turned into a set / clear of the bit in the image
+
+inline bool sim_bitband_alias(unsigned int addr) { return addr - 0x42000000u < 0x2000000; }
+
+template <typename T>
+inline T sim_read(unsigned int addr) {
+  sim_cycle_count++;
+  if(sim_bitband_alias(addr)) {
+    unsigned int offset = (addr - 0x42000000u) / 4;
+    return (T)((sim_read<unsigned char>(0x40000000u + offset / 8) >> (offset % 8)) & 1);
+  }
+  T v = sim_peek<T>(addr);
+  if(SimHookEntry *h = sim_hook_find(addr))
+    if(h->read) v = (T)h->read(addr, v);
+  return v;
+}
+
+// NVIC ISER / ICER / ISPR / ICPR: writing 1s sets or clears bits, both halves read back the state
+inline bool sim_nvic_set_clear(unsigned int addr) { return addr - 0xE000E100u < 0x200; }
+
+inline void sim_nvic_write(unsigned int addr, unsigned int v) {
+  unsigned int n = (addr - 0xE000E100u) % 0x80;
+  unsigned int set = 0xE000E100u + ((addr - 0xE000E100u) / 0x100) * 0x100 + n;  // ISER or ISPR
+  unsigned int state = sim_peek<unsigned int>(set);
+  state = ((addr - 0xE000E100u) % 0x100 < 0x80) ? (state | v) : (state & ~v);
+  sim_poke<unsigned int>(set, state);
+  sim_poke<unsigned int>(set + 0x80, state);
+}
+
+// Port PCNTR3: POSR / PORR set and clear PODR (PCNTR1 b31-16); output pins read back in PIDR
+inline bool sim_port_pcntr3(unsigned int addr) { return addr - 0x40040000u < 0x140 && (addr & 0x1F) == 0x08; }
+
+inline void sim_port_write(unsigned int addr, unsigned int v) {
+  unsigned int port = addr - 0x08;
+  unsigned int pcntr1 = sim_peek<unsigned int>(port);
+  unsigned int podr = ((pcntr1 >> 16) | (v & 0xFFFF)) & ~(v >> 16);
+  sim_poke<unsigned int>(port, (pcntr1 & 0xFFFF) | (podr << 16));
+  unsigned int pdr = pcntr1 & 0xFFFF;
+  unsigned int pcntr2 = sim_peek<unsigned int>(port + 0x04);
+  sim_poke<unsigned int>(port + 0x04, (pcntr2 & ~pdr) | (podr & pdr));
+}
+
+template <typename T>
+inline void sim_write(unsigned int addr, T v) {
+  sim_cycle_count++;
+  if(sizeof(T) == 4 && sim_nvic_set_clear(addr)) {
+    sim_nvic_write(addr, (unsigned int)v);
+    return;
+  }
+  if(sizeof(T) == 4 && sim_port_pcntr3(addr)) {
+    sim_port_write(addr, (unsigned int)v);
+    return;
+  }
+  if(sim_bitband_alias(addr)) {
+    unsigned int offset = (addr - 0x42000000u) / 4;
+    unsigned int byte = 0x40000000u + offset / 8;
+    unsigned char mask = (unsigned char)(1 << (offset % 8));
+    unsigned char b = sim_peek<unsigned char>(byte);
+    sim_write<unsigned char>(byte, (v & 1) ? (unsigned char)(b | mask) : (unsigned char)(b & ~mask));
+    return;
+  }
+  if(SimHookEntry *h = sim_hook_find(addr))
+    if(h->write) v = (T)h->write(addr, v);
+  sim_poke<T>(addr, v);
+}
+
+
+// ==== Bit-band macros on the host ====
+// *BITBAND_PERI(reg, bit) = 1 becomes a set of the bit in the image, through the hooks
+
+struct SimBit {
+  unsigned int addr;
+  unsigned int bit;
+  unsigned int get() const { return (sim_read<unsigned char>(addr) >> bit) & 1; }
+  operator unsigned int() const { return get(); }
+  const SimBit &operator=(unsigned int v) const {
+    unsigned char b = sim_peek<unsigned char>(addr);
+    sim_write<unsigned char>(addr, (v & 1) ? (unsigned char)(b | (1 << bit)) : (unsigned char)(b & ~(1 << bit)));
+    return *this;
+  }
+};
+
+struct SimBitBand {
+  unsigned int addr;
+  unsigned int bit;
+  unsigned int alias;  // The alias word BITBAND_PERI() gives on the chip, the same sum
+  SimBitBand(unsigned int a, unsigned int b) : addr(a + b / 8), bit(b % 8), alias(0x42000000u + ((a - 0x40000000u) * 32) + (b * 4)) {}
+  SimBit operator*() const { return SimBit{addr, bit}; }
+};
+
+// BITBAND_SRAM() - the variable is in host memory, so just set / clear the bit there
+struct SimRamBit {
+  volatile unsigned char *p;
+  unsigned int bit;
+  operator unsigned int() const { return (*p >> bit) & 1; }
+  const SimRamBit &operator=(unsigned int v) const {
+    *p = (v & 1) ? (unsigned char)(*p | (1 << bit)) : (unsigned char)(*p & ~(1 << bit));
+    return *this;
+  }
+};
+
+struct SimRamBitBand {
+  volatile unsigned char *p;
+  unsigned int bit;
+  SimRamBitBand(volatile void *v, unsigned int b) : p((volatile unsigned char *)v + b / 8), bit(b % 8) {}
+  SimRamBit operator*() const { return SimRamBit{p, bit}; }
+};
+
+// Host pointer back to the chip address it stands for
+inline unsigned int sim_phys(const volatile void *p) {
+  const unsigned char *c = (const unsigned char *)p;
+  if(c >= sim_option && c < sim_option + sizeof(sim_option)) return (unsigned int)(c - sim_option);
+  if(c >= sim_sram && c < sim_sram + sizeof(sim_sram)) return 0x20000000u + (unsigned int)(c - sim_sram);
+  if(c >= sim_peripheral && c < sim_peripheral + sizeof(sim_peripheral)) return 0x40000000u + (unsigned int)(c - sim_peripheral);
+  if(c >= sim_ppb && c < sim_ppb + sizeof(sim_ppb)) return 0xE0000000u + (unsigned int)(c - sim_ppb);
+  std::fprintf(stderr, "ra4m1 sim: %p is not a simulated register\n", p);
+  std::abort();
+}
+
+}  // namespace ra4m1
+
+#endif  // SUSAN_RA4M1_MINIMA_HOST_SIM_H
@@ -0,0 +1,281 @@
+/*  Arduino UNO R4 Minima - interrupt slot linking for the RA4M1 register defines:
+ *
+ *  The RA4M1 NVIC has 32 interrupt slots; ICU_IELSRnn says which event (IRQ_xxx) drives slot nn.
+ *  Linking an event is always the same five steps - IELSR, NVIC_IPRnn_BY priority, the handler into
+ *  the vector table, clear pending, set enable - then a DSB, so here they are in one place:
+ *
+ *    ra4m1::irq_link(12, IRQ_CAC_MENDI, 6, cac_mendi_isr);   // Slot 12, priority 6 of 0..15
+ *
+ *    void cac_mendi_isr() {
+ *      ra4m1::irq_ack(12);                                   // Clear IELSR_IR, or it fires again
+ *      ...
+ *    }
+ *
+ *  Or let irq_alloc() pick a free slot - it returns the slot number for irq_ack(), or -1:
+ *
+ *    int slot = ra4m1::irq_alloc(IRQ_CAC_MENDI, 6, cac_mendi_isr);
+ *    ...
+ *    ra4m1::irq_free(slot);
+ *
+ *  Note: The handler goes into the vector table SCB_VTOR points at - the Arduino core copies it
+ *        to RAM at startup, so that works there; irq_alloc() copies a flash table to RAM first.
+ *        Pass nullptr to keep a handler already in place. For irq_link(), pick a slot the
+ *        Arduino core is not using - see the Default Arduino Startup list in the register
+ *        defines; USB and the AGT0 millis() timer take the first few. irq_alloc() skips any
+ *        slot with an event or an NVIC enable, but can't know about one the core links later -
+ *        call it after Serial.begin() etc., or irq_reserve() the slot.
+ *
+ * This code is "AS IS" without warranty or liability.
+ * GPL v3 or later - see susan_ra4m1_minima_register_defines.h
+*/
+
+#ifndef SUSAN_RA4M1_MINIMA_IRQ_H
+#define SUSAN_RA4M1_MINIMA_IRQ_H
+
+#include "susan_ra4m1_minima_register_types.h"
+
+namespace ra4m1 {
+
+constexpr unsigned int IRQ_SLOTS = 32;       // See NVIC_ICTR
+constexpr unsigned int IRQ_VECTOR_FIRST = 16; // Slot 0 is vector table entry 16, after the Cortex-M4 exceptions
+
+typedef void (*IrqHandler)();
+
+// Bus synchronisation after NVIC writes - see the NVIC section of the register defines
+inline void dsb() {
+#ifndef RA4M1_HOST_SIM
+  asm volatile("dsb" ::: "memory");
+#endif
+}
+
+#ifdef RA4M1_HOST_SIM
+inline IrqHandler sim_irq_vectors[IRQ_SLOTS];  // The vector table, host side
+inline unsigned int sim_primask = 0;           // Set by irq_save() - slot interrupts wait in sim_irq_held
+inline unsigned int sim_irq_held = 0;
+inline unsigned int sim_basepri = 0;           // Set by irq_ceiling() - slots at or below it wait too
+inline void sim_irq_release();
+#endif
+
+// All interrupts off around a few register writes - returns the PRIMASK to put back
+inline unsigned int irq_save() {
+#ifdef RA4M1_HOST_SIM
+  unsigned int primask = sim_primask;
+  sim_primask = 1;
+  return primask;
+#else
+  unsigned int primask;
+  asm volatile("mrs %0, primask\n\tcpsid i" : "=r"(primask) :: "memory");
+  return primask;
+#endif
+}
+
+inline void irq_restore(unsigned int primask) {
+#ifdef RA4M1_HOST_SIM
+  sim_primask = primask;
+  if(!primask) sim_irq_release();
+#else
+  asm volatile("msr primask, %0" :: "r"(primask) : "memory");
+#endif
+}
+
+// Only the slots at priority 'ceiling' and below (numerically >= ceiling) off - the more urgent
+// ones still run. BASEPRI_MAX, so a nested section never lowers the mask; ceiling 0 masks nothing,
+// use irq_save() for that. Returns the BASEPRI to put back
+inline unsigned int irq_ceiling(unsigned int ceiling) {
+  unsigned int mask = (ceiling << 4) & 0xFF;
+#ifdef RA4M1_HOST_SIM
+  unsigned int basepri = sim_basepri;
+  if(mask && (!basepri || mask < basepri)) sim_basepri = mask;
+  return basepri;
+#else
+  unsigned int basepri;
+  asm volatile("mrs %0, basepri\n\tmsr basepri_max, %1" : "=&r"(basepri) : "r"(mask) : "memory");
+  return basepri;
+#endif
+}
+
+inline void irq_ceiling_restore(unsigned int basepri) {
+#ifdef RA4M1_HOST_SIM
+  sim_basepri = basepri;
+  sim_irq_release();
+#else
+  asm volatile("msr basepri, %0" :: "r"(basepri) : "memory");
+#endif
+}
+
+inline void irq_vector(unsigned int slot, IrqHandler handler) {
+#ifdef RA4M1_HOST_SIM
+  sim_irq_vectors[slot] = handler;
+#else
+  ((volatile unsigned int *)*SCB_VTOR)[IRQ_VECTOR_FIRST + slot] = (unsigned int)handler;
+#endif
+}
+
+inline void irq_enable(unsigned int slot)  { mmio_write(NVIC_ISER0, 1u << slot); dsb(); }
+inline void irq_disable(unsigned int slot) { mmio_write(NVIC_ICER0, 1u << slot); dsb(); }
+
+// Priority 0 (highest) to 15 - the RA4M1 has the top 4 bits of each byte
+inline void irq_priority(unsigned int slot, unsigned int priority) {
+  mmio_write(NVIC_IPR00_BY + slot, (unsigned char)(priority << 4));
+}
+
+// Event into slot, priority, handler, then enable
+inline void irq_link(unsigned int slot, unsigned int event, unsigned int priority, IrqHandler handler) {
+  mmio_write(NVIC_ICER0, 1u << slot);
+  dsb();
+  mmio_write(ICU_IELSR00 + slot, event << IELSR_IELS_7_0);
+  irq_priority(slot, priority);
+  if(handler) irq_vector(slot, handler);
+  mmio_write(NVIC_ICPR0, 1u << slot);
+  irq_enable(slot);
+}
+
+inline void irq_unlink(unsigned int slot) {
+  irq_disable(slot);
+  mmio_write(ICU_IELSR00 + slot, 0u);
+}
+
+// In the handler - clear the ICU status flag for the slot
+inline void irq_ack(unsigned int slot) {
+  volatile unsigned int *ielsr = ICU_IELSR00 + slot;
+  mmio_write(ielsr, mmio_read(ielsr) & ~(1u << IELSR_IR));
+}
+
+inline unsigned int irq_event(unsigned int slot) {
+  return (mmio_read(ICU_IELSR00 + slot) >> IELSR_IELS_7_0) & 0xFF;
+}
+
+
+// ==== Slot allocator ====
+// irq_alloc() finds a slot with no event in its IELSR, not enabled in the NVIC and not reserved
+// here, from slot 31 down - the Arduino core hands its slots out from 0 up. The handler goes
+// straight into the vector table, no dispatch table in between, so the table has to be in RAM
+
+inline unsigned int irq_slots_reserved = 0;
+
+#ifndef RA4M1_HOST_SIM
+// 16 Cortex-M4 exceptions + 32 slots = 192 bytes, VTOR wants the next power of two
+alignas(256) inline volatile unsigned int irq_ram_vectors[IRQ_VECTOR_FIRST + IRQ_SLOTS];
+#endif
+
+// Copy a flash vector table to RAM and point SCB_VTOR at it - nothing to do when it is in RAM already
+inline void irq_vectors_to_ram() {
+#ifndef RA4M1_HOST_SIM
+  unsigned int vtor = mmio_read(SCB_VTOR);
+  if(vtor >= 0x20000000) return;
+  unsigned int primask = irq_save();
+  for(unsigned int i = 0; i < IRQ_VECTOR_FIRST + IRQ_SLOTS; i++)
+    irq_ram_vectors[i] = ((const volatile unsigned int *)vtor)[i];
+  mmio_write(SCB_VTOR, (unsigned int)irq_ram_vectors);
+  dsb();
+  asm volatile("isb" ::: "memory");
+  irq_restore(primask);
+#endif
+}
+
+inline bool irq_slot_free(unsigned int slot) {
+  return !((irq_slots_reserved >> slot) & 1) && !mmio_read(ICU_IELSR00 + slot) && !((mmio_read(NVIC_ISER0) >> slot) & 1);
+}
+
+// Keep a slot away from irq_alloc(), e.g. one the core links later
+inline void irq_reserve(unsigned int slot) { irq_slots_reserved |= 1u << slot; }
+
+// Reserve a free slot, nothing linked yet (for dtc_link(), dma_start()) - the slot, or -1
+inline int irq_alloc_slot() {
+  irq_vectors_to_ram();
+  unsigned int primask = irq_save();
+  int slot = -1;
+  for(int s = IRQ_SLOTS - 1; s >= 0 && slot < 0; s--)
+    if(irq_slot_free(s)) slot = s;
+  if(slot >= 0) irq_reserve(slot);
+  irq_restore(primask);
+  return slot;
+}
+
+// Reserve a free slot and link the event to it - returns the slot, or -1 when all 32 are taken
+inline int irq_alloc(unsigned int event, unsigned int priority, IrqHandler handler) {
+  int slot = irq_alloc_slot();
+  if(slot >= 0) irq_link(slot, event, priority, handler);
+  return slot;
+}
+
+inline void irq_free(unsigned int slot) {
+  irq_unlink(slot);
+  mmio_write(NVIC_ICPR0, 1u << slot);
+  irq_slots_reserved &= ~(1u << slot);
+}
+
+// The slot an event is linked to, or -1
+inline int irq_find(unsigned int event) {
+  for(unsigned int s = 0; s < IRQ_SLOTS; s++)
+    if(mmio_read(ICU_IELSR00 + s) && irq_event(s) == event) return (int)s;
+  return -1;
+}
+
+#ifdef RA4M1_HOST_SIM
+// Timing models (the latency bench) are told when the simulated core takes, chains and leaves
+// an exception: ENTRY before the first handler, CHAIN between two handlers back to back, EXIT after
+enum SimIrqPhase : unsigned char { SIM_IRQ_ENTRY, SIM_IRQ_CHAIN, SIM_IRQ_EXIT };
+inline std::function<void(unsigned int slot, SimIrqPhase phase)> sim_irq_timing;
+
+// Handlers for a set of slots, highest priority (lowest NVIC_IPRnn) first, then lowest slot
+inline void sim_irq_run(unsigned int slots) {
+  bool first = true;
+  while(slots) {
+    unsigned int best = 0, best_prio = 0x100;
+    for(unsigned int s = 0; s < IRQ_SLOTS; s++) {
+      unsigned int prio = sim_peek<unsigned char>(NVICBASE + NVICIPR + s);
+      if(((slots >> s) & 1) && prio < best_prio) { best = s; best_prio = prio; }
+    }
+    slots &= ~(1u << best);
+    if(sim_irq_timing) sim_irq_timing(best, first ? SIM_IRQ_ENTRY : SIM_IRQ_CHAIN);
+    sim_irq_vectors[best]();
+    if(!slots && sim_irq_timing) sim_irq_timing(best, SIM_IRQ_EXIT);
+    first = false;
+  }
+}
+
+inline bool sim_irq_masked(unsigned int slot) {
+  return sim_primask || (sim_basepri && sim_peek<unsigned char>(NVICBASE + NVICIPR + slot) >= sim_basepri);
+}
+
+// irq_restore() / irq_ceiling_restore() - the slots that came in meanwhile and are no longer
+// masked, tail-chained
+inline void sim_irq_release() {
+  unsigned int run = 0;
+  for(unsigned int s = 0; s < IRQ_SLOTS; s++) {
+    if(!((sim_irq_held >> s) & 1) || sim_irq_masked(s)) continue;
+    sim_irq_held &= ~(1u << s);
+    if(((sim_peek<unsigned int>(NVICBASE + NVICISER) >> s) & 1) && sim_irq_vectors[s]) run |= 1u << s;
+  }
+  if(run) sim_irq_run(run);
+}
+
+// One slot's interrupt to the CPU: IELSR_IR, then the handler when the slot is enabled - "now",
+// between two host statements, or when irq_save() / irq_ceiling() stop masking it
+inline void sim_irq_slot(unsigned int slot) {
+  unsigned int addr = ICUBASE + IELSR + slot * 4;
+  sim_poke<unsigned int>(addr, sim_peek<unsigned int>(addr) | (1u << IELSR_IR));
+  if(!((sim_peek<unsigned int>(NVICBASE + NVICISER) >> slot) & 1) || !sim_irq_vectors[slot]) return;
+  if(sim_irq_masked(slot)) sim_irq_held |= 1u << slot;
+  else sim_irq_run(1u << slot);
+}
+
+// A simulated peripheral raising an event: the sim_on_event() models see it first, then each
+// slot linked to it gets the interrupt.
+// Slots with IELSR_DTCE set are left to the DTC model, which calls sim_irq_slot() when it is done
+inline void sim_irq_raise(unsigned int event) {
+  unsigned int cpu = 0;  // Taken before the models run - the DTC can clear DTCE on the way
+  for(unsigned int slot = 0; slot < IRQ_SLOTS; slot++) {
+    unsigned int v = sim_peek<unsigned int>(ICUBASE + IELSR + slot * 4);
+    if(((v >> IELSR_IELS_7_0) & 0xFF) == event && !(v & (1u << IELSR_DTCE))) cpu |= 1u << slot;
+  }
+  for(unsigned int i = 0; i < sim_event_hooks.size(); i++) sim_event_hooks[i](event);
+  for(unsigned int slot = 0; slot < IRQ_SLOTS; slot++)
+    if((cpu >> slot) & 1) sim_irq_slot(slot);
+}
+#endif
+
+}  // namespace ra4m1
+
+#endif  // SUSAN_RA4M1_MINIMA_IRQ_H
@@ -0,0 +1,264 @@
+/*  Arduino UNO R4 Minima - interrupt latency bench for the RA4M1 register defines:
+ *
+ *  An ELC software event (ELC_ELSEGR0) goes two ways at once: through ELC_ELSR00 to GPT320, which
+ *  captures its free running GTCNT into GTCCRA, and through an IELSR slot to the NVIC. The handler
+ *  reads GTCNT first thing, so entry latency is that minus the capture - in ICLK cycles, with
+ *  GPT320 on PCLKD / 1 and PCLKD = ICLK, as the Arduino core sets them:
+ *
+ *    ra4m1::LatencyResult r;
+ *    ra4m1::lat_begin();                           // GPT320, ELC, two slots from irq_alloc()
+ *    for(unsigned int prio = 0; prio < 16; prio++) {
+ *      ra4m1::lat_run(prio, 1000, r);              // 1000 shots at NVIC priority 'prio'
+ *      Serial.print(prio);
+ *      Serial.print(" entry ");  Serial.print(r.entry.min);  Serial.print(" / ");
+ *      Serial.print(r.entry.p50());  Serial.print(" / ");  Serial.print(r.entry.p99());
+ *      Serial.print(" / ");  Serial.println(r.entry.max);
+ *    }
+ *    ra4m1::lat_end();
+ *
+ *  Each shot measures:
+ *    entry  capture -> first GTCNT read in the handler: ELC, ICU, NVIC, stacking, handler prologue
+ *    exit   last GTCNT read in the handler -> next read in thread code: epilogue, unstacking
+ *    chain  both software events pending with PRIMASK set, then released - the first handler's
+ *           last read -> the second's first read, tail chained without unstacking
+ *  Exit and chain have the cost of one GTCNT read (measured in lat_begin()) taken off.
+ *
+ *  Load: lat_run(prio, shots, r, load) calls load() straight after the ELSEGR write, so the
+ *  interrupt comes in during it - a divide loop, a memcpy from flash, or a DMA block transfer
+ *  busy on the bus all show up in the tail of the histogram.
+ *
+ *  The histograms are 1 cycle bins up to LAT_BINS - 1, with min / max exact beyond that.
+ *
+ *  Note: GPT320 and ELC_ELSR00 are taken over until lat_end(); the Arduino core uses GPT32 0 for
+ *        analogWrite() on some pins. Other interrupts at a higher priority land in the figures too
+ *        - USB and the millis() timer, unless the sketch stops them.
+ *
+ *  With RA4M1_HOST_SIM, ra4m1::SimLatency models the ELC, the GPT capture and the exception
+ *  timing, so the bench, the histograms and the percentiles can be checked on Linux.
+ *
+ * This code is "AS IS" without warranty or liability.
+ * GPL v3 or later - see susan_ra4m1_minima_register_defines.h
+*/
+
+#ifndef SUSAN_RA4M1_MINIMA_IRQ_LATENCY_H
+#define SUSAN_RA4M1_MINIMA_IRQ_LATENCY_H
+
+#include "susan_ra4m1_minima_irq.h"
+
+namespace ra4m1 {
+
+constexpr unsigned int LAT_BINS = 128;
+
+// ==== Histogram ====
+
+struct LatencyHist {
+  unsigned short bin[LAT_BINS];  // Count per cycle value, the last bin for LAT_BINS - 1 and up
+  unsigned int count;
+  unsigned int min;
+  unsigned int max;
+
+  void clear() {
+    for(unsigned int i = 0; i < LAT_BINS; i++) bin[i] = 0;
+    count = 0;
+    min = ~0u;
+    max = 0;
+  }
+
+  void add(unsigned int cycles) {
+    unsigned int b = cycles < LAT_BINS ? cycles : LAT_BINS - 1;
+    if(bin[b] != 0xFFFF) bin[b]++;
+    count++;
+    if(cycles < min) min = cycles;
+    if(cycles > max) max = cycles;
+  }
+
+  // Smallest value with at least pct % of the samples at or below it
+  unsigned int percentile(unsigned int pct) const {
+    if(!count) return 0;
+    unsigned int want = (count * pct + 99) / 100, seen = 0;
+    if(!want) want = 1;
+    for(unsigned int i = 0; i < LAT_BINS - 1; i++) {
+      seen += bin[i];
+      if(seen >= want) return i;
+    }
+    return max;
+  }
+
+  unsigned int p50() const { return percentile(50); }
+  unsigned int p99() const { return percentile(99); }
+};
+
+struct LatencyResult {
+  unsigned int priority;
+  LatencyHist entry;
+  LatencyHist exit;
+  LatencyHist chain;
+};
+
+
+// ==== Handlers ====
+// GTCNT on the way in and on the way out, per software event
+
+struct LatencyState {
+  int slot[2];
+  volatile unsigned int in[2];
+  volatile unsigned int out[2];
+  volatile unsigned int done;
+  unsigned int read_cost;
+};
+
+inline LatencyState lat_state = {{-1, -1}, {0, 0}, {0, 0}, 0, 0};
+
+inline unsigned int lat_now() { return mmio_read(GPT320_GTCNT); }
+
+inline void lat_isr0() {
+  lat_state.in[0] = lat_now();
+  irq_ack(lat_state.slot[0]);
+  lat_state.done |= 1;
+  lat_state.out[0] = lat_now();
+}
+
+inline void lat_isr1() {
+  lat_state.in[1] = lat_now();
+  irq_ack(lat_state.slot[1]);
+  lat_state.done |= 2;
+  lat_state.out[1] = lat_now();
+}
+
+// Software event 0 or 1 - ELSEGR wants WE set first, then SEG, with WI at 0 both times
+inline void lat_trigger(unsigned int n) {
+  volatile unsigned char *elsegr = n ? ELC_ELSEGR1 : ELC_ELSEGR0;
+  mmio_write(elsegr, (unsigned char)0);
+  mmio_write(elsegr, (unsigned char)(1 << ELSEGR_WE));
+  mmio_write(elsegr, (unsigned char)((1 << ELSEGR_WE) | (1 << ELSEGR_SEG)));
+}
+
+
+// ==== Bench ====
+
+inline void lat_end() {
+  for(unsigned int i = 0; i < 2; i++) {
+    if(lat_state.slot[i] >= 0) irq_free(lat_state.slot[i]);
+    lat_state.slot[i] = -1;
+  }
+  mmio_write(ELC_ELSR00, (unsigned short)0);
+  mmio_write(GPT320_GTICASR, 0u);
+  mmio_write(GPT320_GTCR, 0u);
+}
+
+// Returns false when there are no two free IELSR slots
+inline bool lat_begin() {
+  mmio_write(MSTP_MSTPCRC, mmio_read(MSTP_MSTPCRC) & ~(1u << MSTPC14));  // ELC
+  mmio_write(MSTP_MSTPCRD, mmio_read(MSTP_MSTPCRD) & ~(1u << MSTPD5));   // GPT32
+  mmio_write(GPT320_GTCR, 0u);
+  mmio_write(GPT320_GTPR, 0xFFFFFFFFu);
+  mmio_write(GPT320_GTCNT, 0u);
+  mmio_write(GPT320_GTICASR, 1u << GTICASR_ASELCA);
+  mmio_write(GPT320_GTCR, 1u << GTCR_CST);   // Saw wave, PCLKD / 1
+  mmio_write(ELC_ELSR00, (unsigned short)IRQ_ELC_SWEVT0);
+  mmio_write(ELC_ELCR, (unsigned char)(1 << ELCR_ELCON));
+
+  lat_state.slot[0] = irq_alloc(IRQ_ELC_SWEVT0, 15, lat_isr0);
+  lat_state.slot[1] = irq_alloc(IRQ_ELC_SWEVT1, 15, lat_isr1);
+  if(lat_state.slot[0] < 0 || lat_state.slot[1] < 0) {
+    lat_end();
+    return false;
+  }
+
+  unsigned int cost = ~0u;
+  for(unsigned int i = 0; i < 8; i++) {
+    unsigned int a = lat_now();
+    unsigned int b = lat_now();
+    if(b - a < cost) cost = b - a;
+  }
+  lat_state.read_cost = cost;
+  return true;
+}
+
+// 'shots' rounds of entry / exit, then chain, with both slots at NVIC priority 0 - 15
+inline void lat_run(unsigned int priority, unsigned int shots, LatencyResult &r, void (*load)() = nullptr) {
+  LatencyState &s = lat_state;
+  r.priority = priority;
+  r.entry.clear();
+  r.exit.clear();
+  r.chain.clear();
+  irq_priority(s.slot[0], priority);
+  irq_priority(s.slot[1], priority);
+  dsb();
+
+  while(shots--) {
+    s.done = 0;
+    lat_trigger(0);
+    if(load) load();
+    while(!(s.done & 1)) {}
+    unsigned int back = lat_now();
+    r.entry.add(s.in[0] - mmio_read(GPT320_GTCCRA));
+    r.exit.add(back - s.out[0] - s.read_cost);
+
+    s.done = 0;
+    unsigned int primask = irq_save();
+    lat_trigger(0);
+    lat_trigger(1);
+    irq_restore(primask);
+    while(s.done != 3) {}
+    // Same priority - the lower slot number goes first, and irq_alloc() hands out from the top
+    bool first0 = (int)(s.in[1] - s.in[0]) > 0;
+    r.chain.add(first0 ? s.in[1] - s.out[0] - s.read_cost : s.in[0] - s.out[1] - s.read_cost);
+  }
+}
+
+
+#ifdef RA4M1_HOST_SIM
+// ==== Simulated ELC, GPT capture and exception timing ====
+// GTCNT moves on one count per read and by the modelled cycles at each exception phase. Entry is
+// 'entry' plus 0 .. jitter - 1, stepping by one per exception entry, so the histogram has a known
+// shape. A shot takes two entries, the measured one and the first of the chained pair, so
+// r.entry sees every other step - all of them for an odd jitter, half of them for an even one.
+//
+//   ra4m1::sim_reset();
+//   ra4m1::SimLatency sim;  sim.entry = 12;  sim.jitter = 4;  sim.attach();
+//   ra4m1::lat_begin();
+//   ra4m1::lat_run(6, 100, r);     // r.entry 50 each of 12 and 14, r.exit 'exit', r.chain 'chain'
+
+struct SimLatency {
+  unsigned int entry = 12;  // Cortex-M4, zero wait state RAM - the ELC / ICU add a few on the chip
+  unsigned int chain = 6;
+  unsigned int exit = 10;
+  unsigned int jitter = 0;
+  unsigned int now = 0;
+  unsigned int interrupts = 0;
+  bool we[2] = {false, false};
+
+  void attach() {
+    sim_on_read(GPTBASE + GTCNT, [this](unsigned int, unsigned int) { return now++; });
+    sim_on_write(ELCBASE + 0x1002, [this](unsigned int, unsigned int v) { elsegr(0, v); return v; });
+    sim_on_write(ELCBASE + 0x1004, [this](unsigned int, unsigned int v) { elsegr(1, v); return v; });
+    sim_irq_timing = [this](unsigned int, SimIrqPhase phase) {
+      if(phase == SIM_IRQ_ENTRY) now += entry + (jitter ? interrupts++ % jitter : 0);
+      else if(phase == SIM_IRQ_CHAIN) now += chain;
+      else now += exit;
+    };
+  }
+
+  ~SimLatency() { sim_irq_timing = nullptr; }
+
+  void elsegr(unsigned int n, unsigned int v) {
+    if(v & (1 << ELSEGR_WI)) return;
+    bool seg = (v >> ELSEGR_SEG) & 1;
+    if(seg && we[n]) fire(IRQ_ELC_SWEVT0 + n);
+    we[n] = !seg && ((v >> ELSEGR_WE) & 1);
+  }
+
+  void fire(unsigned int event) {
+    bool elc = (sim_peek<unsigned char>(ELCBASE + 0x1000) >> ELCR_ELCON) & 1;
+    bool capture = (sim_peek<unsigned int>(GPTBASE + GTICASR) >> GTICASR_ASELCA) & 1;
+    if(elc && capture && sim_peek<unsigned short>(ELCBASE + ELSR) == event && (sim_peek<unsigned int>(GPTBASE + GTCR) & (1u << GTCR_CST)))
+      sim_poke<unsigned int>(GPTBASE + GTCCRA, now);
+    sim_irq_raise(event);
+  }
+};
+#endif
+
+}  // namespace ra4m1
+
+#endif  // SUSAN_RA4M1_MINIMA_IRQ_LATENCY_H
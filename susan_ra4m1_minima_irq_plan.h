@@ -0,0 +1,159 @@
+/*  Arduino UNO R4 Minima - compile time interrupt priority plan for the RA4M1 register defines:
+ *
+ *  The RA4M1 has 4 priority bits, 16 levels - the Arduino core puts USB at 12 (0xC0) and the AGT0
+ *  millis() tick at 14 (0xE0). List the sketch's interrupts with how often each has to be served
+ *  and the shared data each touches; the plan gives each a level at compile time, shortest period
+ *  most urgent, and the ceiling for each shared resource:
+ *
+ *    enum { RES_RING = 1 << 0, RES_UART = 1 << 1 };
+ *    constexpr ra4m1::IrqPlanEntry plan[] = {
+ *      ra4m1::irq_plan(IRQ_GPT0_OVF,     50, RES_RING),   // 20 kHz control loop - level 1
+ *      ra4m1::irq_plan(IRQ_ADC140_ADI,  100, RES_RING),   // Level 2
+ *      ra4m1::irq_plan(IRQ_SCI2_RXI,   1000, RES_UART),   // Level 3
+ *      ra4m1::irq_plan(IRQ_SCI2_TXI,   1000, RES_UART),   // Level 3
+ *      ra4m1::irq_plan(IRQ_PORT_IRQ0).level(0),           // Fixed - never held off by a ceiling
+ *    };
+ *    typedef ra4m1::IrqPlan<plan> Plan;
+ *
+ *    int slot = Plan::link<IRQ_GPT0_OVF>(gpt_ovf_isr);     // irq_alloc() at the planned level
+ *    Plan::apply();                                      // Re-level slots linked elsewhere
+ *
+ *  A critical section then only masks the handlers sharing the data - BASEPRI, not PRIMASK:
+ *
+ *    unsigned int basepri = ra4m1::irq_ceiling(Plan::ceiling(RES_UART));  // SCI2 held off, level 3
+ *    uart_head = next;                                                       // GPT / ADC still run
+ *    ra4m1::irq_ceiling_restore(basepri);
+ *
+ *  The same call in a handler is fine - a nested ceiling never lowers the mask.
+ *
+ *  Checked at compile time, a static_assert for each: no event twice; fixed levels 0 - 15; the
+ *  planned levels fit IRQ_PLAN_FIRST - IRQ_PLAN_LAST (1 - 11, above USB); no resource used at
+ *  level 0, which BASEPRI can't mask; link<>() only for an event in the plan.
+ *
+ *  Note: Equal periods share a level and don't preempt each other. Periods are only an ordering,
+ *        nothing checks the handlers fit in them - see susan_ra4m1_minima_irq_latency.h.
+ *
+ * This code is "AS IS" without warranty or liability.
+ * GPL v3 or later - see susan_ra4m1_minima_register_defines.h
+*/
+
+#ifndef SUSAN_RA4M1_MINIMA_IRQ_PLAN_H
+#define SUSAN_RA4M1_MINIMA_IRQ_PLAN_H
+
+#include "susan_ra4m1_minima_irq.h"
+
+namespace ra4m1 {
+
+constexpr unsigned int IRQ_PLAN_FIRST = 1;   // 0 is left for fixed, never masked handlers
+constexpr unsigned int IRQ_PLAN_LAST = 11;   // Above the Arduino core's USB at 12
+constexpr unsigned int IRQ_PLAN_AUTO = 0xFF;
+constexpr unsigned int IRQ_PLAN_NONE = 0xFF; // level_of() an event not in the plan
+
+// ==== One interrupt ====
+
+struct IrqPlanEntry {
+  unsigned char event;    // IRQ_xxx
+  unsigned char fixed;    // IRQ_PLAN_AUTO, or the level asked for
+  unsigned int period_us; // Shorter is more urgent
+  unsigned int resources; // One bit per piece of shared data
+
+  constexpr IrqPlanEntry level(unsigned int l) const { return IrqPlanEntry{event, (unsigned char)l, period_us, resources}; }
+};
+
+constexpr IrqPlanEntry irq_plan(unsigned int event, unsigned int period_us = 0, unsigned int resources = 0) {
+  return IrqPlanEntry{(unsigned char)event, (unsigned char)IRQ_PLAN_AUTO, period_us, resources};
+}
+
+
+// ==== Levels and ceilings ====
+
+template <unsigned int N>
+constexpr unsigned int irq_plan_level(const IrqPlanEntry (&table)[N], unsigned int i) {
+  if(table[i].fixed != IRQ_PLAN_AUTO) return table[i].fixed;
+  unsigned int rank = 0;  // Distinct shorter periods among the planned entries
+  for(unsigned int j = 0; j < N; j++) {
+    if(table[j].fixed != IRQ_PLAN_AUTO || table[j].period_us >= table[i].period_us) continue;
+    bool seen = false;
+    for(unsigned int k = 0; k < j; k++)
+      if(table[k].fixed == IRQ_PLAN_AUTO && table[k].period_us == table[j].period_us) seen = true;
+    if(!seen) rank++;
+  }
+  return IRQ_PLAN_FIRST + rank;
+}
+
+// Most urgent level among the users of any of the resources, or 0 when nothing uses them
+template <unsigned int N>
+constexpr unsigned int irq_plan_ceiling(const IrqPlanEntry (&table)[N], unsigned int resources) {
+  unsigned int c = 16;
+  for(unsigned int i = 0; i < N; i++)
+    if((table[i].resources & resources) && irq_plan_level(table, i) < c) c = irq_plan_level(table, i);
+  return c == 16 ? 0 : c;
+}
+
+enum IrqPlanRule : unsigned char { IRQ_PLAN_UNIQUE, IRQ_PLAN_LEVEL_OK, IRQ_PLAN_FITS, IRQ_PLAN_MASKABLE };
+
+// Index of the first entry breaking the rule, or -1
+template <unsigned int N>
+constexpr int irq_plan_check(const IrqPlanEntry (&table)[N], IrqPlanRule rule) {
+  for(unsigned int i = 0; i < N; i++) {
+    unsigned int level = irq_plan_level(table, i);
+    switch(rule) {
+      case IRQ_PLAN_UNIQUE:
+        for(unsigned int j = i + 1; j < N; j++)
+          if(table[i].event == table[j].event) return (int)j;
+        break;
+      case IRQ_PLAN_LEVEL_OK:
+        if(table[i].fixed != IRQ_PLAN_AUTO && table[i].fixed > 15) return (int)i;
+        break;
+      case IRQ_PLAN_FITS:
+        if(table[i].fixed == IRQ_PLAN_AUTO && level > IRQ_PLAN_LAST) return (int)i;
+        break;
+      case IRQ_PLAN_MASKABLE:
+        if(table[i].resources && level == 0) return (int)i;
+        break;
+    }
+  }
+  return -1;
+}
+
+template <const auto &Table>
+struct IrqPlan {
+  static constexpr unsigned int count = sizeof(Table) / sizeof(Table[0]);
+  static_assert(irq_plan_check(Table, IRQ_PLAN_UNIQUE) < 0, "IrqPlan: event listed twice");
+  static_assert(irq_plan_check(Table, IRQ_PLAN_LEVEL_OK) < 0, "IrqPlan: fixed level is not 0 - 15");
+  static_assert(irq_plan_check(Table, IRQ_PLAN_FITS) < 0, "IrqPlan: more distinct periods than levels IRQ_PLAN_FIRST - IRQ_PLAN_LAST");
+  static_assert(irq_plan_check(Table, IRQ_PLAN_MASKABLE) < 0, "IrqPlan: shared data used at level 0 - BASEPRI can't mask that, use irq_save()");
+
+  static constexpr int index_of(unsigned int event) {
+    for(unsigned int i = 0; i < count; i++)
+      if(Table[i].event == event) return (int)i;
+    return -1;
+  }
+
+  static constexpr unsigned int level_of(unsigned int event) {
+    return index_of(event) < 0 ? IRQ_PLAN_NONE : irq_plan_level(Table, index_of(event));
+  }
+
+  static constexpr unsigned int ceiling(unsigned int resources) { return irq_plan_ceiling(Table, resources); }
+
+  // A free slot at the planned level - returns the slot, or -1
+  template <unsigned int Event>
+  static int link(IrqHandler handler) {
+    static_assert(index_of(Event) >= 0, "IrqPlan: event is not in the plan");
+    return irq_alloc(Event, level_of(Event), handler);
+  }
+
+  // Planned levels onto every slot already linked to an event in the plan
+  static void apply() {
+    for(unsigned int slot = 0; slot < IRQ_SLOTS; slot++) {
+      if(!mmio_read(ICU_IELSR00 + slot)) continue;
+      unsigned int level = level_of(irq_event(slot));
+      if(level != IRQ_PLAN_NONE) irq_priority(slot, level);
+    }
+    dsb();
+  }
+};
+
+}  // namespace ra4m1
+
+#endif  // SUSAN_RA4M1_MINIMA_IRQ_PLAN_H
@@ -0,0 +1,190 @@
+/*  Arduino UNO R4 Minima - MMIO access tracing and counting for the RA4M1 register layer:
+ *
+ *  Build with -DRA4M1_MMIO_TRACE and every access made through ra4m1::mmio_read() / mmio_write() -
+ *  the typed layer (susan_ra4m1_minima_register_types.h), the companion headers, and your own
+ *  ra4m1::mmio_read(REG) / mmio_write(REG, v) on any register define - is recorded as address,
+ *  width, R/W, and value, with a timestamp, into a lock-free ring buffer, and counted per register.
+ *  Use it to find wasted bus cycles, e.g. a PORTx_PIDR polled twice per bit, or two ADC140_ADCSR
+ *  read-modify-writes that could be one.
+ *
+ *    ra4m1::trace_clear();
+ *    do_the_thing();
+ *    ra4m1::trace_summary(Serial);                 // Arduino: hot registers, sorted by count
+ *    ra4m1::trace_write_file("trace.csv");         // Host: every access, oldest first
+ *
+ *  Timestamps are DWT_CYCCNT ICLK cycles on the Arduino - trace_clear() starts the counter, so
+ *  call it before the first access you want timed - or the simulator cycle count on the host.
+ *  Safe to record from ISRs - each access claims its slot with one atomic increment - but stop
+ *  the traffic before dumping. When the ring fills, the oldest entries are overwritten.
+ *
+ *  Note: A raw *REG or *REG = x on a define is not traced. The defines are casts to volatile
+ *        pointers, so the access is a plain load or store with nothing in between to record it -
+ *        route the code under study through ra4m1::mmio_read() / mmio_write() to see it here.
+ *
+ *  RA4M1_TRACE_DEPTH - ring entries (16 bytes each), default 256 on the Arduino, 65536 on the host
+ *  RA4M1_TRACE_REGS  - distinct registers counted, default 64
+ *
+ * This code is "AS IS" without warranty or liability.
+ * GPL v3 or later - see susan_ra4m1_minima_register_defines.h
+*/
+
+#ifndef SUSAN_RA4M1_MINIMA_MMIO_TRACE_H
+#define SUSAN_RA4M1_MINIMA_MMIO_TRACE_H
+
+#include <atomic>
+#include <stdio.h>
+#include "susan_ra4m1_minima_register_defines.h"
+
+#ifndef RA4M1_TRACE_DEPTH
+#ifdef RA4M1_HOST_SIM
+#define RA4M1_TRACE_DEPTH 65536
+#else
+#define RA4M1_TRACE_DEPTH 256
+#endif
+#endif
+
+#ifndef RA4M1_TRACE_REGS
+#define RA4M1_TRACE_REGS 64
+#endif
+
+namespace ra4m1 {
+
+struct TraceEntry {
+  unsigned int  time;   // DWT_CYCCNT, or simulator cycles
+  unsigned int  addr;   // Chip address of the register
+  unsigned int  value;  // Value read or written
+  unsigned char width;  // 8, 16, or 32
+  unsigned char write;  // 0: Read, 1: Write
+};
+
+struct TraceCount {
+  std::atomic<unsigned int> addr;
+  std::atomic<unsigned int> reads;
+  std::atomic<unsigned int> writes;
+};
+
+inline TraceEntry trace_ring[RA4M1_TRACE_DEPTH];
+inline std::atomic<unsigned int> trace_head{0};      // Total accesses recorded
+inline TraceCount trace_counts[RA4M1_TRACE_REGS];
+inline std::atomic<unsigned int> trace_lost{0};      // Accesses not counted - count table full
+inline volatile bool trace_enabled = true;
+
+inline void cycles_enable();  // susan_ra4m1_minima_register_types.h, included below
+
+inline unsigned int trace_time() {
+#ifdef RA4M1_HOST_SIM
+  return (unsigned int)sim_cycle_count;
+#else
+  return *DWT_CYCCNT;
+#endif
+}
+
+// Open addressing on the register address - the first access to a register claims its entry
+inline TraceCount *trace_count_slot(unsigned int addr) {
+  unsigned int i = (addr >> 1) % RA4M1_TRACE_REGS;
+  for(unsigned int n = 0; n < RA4M1_TRACE_REGS; n++, i = (i + 1) % RA4M1_TRACE_REGS) {
+    unsigned int a = trace_counts[i].addr.load(std::memory_order_relaxed);
+    if(a == addr) return &trace_counts[i];
+    if(a == 0) {
+      unsigned int expected = 0;
+      if(trace_counts[i].addr.compare_exchange_strong(expected, addr, std::memory_order_relaxed) || expected == addr)
+        return &trace_counts[i];
+    }
+  }
+  return nullptr;
+}
+
+inline void trace_record(unsigned int addr, unsigned int width, bool write, unsigned int value) {
+  if(!trace_enabled) return;
+  unsigned int n = trace_head.fetch_add(1, std::memory_order_relaxed);
+  TraceEntry &e = trace_ring[n % RA4M1_TRACE_DEPTH];
+  e.time  = trace_time();
+  e.addr  = addr;
+  e.value = value;
+  e.width = (unsigned char)width;
+  e.write = write;
+  if(TraceCount *c = trace_count_slot(addr))
+    (write ? c->writes : c->reads).fetch_add(1, std::memory_order_relaxed);
+  else
+    trace_lost.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline void trace_clear() {
+#ifndef RA4M1_HOST_SIM
+  cycles_enable();  // DEMCR_TRCENA and DWT_CTRL_CYCCNTENA - DWT_CYCCNT stands still until then
+#endif
+  trace_head = 0;
+  trace_lost = 0;
+  for(TraceCount &c : trace_counts) { c.addr = 0; c.reads = 0; c.writes = 0; }
+}
+
+inline unsigned int trace_total() { return trace_head.load(); }
+
+// Oldest first, only what is still in the ring
+template <typename Fn>
+inline void trace_for_each(Fn fn) {
+  unsigned int head  = trace_head.load();
+  unsigned int first = head > RA4M1_TRACE_DEPTH ? head - RA4M1_TRACE_DEPTH : 0;
+  for(unsigned int n = first; n < head; n++) fn(trace_ring[n % RA4M1_TRACE_DEPTH]);
+}
+
+// Register totals, busiest first - fills up to max entries, returns how many
+struct TraceHot { unsigned int addr, reads, writes; };
+
+inline unsigned int trace_hot(TraceHot *out, unsigned int max) {
+  unsigned int n = 0;
+  for(TraceCount &c : trace_counts) {
+    unsigned int a = c.addr.load();
+    if(a == 0) continue;
+    TraceHot h = { a, c.reads.load(), c.writes.load() };
+    unsigned int i = n < max ? n++ : max;  // Insertion sort - the table is small
+    while(i > 0 && out[i - 1].reads + out[i - 1].writes < h.reads + h.writes) {
+      if(i < max) out[i] = out[i - 1];
+      i--;
+    }
+    if(i < max) out[i] = h;
+  }
+  return n;
+}
+
+// Anything with print(const char *) - Arduino Serial, or a host wrapper
+template <typename Out>
+inline void trace_summary(Out &out, unsigned int max = 16) {
+  TraceHot hot[RA4M1_TRACE_REGS];
+  unsigned int n = trace_hot(hot, max < RA4M1_TRACE_REGS ? max : RA4M1_TRACE_REGS);
+  char line[64];
+  snprintf(line, sizeof(line), "MMIO accesses: %u, not counted: %u\r\n", trace_head.load(), trace_lost.load());
+  out.print(line);
+  for(unsigned int i = 0; i < n; i++) {
+    snprintf(line, sizeof(line), "0x%08X  R %6u  W %6u\r\n", hot[i].addr, hot[i].reads, hot[i].writes);
+    out.print(line);
+  }
+}
+
+#ifdef RA4M1_HOST_SIM
+struct TraceFileOut {
+  FILE *f;
+  void print(const char *s) { fputs(s, f); }
+};
+
+inline void trace_summary(FILE *f, unsigned int max = 16) { TraceFileOut out{f}; trace_summary(out, max); }
+
+// CSV: time,addr,width,rw,value
+inline bool trace_write_file(const char *path) {
+  FILE *f = fopen(path, "w");
+  if(!f) return false;
+  fprintf(f, "time,addr,width,rw,value\n");
+  trace_for_each([f](const TraceEntry &e) {
+    fprintf(f, "%u,0x%08X,%u,%c,0x%X\n", e.time, e.addr, e.width, e.write ? 'W' : 'R', e.value);
+  });
+  fclose(f);
+  return true;
+}
+#endif
+
+}  // namespace ra4m1
+
+// For cycles_enable() and mmio_read() / mmio_write() - when it included this file, already done
+#include "susan_ra4m1_minima_register_types.h"
+
+#endif  // SUSAN_RA4M1_MINIMA_MMIO_TRACE_H
@@ -0,0 +1,189 @@
+/*  Arduino UNO R4 Minima - table driven parallel bus output for the RA4M1 register defines:
+ *
+ *  An 8 bit LCD / FPGA bus on the header pins lands on two ports - D2 - D7 and D10 - D13 are on
+ *  port 1, D0 / D1 / D8 / D9 on port 3 - in no useful order. ParallelBus works out, at compile
+ *  time, a 256 entry table per port of PCNTR3 words (POSR bits to set in b15-0, PORR bits to clear
+ *  in b31-16). A byte is then one table load and one store per port, plus the strobe:
+ *
+ *    //                          Strobe  Active low  Data bit 0 ... bit 7
+ *    typedef ra4m1::ParallelBus<D9,     true,       D8, D0, D1, D2, D3, D4, D5, D6> Lcd;
+ *    Lcd::begin();                          // Data and strobe pins to outputs, strobe inactive
+ *    Lcd::write(0x3A);                      // Port 1 store, port 3 store with the strobe, strobe release
+ *    Lcd::write(buffer, sizeof(buffer));
+ *
+ *  The strobe goes active in the same store as the last port's data and inactive in one more, so
+ *  the device should latch on the strobe's trailing edge - the 8080 WR rising edge, or the 6800 E
+ *  falling edge. The strobe's port is written last, so data on the other ports is already set up.
+ *
+ *  Timing - cycles counted with the DWT:
+ *    ParallelBusBench b = Lcd::bench(buffer, sizeof(buffer), 48000000);
+ *    Serial.println(b.mbytes_per_s());
+ *
+ *  With -DRA4M1_HOST_SIM, cycles() is the simulator's access count, so cycles_per_byte() is the
+ *  register accesses per byte and mbytes_per_s() says nothing about the board.
+ *
+ *  Lcd::verify() writes all 256 values and reads each back from PIDR, returning the first value
+ *  that did not come back, or -1. With the pins unconnected that checks the tables on the board,
+ *  and with -DRA4M1_HOST_SIM it runs against the simulated port registers.
+ *
+ *  Note: The tables take 1 KB of flash per port the bus uses. Each port store is 3 - 4 bus cycles on the
+ *        peripheral bus, so the bus rate is set by the port count, not by the bit spread.
+ *
+ * This code is "AS IS" without warranty or liability.
+ * GPL v3 or later - see susan_ra4m1_minima_register_defines.h
+*/
+
+#ifndef SUSAN_RA4M1_MINIMA_PARALLEL_BUS_H
+#define SUSAN_RA4M1_MINIMA_PARALLEL_BUS_H
+
+#include "susan_ra4m1_minima_gpio.h"
+
+namespace ra4m1 {
+
+constexpr unsigned int BUS_PORTS_MAX = 3;  // The header pins are on ports 0, 1 and 3
+
+struct ParallelBusBench {
+  unsigned int cycles;
+  unsigned int bytes;
+  unsigned long iclk;
+  // Bytes per microsecond is MB/s
+  float mbytes_per_s() const { return cycles ? (float)bytes * (float)iclk / ((float)cycles * 1000000.0f) : 0.0f; }
+  float cycles_per_byte() const { return bytes ? (float)cycles / (float)bytes : 0.0f; }
+};
+
+// The ports of a bus, strobe port last
+struct ParallelBusPorts {
+  unsigned int ports;
+  unsigned char port[BUS_PORTS_MAX];
+};
+
+// The same, with the PCNTR3 word for each port and each byte value - sized to the ports used
+template <unsigned int Ports>
+struct ParallelBusTables {
+  unsigned int ports;
+  unsigned char port[Ports];
+  unsigned int word[Ports][256];
+};
+
+template <unsigned int Strobe, bool ActiveLow, unsigned int... Bits>
+struct ParallelBus {
+  static constexpr unsigned int width = sizeof...(Bits);
+  static_assert(width >= 1 && width <= 8, "ParallelBus is 1 - 8 data pins");
+  static_assert(Strobe < GPIO_PINS && ((Bits < GPIO_PINS) && ...), "Arduino pins are D0 - D19");
+
+  static constexpr unsigned char pins[width] = {(unsigned char)Bits...};
+  static constexpr unsigned int strobe_port = gpio_port(Strobe);
+  static constexpr unsigned int strobe_bit = 1u << gpio_bit(Strobe);
+
+  static constexpr ParallelBusPorts make_ports() {
+    ParallelBusPorts t{};
+    for(unsigned int i = 0; i < width; i++) {  // Data ports in pin order, then the strobe port moved to the end
+      unsigned int p = gpio_port(pins[i]), j = 0;
+      while(j < t.ports && t.port[j] != p) j++;
+      if(j == t.ports) t.port[t.ports++] = (unsigned char)p;
+    }
+    unsigned int s = 0;
+    while(s < t.ports && t.port[s] != strobe_port) s++;
+    if(s == t.ports) t.port[t.ports++] = (unsigned char)strobe_port;
+    for(; s + 1 < t.ports; s++) {
+      unsigned char p = t.port[s];
+      t.port[s] = t.port[s + 1];
+      t.port[s + 1] = p;
+    }
+    return t;
+  }
+
+  static constexpr ParallelBusPorts bus_ports = make_ports();
+  static_assert(bus_ports.ports <= BUS_PORTS_MAX, "Too many ports");
+
+  static constexpr ParallelBusTables<bus_ports.ports> make_tables() {
+    ParallelBusTables<bus_ports.ports> t{};
+    t.ports = bus_ports.ports;
+    for(unsigned int j = 0; j < t.ports; j++) t.port[j] = bus_ports.port[j];
+    for(unsigned int v = 0; v < 256; v++) {
+      for(unsigned int i = 0; i < width; i++) {
+        unsigned int j = 0;
+        while(t.port[j] != gpio_port(pins[i])) j++;
+        unsigned int bit = 1u << gpio_bit(pins[i]);
+        t.word[j][v] |= ((v >> i) & 1) ? bit : bit << 16;
+      }
+      t.word[t.ports - 1][v] |= ActiveLow ? strobe_bit << 16 : strobe_bit;  // Strobe active with the last store
+    }
+    return t;
+  }
+
+  static constexpr ParallelBusTables<bus_ports.ports> tables = make_tables();
+
+  static constexpr bool pins_distinct() {
+    for(unsigned int i = 0; i < width; i++) {
+      if(pins[i] == Strobe) return false;
+      for(unsigned int j = i + 1; j < width; j++)
+        if(pins[i] == pins[j]) return false;
+    }
+    return true;
+  }
+  static_assert(pins_distinct(), "A pin is used twice");
+
+  static constexpr unsigned int port_mask(unsigned int port) {
+    unsigned int m = 0;
+    for(unsigned int i = 0; i < width; i++)
+      if(gpio_port(pins[i]) == port) m |= 1u << gpio_bit(pins[i]);
+    return m;
+  }
+
+  static constexpr unsigned int strobe_idle = ActiveLow ? strobe_bit : strobe_bit << 16;
+
+  static void strobe_release() { mmio_write<unsigned int>(gpio_port_addr(strobe_port, PCNTR3), strobe_idle); }
+
+  static void begin() {
+    strobe_release();
+    unsigned int primask = irq_save();
+    for(unsigned int j = 0; j < tables.ports; j++) {
+      unsigned int pcntr1 = gpio_port_addr(tables.port[j], PCNTR1);
+      unsigned int dir = port_mask(tables.port[j]) | (tables.port[j] == strobe_port ? strobe_bit : 0);
+      mmio_write<unsigned int>(pcntr1, mmio_read<unsigned int>(pcntr1) | dir);
+    }
+    irq_restore(primask);
+  }
+
+  // One store per port, the strobe's port last - the loop unrolls, the port count is a constant
+  static inline void write(unsigned char v) {
+    for(unsigned int j = 0; j < tables.ports; j++)
+      mmio_write<unsigned int>(gpio_port_addr(tables.port[j], PCNTR3), tables.word[j][v]);
+    strobe_release();
+  }
+
+  static void write(const unsigned char *data, unsigned int n) {
+    while(n--) write(*data++);
+  }
+
+  // Data pins back from PIDR, as a byte
+  static unsigned char read_back() {
+    unsigned char v = 0;
+    for(unsigned int i = 0; i < width; i++)
+      if((mmio_read<unsigned int>(gpio_port_addr(gpio_port(pins[i]), PCNTR2)) >> gpio_bit(pins[i])) & 1) v |= (unsigned char)(1u << i);
+    return v;
+  }
+
+  static int verify() {
+    unsigned int values = 1u << width;
+    for(unsigned int v = 0; v < values; v++) {
+      write((unsigned char)v);
+      if(read_back() != v) return (int)v;
+    }
+    return -1;
+  }
+
+  static ParallelBusBench bench(const unsigned char *data, unsigned int n, unsigned long iclk) {
+    unsigned int primask = irq_save();
+    unsigned int c0 = cycles();
+    write(data, n);
+    unsigned int c1 = cycles();
+    irq_restore(primask);
+    return ParallelBusBench{c1 - c0, n, iclk};
+  }
+};
+
+}  // namespace ra4m1
+
+#endif  // SUSAN_RA4M1_MINIMA_PARALLEL_BUS_H
@@ -0,0 +1,171 @@
+/*  Arduino UNO R4 Minima - pin function tables for the RA4M1 register defines:
+ *
+ *  Setting up a peripheral's pins one at a time means a PMISC_PWPR unlock / lock round each
+ *  PFS_PmnPFS write. Here the pins go in a constexpr table, checked at compile time against the
+ *  Minima pin list, and apply() writes the lot with one unlock, one 32 bit store per pin:
+ *
+ *    constexpr ra4m1::PinMux spi_pins[] = {
+ *      ra4m1::pmux(D13).peripheral(PSEL_SPI).drive_mid(),   // RSPCKA
+ *      ra4m1::pmux(D11).peripheral(PSEL_SPI).drive_mid(),   // MOSIA
+ *      ra4m1::pmux(D12).peripheral(PSEL_SPI),               // MISOA
+ *      ra4m1::pmux(D10).output(true),                       // CS - port output, high from the first write
+ *      ra4m1::pmux(D2).input().pullup().irq(false, true),   // IRQ0 on the falling edge
+ *      ra4m1::pmux(A1).analog(),                            // AN000
+ *      ra4m1::pmux_port(0, 12).output(),                    // P012 TX LED, no Arduino number
+ *    };
+ *    ra4m1::PinMuxTable<spi_pins>::apply();
+ *
+ *  Checked at compile time, a static_assert for each: the pin is on the Minima's 64 pin package;
+ *  not a pin the board needs (SWD, crystal, NMI, MD) unless .force() is given; no pin twice; PSEL
+ *  only with PMR; ASEL only on an ANxxx pin and not with PMR or PDR; ISEL only on an IRQn pin, and
+ *  EOR / EOF only with ISEL.
+ *
+ *  Each pin's PODR, PDR, PCR, etc. land together in one store, so an output never goes the wrong
+ *  level between setting the direction and the value. When a pin already in peripheral mode gets
+ *  a different PSEL, PMR is cleared first, as the hardware manual asks.
+ *
+ *  Note: PWPR is left the way it was found - relocked only if PFSWE was 0 before. Interrupts are
+ *        off for the whole table, a few hundred cycles for twenty pins.
+ *
+ * This code is "AS IS" without warranty or liability.
+ * GPL v3 or later - see susan_ra4m1_minima_register_defines.h
+*/
+
+#ifndef SUSAN_RA4M1_MINIMA_PINMUX_H
+#define SUSAN_RA4M1_MINIMA_PINMUX_H
+
+#include "susan_ra4m1_minima_gpio.h"
+
+namespace ra4m1 {
+
+// ==== Minima pin list ====
+// Port pins on the 64 pin package, one bit per pin, ports 0 - 5 - the ones not marked N/A in the
+// PFS_PmnPFS list in the register defines
+
+constexpr unsigned short PMUX_ON_PACKAGE[6] = {
+  0xF81F,  // P000 - P004, P011 - P015
+  0x3FFF,  // P100 - P113
+  0xF073,  // P200, P201, P204 - P206, P212 - P215
+  0x00FF,  // P300 - P307
+  0x0F87,  // P400 - P402, P407 - P411
+  0x0007   // P500 - P502
+};
+
+// Needed by the board - SWDIO P108, SWCLK P300, NMI P200, MD P201, EXTAL / XTAL P212 / P213
+constexpr unsigned short PMUX_BOARD[6] = {0x0000, 0x0100, 0x3003, 0x0001, 0x0000, 0x0000};
+
+// ANxxx inputs - AN000 - AN004, AN005 - AN010 on P010 - P015, AN019 - AN022 on P103 - P100, AN016 - AN018 on P500 - P502
+constexpr unsigned short PMUX_ANALOG[6] = {0xFC1F, 0x000F, 0x0000, 0x0000, 0x0000, 0x0007};
+
+// IRQn inputs - see the IRQxx notes on the PFS_PmnPFS list
+constexpr unsigned short PMUX_IRQ[6] = {0x8817, 0x0C33, 0x0060, 0x0036, 0x0F07, 0x0006};
+
+constexpr bool pmux_in(const unsigned short (&set)[6], unsigned int pin) {
+  return (pin >> 4) < 6 && ((set[pin >> 4] >> (pin & 0xF)) & 1);
+}
+
+
+// ==== One table entry ====
+
+struct PinMux {
+  unsigned char pin;  // Port * 16 + bit
+  bool forced;
+  unsigned int pfs;
+
+  constexpr PinMux with(unsigned int set, unsigned int clear = 0) const { return PinMux{pin, forced, (pfs & ~clear) | set}; }
+
+  constexpr PinMux output(bool high = false) const { return with((1u << PFS_PDR) | (high ? 1u << PFS_PODR : 0), 1u << PFS_PODR); }
+  constexpr PinMux input() const { return with(0, 1u << PFS_PDR); }
+  constexpr PinMux pullup() const { return with(1u << PFS_PCR); }
+  constexpr PinMux open_drain() const { return with(1u << PFS_NCODR); }
+  constexpr PinMux drive_mid() const { return with(1u << PFS_DSCR); }
+  constexpr PinMux analog() const { return with(1u << PFS_ASEL); }
+  constexpr PinMux peripheral(unsigned int psel) const { return with((1u << PFS_PMR) | (psel << PFS_PSEL_4_0), 0x1Fu << PFS_PSEL_4_0); }
+  constexpr PinMux irq(bool rising = false, bool falling = false) const {
+    return with((1u << PFS_ISEL) | (rising ? 1u << PFS_EOR : 0) | (falling ? 1u << PFS_EOF : 0));
+  }
+  constexpr PinMux force() const { return PinMux{pin, true, pfs}; }
+};
+
+constexpr PinMux pmux_port(unsigned int port, unsigned int bit) { return PinMux{(unsigned char)(port * 16 + bit), false, 0}; }
+constexpr PinMux pmux(unsigned int arduino_pin) { return PinMux{arduino_pin < GPIO_PINS ? GPIO_PIN_MAP[arduino_pin] : (unsigned char)0xFF, false, 0}; }
+
+inline unsigned int pmux_pfs_addr(unsigned int pin) { return PORTBASE + P000PFS + (pin >> 4) * 0x40 + (pin & 0xF) * 4; }
+
+
+// ==== Compile time checks ====
+
+enum PinMuxRule : unsigned char {
+  PMUX_ON_CHIP, PMUX_NOT_BOARD, PMUX_UNIQUE, PMUX_PSEL_PMR, PMUX_ASEL_OK, PMUX_ISEL_OK, PMUX_EDGE_ISEL
+};
+
+constexpr bool pmux_rule(const PinMux &m, PinMuxRule rule) {
+  unsigned int pfs = m.pfs;
+  bool pmr = (pfs >> PFS_PMR) & 1, asel = (pfs >> PFS_ASEL) & 1, isel = (pfs >> PFS_ISEL) & 1;
+  switch(rule) {
+    case PMUX_ON_CHIP:   return pmux_in(PMUX_ON_PACKAGE, m.pin);
+    case PMUX_NOT_BOARD: return m.forced || !pmux_in(PMUX_BOARD, m.pin);
+    case PMUX_PSEL_PMR:  return pmr || ((pfs >> PFS_PSEL_4_0) & 0x1F) == 0;
+    case PMUX_ASEL_OK:   return !asel || (pmux_in(PMUX_ANALOG, m.pin) && !pmr && !((pfs >> PFS_PDR) & 1));
+    case PMUX_ISEL_OK:   return !isel || pmux_in(PMUX_IRQ, m.pin);
+    case PMUX_EDGE_ISEL: return isel || !(pfs & ((1u << PFS_EOR) | (1u << PFS_EOF)));
+    default:             return true;
+  }
+}
+
+// Index of the first entry breaking the rule, or -1
+template <unsigned int N>
+constexpr int pmux_check(const PinMux (&table)[N], PinMuxRule rule) {
+  for(unsigned int i = 0; i < N; i++) {
+    if(rule == PMUX_UNIQUE) {
+      for(unsigned int j = i + 1; j < N; j++)
+        if(table[i].pin == table[j].pin) return (int)j;
+    } else if(!pmux_rule(table[i], rule)) {
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+
+// ==== Writing a table ====
+
+inline void pmux_apply(const PinMux *table, unsigned int n) {
+  unsigned int primask = irq_save();
+  unsigned char pwpr = mmio_read(PMISC_PWPR);
+  mmio_write(PMISC_PWPR, (unsigned char)0);                   // B0WI = 0
+  mmio_write(PMISC_PWPR, (unsigned char)(1 << PWPR_PFSWE));   // Then PFSWE = 1
+  for(unsigned int i = 0; i < n; i++) {
+    unsigned int addr = pmux_pfs_addr(table[i].pin);
+    unsigned int want = table[i].pfs;
+    if(want & (1u << PFS_PMR)) {
+      unsigned int now = mmio_read<unsigned int>(addr);
+      if((now & (1u << PFS_PMR)) && ((now ^ want) & (0x1Fu << PFS_PSEL_4_0)))
+        mmio_write<unsigned int>(addr, now & ~(1u << PFS_PMR));  // Out of peripheral mode before PSEL changes
+    }
+    mmio_write<unsigned int>(addr, want);
+  }
+  if(!(pwpr & (1 << PWPR_PFSWE))) {
+    mmio_write(PMISC_PWPR, (unsigned char)0);
+    mmio_write(PMISC_PWPR, (unsigned char)(1 << PWPR_B0WI));
+  }
+  irq_restore(primask);
+}
+
+template <const auto &Table>
+struct PinMuxTable {
+  static constexpr unsigned int count = sizeof(Table) / sizeof(Table[0]);
+  static_assert(pmux_check(Table, PMUX_ON_CHIP) < 0, "PinMux: pin is not on the Minima's RA4M1 package");
+  static_assert(pmux_check(Table, PMUX_NOT_BOARD) < 0, "PinMux: SWD / crystal / NMI / MD pin - add .force() if that is meant");
+  static_assert(pmux_check(Table, PMUX_UNIQUE) < 0, "PinMux: pin listed twice");
+  static_assert(pmux_check(Table, PMUX_PSEL_PMR) < 0, "PinMux: PSEL set without PMR");
+  static_assert(pmux_check(Table, PMUX_ASEL_OK) < 0, "PinMux: ASEL on a pin without an ANxxx input, or with PMR / PDR");
+  static_assert(pmux_check(Table, PMUX_ISEL_OK) < 0, "PinMux: ISEL on a pin without an IRQn input");
+  static_assert(pmux_check(Table, PMUX_EDGE_ISEL) < 0, "PinMux: EOR / EOF without ISEL");
+
+  static void apply() { pmux_apply(Table, count); }
+};
+
+}  // namespace ra4m1
+
+#endif  // SUSAN_RA4M1_MINIMA_PINMUX_H
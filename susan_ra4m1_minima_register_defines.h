@@ -32,15 +32,26 @@
 // ARM-developer - Accessing memory-mapped peripherals
 // https://developer.arm.com/documentation/102618/0100
 
+// ==== Host Simulation ====
+// Build with -DRA4M1_HOST_SIM (Linux, C++17) and every base address below points into a memory
+// image instead of at the peripherals, so code using these defines runs in unit tests and
+// benchmarks - see susan_ra4m1_minima_host_sim.h. On the Arduino the bases are plain numbers.
+#ifdef RA4M1_HOST_SIM
+#include "susan_ra4m1_minima_host_sim.h"
+#define RA4M1_BASE(addr) (ra4m1::SimAddr(addr))
+#else
+#define RA4M1_BASE(addr) (addr)
+#endif
+
 // ==== Option-Setting Memory  - This is programed into FLASH so can't be changed ====
-#define OPTION 0x00000000 // Option Base - See 6.1 page 103
+#define OPTION RA4M1_BASE(0x00000000) // Option Base - See 6.1 page 103
 #define SYSTEM_OFS0  ((volatile unsigned int *)(OPTION + 0x0400))  // Option Function Select Register 0
 #define SYSTEM_OFS1  ((volatile unsigned int *)(OPTION + 0x0404))  // Option Function Select Register 1
 #define OFS1_HOCOFRQ1_2_0   14   // HOCO Frequency Setting 1; 000: 24 MHz, 010: 32 MHz, 100: 48 MHz, 101: 64 MHz
 
 
 // ==== System & Clock Generation ====
-#define SYSTEM 0x40010000 // ICU Base - See 13.2.6 page 233
+#define SYSTEM RA4M1_BASE(0x40010000) // ICU Base - See 13.2.6 page 233
 
 // Register Write Protection - See section 12
 // PRC0 Registers related to the clock generation circuit:
@@ -168,7 +179,8 @@
 
 
 // System Control Block - for Software initiated reset, e.g. needed to reinitialse USB with PC
-#define SCBBASE 0xE0000000
+#define SCBBASE RA4M1_BASE(0xE0000000)
+#define SCB_VTOR                   ((volatile unsigned int *)(SCBBASE + 0xED08))   // Vector Table Offset Register
 #define SCB_AIRCR                  ((volatile unsigned int *)(SCBBASE + 0xED0C))
 #define SCB_AIRCR_VECTKEY_Pos      16U                                   // SCB AIRCR: VECTKEY Position
 #define SCB_AIRCR_SYSRESETREQ_Pos  2U                                    // SCB AIRCR: SYSRESETREQ Position
@@ -178,9 +190,44 @@
 //
 // From: https://mcuoneclipse.com/2015/07/01/how-to-reset-an-arm-cortex-m-with-software/
 
+// Data Watchpoint and Trace - free running ICLK cycle counter, for timing code
+#define DWTBASE RA4M1_BASE(0xE0001000)
+#define DWT_CTRL     ((volatile unsigned int *)(DWTBASE + 0x0000))   // DWT Control Register
+#define DWT_CTRL_CYCCNTENA  0   // Cycle Counter Enable
+#define DWT_CYCCNT   ((volatile unsigned int *)(DWTBASE + 0x0004))   // Cycle Count Register
+#define SCB_DEMCR    ((volatile unsigned int *)(SCBBASE + 0xEDFC))   // Debug Exception and Monitor Control Register
+#define DEMCR_TRCENA       24   // Trace Enable - must be 1 for the DWT to run
+//
+// *SCB_DEMCR |= (1 << DEMCR_TRCENA); *DWT_CYCCNT = 0; *DWT_CTRL |= (1 << DWT_CTRL_CYCCNTENA);
+
 
+// ==== Cortex-M4 Bit-Band ====
+// Each bit of the peripheral region 0x40000000 to 0x400FFFFF has its own 32 bit word in the
+// alias region from 0x42000000; writing 1 or 0 to that word sets or clears just that one bit.
+// That is a single store, so no |= / &=~ read-modify-write, and no need to disable interrupts
+// around a bit also changed by an ISR. Reading the alias word returns the bit as 0 or 1.
+//
+// Alias address = ALIAS + (register address - BASE) * 32 + bit * 4, for 8, 16, or 32 bit registers
+//
+//   *BITBAND_PERI(AGT0_AGTCR, AGTCR_TSTART) = 1;              // Start AGT0
+//   *BITBAND_PERI(MSTP_MSTPCRD, MSTPD16) = 0;                 // ADC140 out of module-stop
+//   while(*BITBAND_PERI(ADC140_ADCSR, ADCSR_ADST) == 1) {};   // Wait for end of conversion
+//
+// Note: The bus still does a read-modify-write of the register internally, so don't use it on
+//       flags that are cleared by writing 0, or where writing back other bits has side effects.
+#define BITBAND_PERI_BASE   0x40000000  // Peripheral bit-band region
+#define BITBAND_PERI_ALIAS  0x42000000  // Peripheral bit-band alias
+#define BITBAND_SRAM_BASE   0x20000000  // SRAM bit-band region
+#define BITBAND_SRAM_ALIAS  0x22000000  // SRAM bit-band alias
+#ifndef RA4M1_HOST_SIM
+#define BITBAND_PERI(reg, bit) ((volatile unsigned int *)(BITBAND_PERI_ALIAS + ((((unsigned int)(reg)) - BITBAND_PERI_BASE) * 32) + ((bit) * 4)))
+#define BITBAND_SRAM(var, bit) ((volatile unsigned int *)(BITBAND_SRAM_ALIAS + ((((unsigned int)(var)) - BITBAND_SRAM_BASE) * 32) + ((bit) * 4)))
+#else  // Host build - same effect on the simulated register image
+#define BITBAND_PERI(reg, bit) (ra4m1::SimBitBand(ra4m1::sim_phys(reg), (bit)))
+#define BITBAND_SRAM(var, bit) (ra4m1::SimRamBitBand((var), (bit)))
+#endif
 // ==== Clock Frequency Accuracy Measurement Circuit (CAC) ====
-#define CACBASE 0x40040000 //
+#define CACBASE RA4M1_BASE(0x40040000) //
 #define CAC_CACR0       ((volatile unsigned char *)(CACBASE + 0x4600))  // CAC Control Register 0
 #define CACR0_CFME          0   // Clock Frequency Measurement Enable; 0: Disable, 1: Enable
 #define CAC_CACR1       ((volatile unsigned char *)(CACBASE + 0x4601))  // CAC Control Register 1
@@ -220,7 +267,7 @@
  ...
 */
 
-#define ICUBASE 0x40000000 // ICU Base - See 13.2.6 page 233
+#define ICUBASE RA4M1_BASE(0x40000000) // ICU Base - See 13.2.6 page 233
 // 32 bits -
 #define IELSR 0x6300 // ICU Event Link Setting Register n
 #define ICU_IELSR00 ((volatile unsigned int *)(ICUBASE + IELSR))            //
@@ -255,6 +302,9 @@
 #define ICU_IELSR29 ((volatile unsigned int *)(ICUBASE + IELSR + (29 * 4))) //
 #define ICU_IELSR30 ((volatile unsigned int *)(ICUBASE + IELSR + (30 * 4))) //
 #define ICU_IELSR31 ((volatile unsigned int *)(ICUBASE + IELSR + (31 * 4))) //
+#define IELSR_IELS_7_0   0   // Event Link Select - one of the IRQ Event Numbers below, 0: Slot not used
+#define IELSR_IR        16   // Interrupt Status Flag; 1: Event has occurred - write 0 in the ISR to clear it
+#define IELSR_DTCE      24   // DTC Activation Enable; 0: Event goes to the NVIC, 1: Event starts the DTC
 
 // IRQ Event Numbers
 #define IRQ_NO_EVENT         0x00
@@ -463,7 +513,7 @@
 #define ICU_SELSR0  ((volatile unsigned short  *)(ICUBASE + 0x6200))         // SYS Event Link Setting Register
 
 // ==== NVIC Interrupt Controller ====
-#define NVICBASE 0xE0000000 // NVIC Interrupt Controller
+#define NVICBASE RA4M1_BASE(0xE0000000) // NVIC Interrupt Controller
 
 // asm volatile("dsb"); // <<<< use a DSB instruction to ensure bus-synchronisition for NVIC write operations
 
@@ -592,10 +642,15 @@
 
 
 // ==== Event Link Controller ====
-#define ELCBASE 0x40040000 // Event Link Controller
+#define ELCBASE RA4M1_BASE(0x40040000) // Event Link Controller
 #define ELC_ELCR     ((volatile unsigned char  *)(ELCBASE + 0x1000))              // Event Link Controller Register
+#define ELCR_ELCON          7   // All Event Link Enable; 0: ELC function is disabled, 1: enabled
 #define ELC_ELSEGR0  ((volatile unsigned char  *)(ELCBASE + 0x1002))              // Event Link Software Event Generation Register 0
 #define ELC_ELSEGR1  ((volatile unsigned char  *)(ELCBASE + 0x1004))              // Event Link Software Event Generation Register 1
+#define ELSEGR_SEG          0   // Software Event Generation - write 1 with WE = 1, WI = 0
+#define ELSEGR_WE           6   // SEG Bit Write Enable - write 1 first, with SEG = 0
+#define ELSEGR_WI           7   // ELSEGR Register Write Disable - must be 0 for a write to take
+//   *ELC_ELSEGR0 = 0x00;  *ELC_ELSEGR0 = 0x40;  *ELC_ELSEGR0 = 0x41;   // IRQ_ELC_SWEVT0
 #define ELSR 0x1010        // Event Link Setting Registers
 #define ELC_ELSR00   ((volatile unsigned short *)(ELCBASE + ELSR +( 0 * 4)))      // ELC_GPTA
 #define ELC_ELSR01   ((volatile unsigned short *)(ELCBASE + ELSR +( 1 * 4)))      // ELC_GPTB
@@ -615,12 +670,137 @@
 #define ELC_ELSR18   ((volatile unsigned short *)(ELCBASE + ELSR +(18 * 4)))      // ELC_CTSU
 
 
+// ==== DMA Controller (DMAC) ====
+// Four channels, 0x40 apart; an ICU event in DELSRn starts a transfer on channel n
+#define DMACBASE RA4M1_BASE(0x40005000) // DMAC Channel 0 Base
+
+#define DMSAR 0x00  // DMA Source Address Register - 32 bit
+#define DMAC0_DMSAR ((volatile unsigned int   *)(DMACBASE + DMSAR))
+#define DMAC1_DMSAR ((volatile unsigned int   *)(DMACBASE + DMSAR + 0x40))
+#define DMAC2_DMSAR ((volatile unsigned int   *)(DMACBASE + DMSAR + 0x80))
+#define DMAC3_DMSAR ((volatile unsigned int   *)(DMACBASE + DMSAR + 0xC0))
+
+#define DMDAR 0x04  // DMA Destination Address Register - 32 bit
+#define DMAC0_DMDAR ((volatile unsigned int   *)(DMACBASE + DMDAR))
+#define DMAC1_DMDAR ((volatile unsigned int   *)(DMACBASE + DMDAR + 0x40))
+#define DMAC2_DMDAR ((volatile unsigned int   *)(DMACBASE + DMDAR + 0x80))
+#define DMAC3_DMDAR ((volatile unsigned int   *)(DMACBASE + DMDAR + 0xC0))
+
+#define DMCRA 0x08  // DMA Transfer Count Register - 32 bit
+#define DMAC0_DMCRA ((volatile unsigned int   *)(DMACBASE + DMCRA))
+#define DMAC1_DMCRA ((volatile unsigned int   *)(DMACBASE + DMCRA + 0x40))
+#define DMAC2_DMCRA ((volatile unsigned int   *)(DMACBASE + DMCRA + 0x80))
+#define DMAC3_DMCRA ((volatile unsigned int   *)(DMACBASE + DMCRA + 0xC0))
+#define DMCRA_DMCRAL_15_0  0   // Transfer count; Normal mode: 0 = free running, Repeat / Block: counts down the repeat / block size
+#define DMCRA_DMCRAH_9_0  16   // Repeat / Block size, reloaded into DMCRAL; 0 = 1024
+
+#define DMCRB 0x0C  // DMA Block Transfer Count Register - 16 bit; Repeat / Block count, 0 = 65536
+#define DMAC0_DMCRB ((volatile unsigned short *)(DMACBASE + DMCRB))
+#define DMAC1_DMCRB ((volatile unsigned short *)(DMACBASE + DMCRB + 0x40))
+#define DMAC2_DMCRB ((volatile unsigned short *)(DMACBASE + DMCRB + 0x80))
+#define DMAC3_DMCRB ((volatile unsigned short *)(DMACBASE + DMCRB + 0xC0))
+
+#define DMTMD 0x10  // DMA Transfer Mode Register - 16 bit
+#define DMAC0_DMTMD ((volatile unsigned short *)(DMACBASE + DMTMD))
+#define DMAC1_DMTMD ((volatile unsigned short *)(DMACBASE + DMTMD + 0x40))
+#define DMAC2_DMTMD ((volatile unsigned short *)(DMACBASE + DMTMD + 0x80))
+#define DMAC3_DMTMD ((volatile unsigned short *)(DMACBASE + DMTMD + 0xC0))
+#define DMTMD_DCTG_1_0   0   // Transfer Request Source; 0b00: Software, 0b01: Interrupt (the DELSRn event)
+#define DMTMD_SZ_1_0     8   // Transfer Data Size; 0b00: 8 bits, 0b01: 16 bits, 0b10: 32 bits
+#define DMTMD_DTS_1_0   12   // Repeat Area; 0b00: Destination, 0b01: Source, 0b10: None
+#define DMTMD_MD_1_0    14   // Transfer Mode; 0b00: Normal, 0b01: Repeat, 0b10: Block
+
+#define DMINT 0x13  // DMA Interrupt Setting Register - 8 bit
+#define DMAC0_DMINT ((volatile unsigned char  *)(DMACBASE + DMINT))
+#define DMAC1_DMINT ((volatile unsigned char  *)(DMACBASE + DMINT + 0x40))
+#define DMAC2_DMINT ((volatile unsigned char  *)(DMACBASE + DMINT + 0x80))
+#define DMAC3_DMINT ((volatile unsigned char  *)(DMACBASE + DMINT + 0xC0))
+#define DMINT_DARIE  0   // Destination Address Extended Repeat Area Overflow Interrupt Enable
+#define DMINT_SARIE  1   // Source Address Extended Repeat Area Overflow Interrupt Enable
+#define DMINT_RPTIE  2   // Repeat Size End Interrupt Enable
+#define DMINT_ESIE   3   // Transfer Escape End Interrupt Enable
+#define DMINT_DTIE   4   // Transfer End Interrupt Enable
+
+#define DMAMD 0x14  // DMA Address Mode Register - 16 bit
+#define DMAC0_DMAMD ((volatile unsigned short *)(DMACBASE + DMAMD))
+#define DMAC1_DMAMD ((volatile unsigned short *)(DMACBASE + DMAMD + 0x40))
+#define DMAC2_DMAMD ((volatile unsigned short *)(DMACBASE + DMAMD + 0x80))
+#define DMAC3_DMAMD ((volatile unsigned short *)(DMACBASE + DMAMD + 0xC0))
+#define DMAMD_DARA_4_0   0   // Destination Extended Repeat Area; 2^DARA bytes, 0: None
+#define DMAMD_DM_1_0     6   // Destination Address Update; 0b00: Fixed, 0b01: Offset, 0b10: Increment, 0b11: Decrement
+#define DMAMD_SARA_4_0   8   // Source Extended Repeat Area
+#define DMAMD_SM_1_0    14   // Source Address Update; as DM
+
+#define DMOFR 0x18  // DMA Offset Register - 32 bit
+#define DMAC0_DMOFR ((volatile unsigned int   *)(DMACBASE + DMOFR))
+#define DMAC1_DMOFR ((volatile unsigned int   *)(DMACBASE + DMOFR + 0x40))
+#define DMAC2_DMOFR ((volatile unsigned int   *)(DMACBASE + DMOFR + 0x80))
+#define DMAC3_DMOFR ((volatile unsigned int   *)(DMACBASE + DMOFR + 0xC0))
+
+#define DMCNT 0x1C  // DMA Transfer Enable Register - 8 bit
+#define DMAC0_DMCNT ((volatile unsigned char  *)(DMACBASE + DMCNT))
+#define DMAC1_DMCNT ((volatile unsigned char  *)(DMACBASE + DMCNT + 0x40))
+#define DMAC2_DMCNT ((volatile unsigned char  *)(DMACBASE + DMCNT + 0x80))
+#define DMAC3_DMCNT ((volatile unsigned char  *)(DMACBASE + DMCNT + 0xC0))
+#define DMCNT_DTE    0   // DMA Transfer Enable; 1: Enabled - cleared by the DMAC at the end of the transfer
+
+#define DMREQ 0x1D  // DMA Software Start Register - 8 bit
+#define DMAC0_DMREQ ((volatile unsigned char  *)(DMACBASE + DMREQ))
+#define DMAC1_DMREQ ((volatile unsigned char  *)(DMACBASE + DMREQ + 0x40))
+#define DMAC2_DMREQ ((volatile unsigned char  *)(DMACBASE + DMREQ + 0x80))
+#define DMAC3_DMREQ ((volatile unsigned char  *)(DMACBASE + DMREQ + 0xC0))
+#define DMREQ_SWREQ  0   // DMA Software Start; 1: Request a transfer
+#define DMREQ_CLRS   4   // SWREQ Status Clear Select; 0: SWREQ cleared after each transfer, 1: Kept - transfers run to the end
+
+#define DMSTS 0x1E  // DMA Status Register - 8 bit
+#define DMAC0_DMSTS ((volatile unsigned char  *)(DMACBASE + DMSTS))
+#define DMAC1_DMSTS ((volatile unsigned char  *)(DMACBASE + DMSTS + 0x40))
+#define DMAC2_DMSTS ((volatile unsigned char  *)(DMACBASE + DMSTS + 0x80))
+#define DMAC3_DMSTS ((volatile unsigned char  *)(DMACBASE + DMSTS + 0xC0))
+#define DMSTS_ESIF   0   // Transfer Escape End Interrupt Flag - write 0 to clear
+#define DMSTS_DTIF   4   // Transfer End Interrupt Flag - write 0 to clear
+#define DMSTS_ACT    7   // DMA Active Flag; 1: Transfer in progress
+
+#define DMAC_DMAST  ((volatile unsigned char  *)(DMACBASE + 0x0200))  // DMA Module Activation Register
+#define DMAST_DMST   0   // DMAC Operation Enable; 1: All channels enabled
+
+#define DELSR 0x6280  // DMAC Event Link Setting Register n - in the ICU, as IELSR
+#define ICU_DELSR0  ((volatile unsigned int *)(ICUBASE + DELSR))            // DMAC0 Start Event
+#define ICU_DELSR1  ((volatile unsigned int *)(ICUBASE + DELSR + ( 1 * 4))) // DMAC1 Start Event
+#define ICU_DELSR2  ((volatile unsigned int *)(ICUBASE + DELSR + ( 2 * 4))) // DMAC2 Start Event
+#define ICU_DELSR3  ((volatile unsigned int *)(ICUBASE + DELSR + ( 3 * 4))) // DMAC3 Start Event
+#define DELSR_DELS_7_0   0   // Event Number - the IRQ_xxx value, 0: None
+#define DELSR_IR        16   // Interrupt Status Flag for the DMAC
+// ==== Data Transfer Controller (DTC) ====
+// An event in an IELSRn slot with IELSR_DTCE set starts the DTC, which reads the transfer
+// information address from entry n of the vector table at DTCVBR.
+#define DTCBASE RA4M1_BASE(0x40005400) // DTC Base
+#define DTC_DTCCR   ((volatile unsigned char  *)(DTCBASE + 0x00))  // DTC Control Register
+#define DTCCR_RRS        4   // DTC Transfer Information Read Skip Enable; 1: Skip the read when the vector is the same as last time
+#define DTC_DTCVBR  ((volatile unsigned int   *)(DTCBASE + 0x04))  // DTC Vector Base Register - 1 KB aligned, bits 9-0 are 0
+#define DTC_DTCST   ((volatile unsigned char  *)(DTCBASE + 0x0C))  // DTC Module Start Register
+#define DTCST_DTCST      0   // DTC Module Start; 1: DTC enabled
+#define DTC_DTCSTS  ((volatile unsigned short *)(DTCBASE + 0x0E))  // DTC Status Register
+#define DTCSTS_VECN_7_0  0   // Vector number of the transfer in progress
+#define DTCSTS_ACT      15   // DTC Active Flag; 1: Transfer in progress
+
+// Transfer information - 4 words in SRAM: MRA:MRB, SAR, DAR, CRA:CRB. Bit positions in word 0:
+#define DTC_MRB_DM_1_0     18  // Destination Address; 0b0x: Fixed, 0b10: Increment, 0b11: Decrement
+#define DTC_MRB_DTS        20  // Repeat / Block Area; 0: Destination, 1: Source
+#define DTC_MRB_DISEL      21  // Interrupt Select; 0: CPU interrupt at the end of the count, 1: after every transfer
+#define DTC_MRB_CHNS       22  // Chain Select; 0: Chain every time, 1: Chain only when the count ends
+#define DTC_MRB_CHNE       23  // Chain Enable; 1: Run the next transfer information straight after this one
+#define DTC_MRA_SM_1_0     26  // Source Address; as DM
+#define DTC_MRA_SZ_1_0     28  // Size; 0b00: 8 bits, 0b01: 16 bits, 0b10: 32 bits
+#define DTC_MRA_MD_1_0     30  // Mode; 0b00: Normal, 0b01: Repeat, 0b10: Block
+// Word 3: CRB b15-0 blocks (Block mode, 0 = 65536); CRA b31-16 - Normal: count (0 = 65536); Repeat / Block: CRAL b23-16 count, CRAH b31-24 size (0 = 256)
 // ==== Low Power Mode Control ====
-#define SYSTEM 0x40010000 // System Registers
+#define SYSTEM RA4M1_BASE(0x40010000) // System Registers
 #define SYSTEM_SBYCR   ((volatile unsigned short *)(SYSTEM + 0xE00C))      // Standby Control Register
 #define SYSTEM_MSTPCRA ((volatile unsigned int   *)(SYSTEM + 0xE01C))      // Module Stop Control Register A
+#define MSTPA22 22 // DMAC / DTC - needs PRCR_PRC1
 
-#define MSTP 0x40040000 // Module Registers
+#define MSTP RA4M1_BASE(0x40040000) // Module Registers
 #define MSTP_MSTPCRB   ((volatile unsigned int   *)(MSTP + 0x7000))      // Module Stop Control Register B
 #define MSTPB2   2 // CAN0
 #define MSTPB8   8 // IIC1
@@ -652,6 +832,7 @@
 #define MSTPD16 16 // ADC140 - 14-Bit A/D Converter Module
 #define MSTPD19 19 // DAC8   -  8-Bit D/A Converter Module
 #define MSTPD20 20 // DAC12  - 12-Bit D/A Converter Module
+#define MSTPD22 22 // TSN    - Temperature Sensor Module
 #define MSTPD29 29 // ACMPLP - Low-Power Analog Comparator Module
 #define MSTPD31 31 // OPAMP  - Operational Amplifier Module
 
@@ -661,7 +842,7 @@
 
 
 // ==== USB 2.0 Full-Speed Module ====
-#define USBFSBASE  0x40090000
+#define USBFSBASE  RA4M1_BASE(0x40090000)
 
 #define USBFS_SYSCFG     ((volatile unsigned short *)(USBFSBASE + 0x0000))
 #define USBFS_SYSSTS0    ((volatile unsigned short *)(USBFSBASE + 0x0004))
@@ -731,7 +912,7 @@
 
 
 // ==== 14-Bit A/D Converter ====
-#define ADCBASE 0x40050000 /* ADC Base */
+#define ADCBASE RA4M1_BASE(0x40050000) /* ADC Base */
                                                                            // N/C = Pin not connected; N/A = No pin for LQFP64 package
 // 16 bit registers
 #define ADC140_ADDR00   ((volatile unsigned short *)(ADCBASE + 0xC020))      // A1 (P000 AN00 AMP+)
@@ -766,13 +947,17 @@
 #define ADC140_ADDBLDRB ((volatile unsigned short *)(ADCBASE + 0xC086))    // A/D Data Duplexing Register B
 // A/D Control Register
 #define ADC140_ADCSR      ((volatile unsigned short *)(ADCBASE + 0xC000))
-#define ADCSR_DBLANS_4_0   0 // Double Trigger Channel Select
+#define ADCSR_DBLANS_4_0   0 // Double Trigger Channel Select - ANn, 0 - 25
 #define ADCSR_GBADIE       6 // Group B Scan End Interrupt Enable
-#define ADCSR_DBLE         7 // Double Trigger Mode Select
+#define ADCSR_DBLE         7 // Double Trigger Mode Select - single scan of DBLANS: 1st trigger to ADDRn, 2nd to ADDBLDR, then ADI
 #define ADCSR_EXTRG        8 // Trigger Select
 #define ADCSR_TRGE         9 // Trigger Start Enable
 #define ADCSR_ADHSC       10 // A/D Conversion Mode Select - 0: High-speed; 1: Low-power
+#define ADCSR_ADIE        12 // Scan End Interrupt Enable
 #define ADCSR_ADCS_1_0    13 // Scan Mode Select
+#define ADC_ADCS_SINGLE  0b00 // Single scan
+#define ADC_ADCS_GROUP   0b01 // Group scan - group A / B on their own triggers
+#define ADC_ADCS_CONT    0b10 // Continuous scan - the next scan starts as each one ends
 #define ADCSR_ADST        15 // A/D Conversion Start
 // A/D Channel Select Register A0
 #define ADC140_ADANSA0    ((volatile unsigned short *)(ADCBASE + 0xC004))
@@ -835,6 +1020,8 @@
 // A/D Control Extended Register
 #define ADC140_ADCER      ((volatile unsigned short *)(ADCBASE + 0xC00E))
 #define ADCER_ADPCR_1_0    1 // A/D Conversion Accuracy Specify - 0b00: 12-bit accuracy; 0b11: 14-bit accuracy
+#define ADC_ADPCR_12BIT  0b00 // 12-bit accuracy
+#define ADC_ADPCR_14BIT  0b11 // 14-bit accuracy
 #define ADCER_ACE          5 // A/D Data Register Automatic Clearing Enable
 #define ADCER_DIAGVAL_1_0  8 // Self-Diagnosis Conversion Voltage Select
 #define ADCER_DIAGLD      10 // Self-Diagnosis Mode Select
@@ -844,10 +1031,17 @@
 #define ADC140_ADSTRGR    ((volatile unsigned short *)(ADCBASE + 0xC010))
 #define ADSTRGR_TRSB_5_0   0 // A/D Conversion Start Trigger Select for Group B
 #define ADSTRGR_TRSA_5_0   8 // A/D Conversion Start Trigger Select for Group A OR single scan mode
+#define ADC_TRS_ADTRG0     0x00 // ADTRG0 pin - with ADCSR_EXTRG = 1
+#define ADC_TRS_ELC_AD00   0x09 // ELC_ELSR08 event - with ADCSR_EXTRG = 0
+#define ADC_TRS_ELC_AD01   0x0A // ELC_ELSR09 event
+#define ADC_TRS_ELC_BOTH   0x0B // ELC_ELSR08 and ELC_ELSR09 events
+#define ADC_TRS_NONE       0x3F // No trigger - software start only
 // A/D Conversion Extended Input Control Register
 #define ADC140_ADEXICR    ((volatile unsigned short *)(ADCBASE + 0xC012))
 #define ADEXICR_TSSAD      0 // Temperature Sensor Output A/DConverted Value Addition/Average Mode Select
 #define ADEXICR_OCSAD      1 // Internal Reference Voltage A/DConverted Value Addition/Average Mode Select
+#define ADEXICR_TSSB      10 // Temperature Sensor Output A/D Conversion Select for Group B
+#define ADEXICR_OCSB      11 // Internal Reference Voltage A/D Conversion Select for Group B
 #define ADEXICR_TSSA       8 // Temperature Sensor Output A/D Conversion Select
 #define ADEXICR_OCSA       9 // Internal Reference Voltage A/D Conversion Select
 // A/D Channel Select Register B0
@@ -889,6 +1083,9 @@
 // A/D Compare Function Control Register
 #define ADC140_ADCMPCR    ((volatile unsigned short *)(ADCBASE + 0xC090))
 #define ADCMPCR_CMPAB_1_0  0 // Window A/B Composite Conditions Setting
+#define ADC_CMPAB_OR     0b00 // WCMPM when window A or window B matches
+#define ADC_CMPAB_XOR    0b01 // Window A exclusive or window B
+#define ADC_CMPAB_AND    0b10 // Window A and window B
 #define ADCMPCR_CMPBE      9 // Compare Window B Operation Enable
 #define ADCMPCR_CMPAE     11 // Compare Window A Operation Enable
 #define ADCMPCR_CMPBIE    13 // Compare B Interrupt Enable
@@ -915,11 +1112,13 @@
 #define ADC_AVG_3      0b010 // 3 conversions, with averaging
 #define ADC_AVG_4      0b011 // 4 conversions, with averaging
 #define ADC_AVG_16     0b101 // 16 conversions, with averaging - ONLY for 12-bit ADC mode
-#define ADADC_AVEE         7 //
+#define ADADC_AVEE         7 // Average Mode Enable - 0: addition, the sum of the conversions; 1: average
 // A/D Disconnection Detection Control Register
 #define ADC140_ADDISCR    ((volatile unsigned char  *)(ADCBASE + 0xC07A)) // A/D Disconnection Detection Control Register
 #define ADDISCR_ADNDIS_3_0    0 // Precharge/Discharge period
-#define ADDISCR_PCHG          4 // Precharge/Discharge select
+#define ADDISCR_PCHG          4 // Precharge/Discharge select - 0: discharge to VREFL; 1: precharge to VREFH
+#define ADC_NDIS_OFF      0x0 // ADNDIS: no precharge / discharge - 0x1 is prohibited, 0x2 - 0xF: that many ADCLK states
+#define ADC_NDIS_MAX      0xF
 // A/D High-Potential/Low-Potential Reference Voltage Control Register
 #define ADC140_ADHVREFCNT ((volatile unsigned char  *)(ADCBASE + 0xC08A))
 #define ADHVREFCNT_HVSEL_1_0  0 // High-Potential Reference Voltage Select:
@@ -931,11 +1130,26 @@
 #define ADHVREFCNT_ADSLP      7 // Sleep
 // A/D Compare Function Window Registers
 #define ADC140_ADWINMON   ((volatile unsigned char  *)(ADCBASE + 0xC08C)) // A/D Compare Function Window A/B Status Monitor Register
+#define ADWINMON_MONCOMB      0 // Combination Result Monitor
+#define ADWINMON_MONCMPA      4 // Comparison Result Monitor A
+#define ADWINMON_MONCMPB      5 // Comparison Result Monitor B
 #define ADC140_ADCMPANSER ((volatile unsigned char  *)(ADCBASE + 0xC092)) // A/D Compare Function Window A Extended Input Select Register
+#define ADCMPANSER_CMPTSA     0 // Temperature Sensor Output Compare Select
+#define ADCMPANSER_CMPOCA     1 // Internal Reference Voltage Compare Select
 #define ADC140_ADCMPLER   ((volatile unsigned char  *)(ADCBASE + 0xC093)) // A/D Compare Function Window A Extended Input Comparison Condition Setting Register
+#define ADCMPLER_CMPLTSA      0 // Compare Window A Temperature Sensor Output Comparison Condition Select
+#define ADCMPLER_CMPLOCA      1 // Compare Window A Internal Reference Voltage Comparison Condition Select
 #define ADC140_ADCMPSER   ((volatile unsigned char  *)(ADCBASE + 0xC0A4)) // A/D Compare Function Window A Extended Input Channel Status Register
+#define ADCMPSER_CMPSTTSA     0 // Compare Window A Temperature Sensor Output Compare Flag
+#define ADCMPSER_CMPSTOCA     1 // Compare Window A Internal Reference Voltage Compare Flag
 #define ADC140_ADCMPBNSER ((volatile unsigned char  *)(ADCBASE + 0xC0A6)) // A/D Compare Function Window B Channel Select Register
+#define ADCMPBNSR_CMPCHB_5_0  0 // Compare Window B Channel Select - 0x00 - 0x19: AN000 - AN025
+#define ADC_CMPCHB_TEMP    0x20 // Temperature sensor output
+#define ADC_CMPCHB_VREF    0x21 // Internal reference voltage
+#define ADC_CMPCHB_NONE    0x3F // No channel
+#define ADCMPBNSR_CMPLB       7 // Compare Window B Comparison Condition Setting
 #define ADC140_ADCMPBSR   ((volatile unsigned char  *)(ADCBASE + 0xC0AC)) // A/D Compare Function Window B Status Register
+#define ADCMPBSR_CMPSTB       0 // Compare Window B Flag
 
 // 35.2.14 A/D Sampling State Register n (ADSSTRn) (n = 00 to 14, L, T, O)
 #define ADC140_ADSSTR00 ((volatile unsigned char *)(ADCBASE + 0xC0E0))      // AN00
@@ -956,10 +1170,12 @@
 #define ADC140_ADSSTRL  ((volatile unsigned char *)(ADCBASE + 0xC0DD))      // AN16 to AN25
 #define ADC140_ADSSTRT  ((volatile unsigned char *)(ADCBASE + 0xC0DE))      // Temp
 #define ADC140_ADSSTRO  ((volatile unsigned char *)(ADCBASE + 0xC0DF))      // Iref
+#define ADC_SSTR_MIN      5   // SST: 5 - 255 ADCLK states
+#define ADC_SSTR_RESET 0x0D   // Value after reset
 
 
 // ==== 12-Bit D/A Converter ====
-#define DACBASE 0x40050000          // DAC Base - DAC output on A0 (P014 AN09 DAC)
+#define DACBASE RA4M1_BASE(0x40050000)          // DAC Base - DAC output on A0 (P014 AN09 DAC)
 #define DAC12_DADR0    ((volatile unsigned short *)(DACBASE + 0xE000))      // D/A Data Register 0
 #define DAC12_DACR     ((volatile unsigned char  *)(DACBASE + 0xE004))      // D/A Control Register
 #define DAC12_DADPR    ((volatile unsigned char  *)(DACBASE + 0xE005))      // DADR0 Format Select Register
@@ -968,7 +1184,7 @@
 
 
 // =========== Ports ============
-#define PORTBASE 0x40040000 /* Port Base */
+#define PORTBASE RA4M1_BASE(0x40040000) /* Port Base */
 
 // 19.2.1 Port Control Registers, to control/access multiple pins with a single operation
 // Not all options defined for each register, expand as needed
@@ -981,6 +1197,22 @@
 #define PORT4_PCNTR1 ((volatile unsigned int *)(PORTBASE + PCNTR1 + (4 * 0x20))) //
 #define PORT5_PCNTR1 ((volatile unsigned int *)(PORTBASE + PCNTR1 + (5 * 0x20))) //
 
+#define PCNTR2 0x0004  // Port n Control Register 2 - 32bit access - PIDR in b15-0, EIDR in b31-16
+#define PORT0_PCNTR2 ((volatile unsigned int *)(PORTBASE + PCNTR2))              //
+#define PORT1_PCNTR2 ((volatile unsigned int *)(PORTBASE + PCNTR2 + (1 * 0x20))) //
+#define PORT2_PCNTR2 ((volatile unsigned int *)(PORTBASE + PCNTR2 + (2 * 0x20))) //
+#define PORT3_PCNTR2 ((volatile unsigned int *)(PORTBASE + PCNTR2 + (3 * 0x20))) //
+#define PORT4_PCNTR2 ((volatile unsigned int *)(PORTBASE + PCNTR2 + (4 * 0x20))) //
+#define PORT5_PCNTR2 ((volatile unsigned int *)(PORTBASE + PCNTR2 + (5 * 0x20))) //
+
+#define PCNTR3 0x0008  // Port n Control Register 3 - 32bit access - POSR in b15-0, PORR in b31-16
+#define PORT0_PCNTR3 ((volatile unsigned int *)(PORTBASE + PCNTR3))              // Set and clear pins of a port
+#define PORT1_PCNTR3 ((volatile unsigned int *)(PORTBASE + PCNTR3 + (1 * 0x20))) // ... in one write
+#define PORT2_PCNTR3 ((volatile unsigned int *)(PORTBASE + PCNTR3 + (2 * 0x20))) //
+#define PORT3_PCNTR3 ((volatile unsigned int *)(PORTBASE + PCNTR3 + (3 * 0x20))) //
+#define PORT4_PCNTR3 ((volatile unsigned int *)(PORTBASE + PCNTR3 + (4 * 0x20))) //
+#define PORT5_PCNTR3 ((volatile unsigned int *)(PORTBASE + PCNTR3 + (5 * 0x20))) //
+
 #define PODR 0x0000  // Port n Control Register 1 - Output Data
 #define PORT0_PODR ((volatile unsigned short *)(PORTBASE + PODR))              //
 #define PORT1_PODR ((volatile unsigned short *)(PORTBASE + PODR + (1 * 0x20))) //
@@ -1126,6 +1358,24 @@
 #define PFS_PMR   16  // Pin Mode Control    - 1: Used as an I/O port for peripheral functions
 #define PFS_PSEL_4_0 24 // Peripheral Function Select
 
+// PSEL values - the peripheral a pin is connected to when PFS_PMR is 1
+#define PSEL_IO       0x00  // No peripheral - port I/O
+#define PSEL_AGT      0x01  // AGTIO, AGTO, AGTOA, AGTOB, AGTEE
+#define PSEL_GPT0     0x02  // GTETRG, GTIOC - see the pin function table for which
+#define PSEL_GPT1     0x03  // GTIOC, GTOUUP, etc.
+#define PSEL_SCI_EVEN 0x04  // SCI0 / SCI2
+#define PSEL_SCI_ODD  0x05  // SCI1 / SCI9
+#define PSEL_SPI      0x06  // RSPCKA, MOSIA, MISOA, SSLA0-3
+#define PSEL_IIC      0x07  // SCL0/1, SDA0/1
+#define PSEL_KINT     0x08  // Key interrupt
+#define PSEL_CLKOUT   0x09  // CLKOUT, ACMPLP, RTCOUT
+#define PSEL_CAC_ADC  0x0A  // CACREF, ADTRG0
+#define PSEL_CTSU     0x0C  // Capacitive touch
+#define PSEL_SLCDC    0x0D  // Segment LCD
+#define PSEL_CAN      0x10  // CRX0, CTX0
+#define PSEL_SSI      0x12  // Serial sound
+#define PSEL_USBFS    0x13  // USB_VBUS, USB_OVRCURA, etc.
+
 // 16 bit register access
 #define PFS_P100PFS_HA ((volatile unsigned short *)(PORTBASE + 0x0842))
 #define PFS_P115PFS_HA ((volatile unsigned short *)(PORTBASE + 0x0842 + (15 * 2)))
@@ -1191,7 +1441,7 @@
 
 
 // ==== General PWM Timer (GPT) ====
-#define GPTBASE 0x40070000 /* PWM Base */
+#define GPTBASE RA4M1_BASE(0x40070000) /* PWM Base */
 
 #define GTWP 0x8000  // General PWM Timer Write-Protection Register
 #define GPT320_GTWP ((volatile unsigned int *)(GPTBASE + GTWP))
@@ -1284,6 +1534,9 @@
 #define GPT167_GTDNSR ((volatile unsigned int *)(GPTBASE + GTDNSR + 0x0700))
 
 #define GTICASR 0x8024 // General PWM Timer Input Capture Source Select Register A
+#define GPT320_GTICASR ((volatile unsigned int *)(GPTBASE + GTICASR))
+#define GPT321_GTICASR ((volatile unsigned int *)(GPTBASE + GTICASR + 0x0100))
+#define GTICASR_ASELCA 16  // ELC_GPTA Event Source GTCCRA Input Capture Enable - see ELC_ELSR00; ASELCB - ASELCH are bits 17 - 23
 #define GTICBSR 0x8028 // General PWM Timer Input Capture Source Select Register B
 
 #define GTCR 0x802C // General PWM Timer Control Register
@@ -1295,6 +1548,11 @@
 #define GPT165_GTCR ((volatile unsigned int *)(GPTBASE + GTCR + 0x0500))
 #define GPT166_GTCR ((volatile unsigned int *)(GPTBASE + GTCR + 0x0600))
 #define GPT167_GTCR ((volatile unsigned int *)(GPTBASE + GTCR + 0x0700))
+#define GTCR_CST        0   // Count Start; 0: Count operation is stopped, 1: Count operation is performed
+#define GTCR_MD_2_0    16   // Mode Select; 000: Saw-wave PWM mode
+#define GPT_MD_SAW      0b000 // Saw-wave PWM - up from 0 to GTPR, period GTPR + 1 counts
+#define GPT_MD_TRIANGLE 0b100 // Triangle-wave PWM mode 1 - up to GTPR and back down, period 2 * GTPR; compare matches both ways
+#define GTCR_TPCS_2_0  24   // Timer Prescaler Select; 000: PCLKD/1, 001: /4, 010: /16, 011: /64, 100: /256, 101: /1024
 
 #define GTUDDTYC 0x8030 // General PWM Timer Count Direction and Duty Setting Register
 #define GPT320_GTUDDTYC ((volatile unsigned int *)(GPTBASE + GTUDDTYC))
@@ -1335,6 +1593,10 @@
 #define GPT165_GTBER ((volatile unsigned int *)(GPTBASE + GTBER + 0x0500))
 #define GPT166_GTBER ((volatile unsigned int *)(GPTBASE + GTBER + 0x0600))
 #define GPT167_GTBER ((volatile unsigned int *)(GPTBASE + GTBER + 0x0700))
+#define GTBER_BD_3_0    0   // GTCCR / GTPR / GTADTR / GTDV Buffer Operation Disable
+#define GTBER_CCRA_1_0 16   // GTCCRA Buffer Operation; 00: No buffer, 01: Single buffer - write GTCCRC
+#define GTBER_CCRB_1_0 18   // GTCCRB Buffer Operation; 00: No buffer, 01: Single buffer - write GTCCRE
+#define GTBER_PR_1_0   20   // GTPR Buffer Operation; 00: No buffer, 01: Single buffer - write GTPBR, moved to GTPR at overflow
 
 // Note: GTCNT can only be written to after the counting stops
 #define GTCNT 0x8048 // General PWM Timer Counter
@@ -1430,7 +1692,7 @@
 #define GPT167_GTPBR ((volatile unsigned int *)(GPTBASE + GTPBR + 0x0700))
 
 // ====  Asynchronous General Purpose Timer (AGT) =====
-#define AGTBASE 0x40084000
+#define AGTBASE RA4M1_BASE(0x40084000)
 #define AGT0_AGT    ((volatile unsigned short *)(AGTBASE))         // AGT Counter Register
 #define AGT1_AGT    ((volatile unsigned short *)(AGTBASE + 0x100))
 #define AGT0_AGTCMA ((volatile unsigned short *)(AGTBASE + 0x002)) // AGT Compare Match A Register
@@ -1446,6 +1708,8 @@
 #define AGTCR_TSTOP  2  // W   - AGT Count Forced Stop; 1: The count is forcibly stopped, 0: Writing 0 is invalid!!!
 #define AGT0_AGTMR1   ((volatile unsigned char  *)(AGTBASE + 0x009))  // AGT Mode Register 1
 #define AGT1_AGTMR1   ((volatile unsigned char  *)(AGTBASE + 0x109))  //
+#define AGTMR1_TMOD_2_0  0  // Operating Mode; 000: Timer mode
+#define AGTMR1_TCK_2_0   4  // Count Source; 000: PCLKB, 001: PCLKB/8, 011: PCLKB/2, 100: AGTLCLK (LOCO), 101: AGT0 underflow, 110: AGTSCLK (SOSC)
 #define AGT0_AGTMR2   ((volatile unsigned char  *)(AGTBASE + 0x00A))  // AGT Mode Register 2
 #define AGT1_AGTMR2   ((volatile unsigned char  *)(AGTBASE + 0x10A))  //
 #define AGT0_AGTIOC   ((volatile unsigned char  *)(AGTBASE + 0x00C))  // AGT I/O Control Register
@@ -1460,7 +1724,7 @@
 
 // Note: With the Arduino IDE setup, it does not appear possible to use the WatchDog timers
 // ====  Watchdog Timer (WDT) =====
-#define WDTBASE 0x40044200
+#define WDTBASE RA4M1_BASE(0x40044200)
 #define WDT_WDTCR    ((volatile unsigned short *)(WDTBASE + 0x02))  // WDT Control Register
 #define WDT_WDTSR    ((volatile unsigned short *)(WDTBASE + 0x04))  // WDT Status Register
 
@@ -1470,7 +1734,7 @@
 #define WDT_WDTCSTPR ((volatile unsigned char  *)(WDTBASE + 0x06))  // WDT Count Stop Control Register
 
 // ====  Independant Watchdog Timer (IWDT) =====
-#define IWDTBASE 0x40044000
+#define IWDTBASE RA4M1_BASE(0x40044000)
 #define IWDT_IWDTSR    ((volatile unsigned short *)(IWDTBASE + 0x04))  // WDT Status Register
 
 // 8 bit registers
@@ -1478,7 +1742,7 @@
 
 
 // ==== 28. Serial Communications Interface (SCI) ====
-#define SCIBASE 0x40070000
+#define SCIBASE RA4M1_BASE(0x40070000)
 // Receive Data Register
 #define SCI0_RDR ((volatile unsigned char  *)(SCIBASE + 0x0005))
 #define SCI1_RDR ((volatile unsigned char  *)(SCIBASE + 0x0025))
@@ -1604,7 +1868,7 @@
 
 
 // ==== 29. I2C Bus Interface ====
-#define IICBASE 0x40050000
+#define IICBASE RA4M1_BASE(0x40050000)
 // I2C Bus Control Register 1
 #define IIC0_ICCR1 ((volatile unsigned char  *)(IICBASE + 0x3000))
 #define IIC1_ICCR1 ((volatile unsigned char  *)(IICBASE + 0x3100)) // 0x9F
@@ -1751,7 +2015,7 @@
 
 
 // ==== 31. Serial Peripheral Interface (SPI) ====
-#define SPIBASE 0x40070000
+#define SPIBASE RA4M1_BASE(0x40070000)
 // SPI Control Register
 #define SPI0_SPCR    ((volatile unsigned char  *)(SPIBASE + 0x2000))
 #define SPI1_SPCR    ((volatile unsigned char  *)(SPIBASE + 0x2100))
@@ -1859,7 +2123,7 @@
 // Serial Sound Interface Enhanced (SSIE)
 #define AUDIO_DATA_SIGNED  // I2S audio data is signed
 
-#define SSIEBASE 0x40040000          // SSIE Base - Bit Clock output on D10
+#define SSIEBASE RA4M1_BASE(0x40040000)          // SSIE Base - Bit Clock output on D10
 #define SSIE0_SSICR  ((volatile unsigned int *)(SSIEBASE + 0xE000))   // Control Register
 #define SSICR_REN        0  // 1: Enable reception.
 #define SSICR_TEN        1  // 1: Enable transmission.
@@ -1922,7 +2186,7 @@
 
 
 // 27. USB 2.0 Full-Speed Module (USBFS) - Partial fragment to check configs - and enable USB module to be turned off
-#define USBFSBASE 0x40090000          // USBFS Base
+#define USBFSBASE RA4M1_BASE(0x40090000)          // USBFS Base
 #define USBFS_SYSCFG  ((volatile unsigned short *)(USBFSBASE + 0x0000))   // System Configuration Control Register
 #define SYSCFG_USBE     0  // USBFS Operation Enable; 0: Disabled, 1: Enabled
 #define SYSCFG_SCKE    10  // USB Clock Enable
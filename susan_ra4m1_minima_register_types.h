@@ -0,0 +1,515 @@
+/*  Arduino UNO R4 Minima - typed register / bit-field layer for core RA4M1 peripheral operations:
+ *
+ *  Builds on susan_ra4m1_minima_register_defines.h - same base addresses, same bit positions -
+ *  but each register is a type and each field knows its width, so a multi-field update is one
+ *  load and one store with all of the masks worked out by the compiler:
+ *
+ *    ra4m1::modify(SCKDIVCR::PCKB.set<0>(), SCKDIVCR::PCKA.set<0>());  // ldr, and/orr, str
+ *    ra4m1::modify(SCKDIVCR::PCKB = div, SCKDIVCR::PCKA = div);          // A value known at run time
+ *
+ *  Field widths come from the _2_0 / _4_0 suffixes of the bit defines - RA4M1_FIELD(PCKB,
+ *  SCKDIVCR_PCKB, 2, 0) names SCKDIVCR_PCKB_2_0 and is 3 bits - so a wrong width is a define that
+ *  does not exist. Constants go through set<V>(), and one that does not fit will not build:
+ *  SCKDIVCR::PCKB.set<9>(). PCKB = v is for values known at run time and masks them to the field;
+ *  when v turns out to be a constant that does not fit, GCC still stops the build once it
+ *  optimises (-Os, as the Arduino build does).
+ *
+ *  Needs C++17 (fold expressions), which is what the Arduino Renesas core compiles with.
+ *
+ * This code is "AS IS" without warranty or liability.
+ * GPL v3 or later - see susan_ra4m1_minima_register_defines.h
+*/
+
+#ifndef SUSAN_RA4M1_MINIMA_REGISTER_TYPES_H
+#define SUSAN_RA4M1_MINIMA_REGISTER_TYPES_H
+
+#include "susan_ra4m1_minima_register_defines.h"
+
+// All typed accesses go through this, so a Linux build can point them at a memory image
+#ifndef RA4M1_MMIO_ADDR
+#ifdef RA4M1_HOST_SIM
+#define RA4M1_MMIO_ADDR(addr) (ra4m1::sim_map(addr))
+#else
+#define RA4M1_MMIO_ADDR(addr) (addr)
+#endif
+#endif
+
+#ifdef RA4M1_MMIO_TRACE
+#include "susan_ra4m1_minima_mmio_trace.h"
+#endif
+
+namespace ra4m1 {
+
+// Every typed register access, in one place - with RA4M1_HOST_SIM these go via the simulator hooks,
+// with RA4M1_MMIO_TRACE they are also recorded
+template <typename T>
+inline T mmio_read(unsigned int addr) {
+#ifdef RA4M1_HOST_SIM
+  T v = sim_read<T>(addr);
+#else
+  T v = *(volatile T *)(RA4M1_MMIO_ADDR(addr));
+#endif
+#ifdef RA4M1_MMIO_TRACE
+  trace_record(addr, sizeof(T) * 8, false, v);
+#endif
+  return v;
+}
+
+template <typename T>
+inline void mmio_write(unsigned int addr, T v) {
+#ifdef RA4M1_MMIO_TRACE
+  trace_record(addr, sizeof(T) * 8, true, v);
+#endif
+#ifdef RA4M1_HOST_SIM
+  sim_write<T>(addr, v);
+#else
+  *(volatile T *)(RA4M1_MMIO_ADDR(addr)) = v;
+#endif
+}
+
+// Chip address of a register define
+inline unsigned int phys(const volatile void *reg) {
+#ifdef RA4M1_HOST_SIM
+  return sim_phys(reg);
+#else
+  return (unsigned int)reg;
+#endif
+}
+
+// Same again for the plain register defines: ra4m1::mmio_write(ADC140_ADCSR, v)
+template <typename T> inline T mmio_read(volatile T *reg) { return mmio_read<T>(phys(reg)); }
+template <typename T> inline void mmio_write(volatile T *reg, T v) { mmio_write<T>(phys(reg), v); }
+
+// ICLK cycle counter - DWT_CYCCNT on the Arduino, the simulator count on the host
+inline void cycles_enable() {
+  *SCB_DEMCR |= (1 << DEMCR_TRCENA);
+  *DWT_CTRL  |= (1 << DWT_CTRL_CYCCNTENA);
+}
+
+inline unsigned int cycles() {
+#ifdef RA4M1_HOST_SIM
+  return (unsigned int)sim_cycle_count;
+#else
+  return *DWT_CYCCNT;
+#endif
+}
+
+template <unsigned int Width> struct RegWidth;
+template <> struct RegWidth<8>  { typedef unsigned char  type; };
+template <> struct RegWidth<16> { typedef unsigned short type; };
+template <> struct RegWidth<32> { typedef unsigned int   type; };
+
+// Not constexpr - so reaching it while evaluating a constant is a compile error - and never
+// defined, so a call the optimiser could not drop is one too
+__attribute__((error("Value does not fit in field - constants go through Field::set<V>()")))
+void field_value_out_of_range();
+
+template <typename F>
+struct FieldValue {
+  typedef typename F::reg reg;
+  unsigned int value;
+  constexpr typename reg::value_type bits() const { return (typename reg::value_type)((value << F::pos) & F::mask); }
+};
+
+template <unsigned int Addr, unsigned int Width>
+struct Reg {
+  typedef typename RegWidth<Width>::type value_type;
+  static constexpr unsigned int address = Addr;
+  static constexpr unsigned int width   = Width;
+  static_assert(Addr % (Width / 8) == 0, "Register address is not aligned to its width");
+
+  static volatile value_type *ptr() { return (volatile value_type *)(RA4M1_MMIO_ADDR(Addr)); }
+  static value_type read() { return mmio_read<value_type>(Addr); }
+  static void write(value_type v) { mmio_write<value_type>(Addr, v); }
+
+  // Read-modify-write of any number of fields: one load, one store
+  template <typename... F>
+  static void modify(FieldValue<F>... fv) {
+    static_assert(sizeof...(F) > 0, "modify() needs at least one field");
+    static_assert((same_reg<typename F::reg>() && ...), "All fields must belong to this register");
+    constexpr value_type mask = (value_type)(F::mask | ... | 0);
+    value_type v = read();
+    write((value_type)((v & (value_type)~mask) | (fv.bits() | ... | 0)));
+  }
+
+  // Write of the given fields, all others zero: one store, no load
+  template <typename... F>
+  static void assign(FieldValue<F>... fv) {
+    static_assert((same_reg<typename F::reg>() && ...), "All fields must belong to this register");
+    write((value_type)(fv.bits() | ... | 0));
+  }
+
+ private:
+  template <typename R> static constexpr bool same_reg() { return R::address == Addr && R::width == Width; }
+};
+
+template <typename R, unsigned int Pos, unsigned int Len>
+struct Field {
+  typedef R reg;
+  typedef typename R::value_type value_type;
+  static constexpr unsigned int pos = Pos;
+  static constexpr unsigned int len = Len;
+  static_assert(Len >= 1 && Pos + Len <= R::width, "Field does not fit in its register");
+  static constexpr unsigned int max  = (unsigned int)((1ULL << Len) - 1);
+  static constexpr value_type   mask = (value_type)(max << Pos);
+
+  // SCKDIVCR::PCKB.set<4>() - a constant to hand to modify() / assign(), checked at compile time
+  template <unsigned int V>
+  static constexpr FieldValue<Field> set() {
+    static_assert(V <= max, "Value does not fit in field");
+    return FieldValue<Field>{V};
+  }
+
+  // SCKDIVCR::PCKB = div - a value known only at run time, masked to the field
+  constexpr FieldValue<Field> operator=(unsigned int v) const {
+    return (__builtin_constant_p(v) && v > max) ? (field_value_out_of_range(), FieldValue<Field>{v & max}) : FieldValue<Field>{v & max};
+  }
+
+  static unsigned int read() { return (unsigned int)((R::read() & mask) >> Pos); }
+  static void write(unsigned int v) { R::modify(FieldValue<Field>{v & max}); }
+};
+
+// A register's field from its bit define, the width from the define's _hi_lo suffix - inside a
+// register struct, which has the typedef R: RA4M1_FIELD(PCKB, SCKDIVCR_PCKB, 2, 0)
+#define RA4M1_FIELD(name, define, hi, lo) static constexpr ra4m1::Field<R, define##_##hi##_##lo, (hi) - (lo) + 1> name{}
+#define RA4M1_BIT(name, define)           static constexpr ra4m1::Field<R, define, 1> name{}
+
+// Single bit, from any existing bit define: ra4m1::Bit<MSTPCRD, MSTPD16>
+template <typename R, unsigned int Pos>
+using Bit = Field<R, Pos, 1>;
+
+template <typename F0, typename... F>
+inline void modify(FieldValue<F0> f0, FieldValue<F>... fv) { F0::reg::modify(f0, fv...); }
+
+template <typename F0, typename... F>
+inline void assign(FieldValue<F0> f0, FieldValue<F>... fv) { F0::reg::assign(f0, fv...); }
+
+
+// ==== Cortex-M4 Bit-Band ====
+// Same sum as BITBAND_PERI() / BITBAND_SRAM(), but usable at compile time
+
+constexpr bool bitband_peri(unsigned int addr) { return addr >= BITBAND_PERI_BASE && addr < BITBAND_PERI_BASE + 0x100000; }
+constexpr bool bitband_sram(unsigned int addr) { return addr >= BITBAND_SRAM_BASE && addr < BITBAND_SRAM_BASE + 0x100000; }
+
+constexpr unsigned int bitband_alias(unsigned int addr, unsigned int bit) {
+  return bitband_peri(addr) ? BITBAND_PERI_ALIAS + ((addr - BITBAND_PERI_BASE) * 32) + (bit * 4)
+       : bitband_sram(addr) ? BITBAND_SRAM_ALIAS + ((addr - BITBAND_SRAM_BASE) * 32) + (bit * 4)
+       : 0;  // Not bit-band capable
+}
+
+// Single store set / clear of one bit: ra4m1::BitBand<AGT0::AGTCR, AGTCR_TSTART>::set();
+template <typename R, unsigned int Pos>
+struct BitBand {
+  static_assert(Pos < R::width, "Bit is outside the register");
+  static_assert(bitband_peri(R::address), "Register is not in the peripheral bit-band region");
+  static constexpr unsigned int alias = bitband_alias(R::address, Pos);
+
+  static void set()   { mmio_write<unsigned int>(alias, 1); }
+  static void clear() { mmio_write<unsigned int>(alias, 0); }
+  static void write(bool b) { mmio_write<unsigned int>(alias, b); }
+  static bool read()  { return mmio_read<unsigned int>(alias) != 0; }
+};
+
+// Worked by hand - host/bitband.cpp checks the same against the register defines themselves
+static_assert(bitband_alias(AGTBASE + 0x008, AGTCR_TSTART) == 0x43080100, "AGT0_AGTCR.TSTART alias");
+static_assert(bitband_alias(ADCBASE + 0xC000, ADCSR_ADST)  == 0x42B8003C, "ADC140_ADCSR.ADST alias");
+static_assert(bitband_alias(MSTP + 0x7008, MSTPD16)        == 0x428E0140, "MSTP_MSTPCRD.MSTPD16 alias");
+static_assert(bitband_alias(SCIBASE + 0x0002, SCR_TE)      == 0x42E00054, "SCI0_SCR.TE alias");
+static_assert(bitband_alias(SYSTEM + 0xE03C, OSCSF_PLLSF)  == 0x423C0794, "SYSTEM_OSCSF.PLLSF alias");
+static_assert(bitband_alias(0x20000004, 31) == 0x220000FC, "SRAM alias");
+
+
+// ==== System & Clock Generation ====
+// Note: field names are those of the bit defines with the register prefix and width suffix dropped
+
+struct PRCR : Reg<SYSTEM + 0xE3FE, 16> {  // Protect Register
+  typedef Reg<SYSTEM + 0xE3FE, 16> R;
+  RA4M1_BIT(PRC0, PRCR_PRC0);
+  RA4M1_BIT(PRC1, PRCR_PRC1);
+  RA4M1_BIT(PRC3, PRCR_PRC3);
+  RA4M1_FIELD(PRKEY, PRCR_PRKEY, 7, 0);
+};
+
+struct SCKDIVCR : Reg<SYSTEM + 0xE020, 32> {  // System Clock Division Control Register
+  typedef Reg<SYSTEM + 0xE020, 32> R;
+  RA4M1_FIELD(PCKD, SCKDIVCR_PCKD, 2, 0);
+  RA4M1_FIELD(PCKC, SCKDIVCR_PCKC, 2, 0);
+  RA4M1_FIELD(PCKB, SCKDIVCR_PCKB, 2, 0);
+  RA4M1_FIELD(PCKA, SCKDIVCR_PCKA, 2, 0);
+  RA4M1_FIELD(ICK, SCKDIVCR_ICK, 2, 0);
+  RA4M1_FIELD(FCK, SCKDIVCR_FCK, 2, 0);
+};
+
+struct SCKSCR : Reg<SYSTEM + 0xE026, 8> {  // System Clock Source Control Register
+  typedef Reg<SYSTEM + 0xE026, 8> R;
+  RA4M1_FIELD(CKSEL, SCKSCR_CKSEL, 2, 0);
+};
+
+struct PLLCR : Reg<SYSTEM + 0xE02A, 8> {  // PLL Control Register
+  typedef Reg<SYSTEM + 0xE02A, 8> R;
+  RA4M1_BIT(PLLSTP, PLLCR_PLLSTP);
+};
+
+struct PLLCCR2 : Reg<SYSTEM + 0xE02B, 8> {  // PLL Clock Control Register 2
+  typedef Reg<SYSTEM + 0xE02B, 8> R;
+  RA4M1_FIELD(PLLMUL, PLLCCR2_PLLMUL, 4, 0);
+  RA4M1_FIELD(PLODIV, PLLCCR2_PLODIV, 1, 0);
+};
+
+struct MEMWAIT : Reg<SYSTEM + 0xE031, 8> {  // Memory Wait Cycle Control Register
+  typedef Reg<SYSTEM + 0xE031, 8> R;
+  RA4M1_BIT(WAIT, MEMWAIT_MEMWAIT);  // MEMWAIT bit - renamed, a member can't share the class name
+};
+
+struct MOSCCR : Reg<SYSTEM + 0xE032, 8> {  // Main Clock Oscillator Control Register
+  typedef Reg<SYSTEM + 0xE032, 8> R;
+  RA4M1_BIT(MOSTP, MOSCCR_MOSTP);
+};
+
+struct HOCOCR : Reg<SYSTEM + 0xE036, 8> {  // High-Speed On-Chip Oscillator Control Register
+  typedef Reg<SYSTEM + 0xE036, 8> R;
+  RA4M1_BIT(HCSTP, HOCOCR_HCSTP);
+};
+
+struct MOCOCR : Reg<SYSTEM + 0xE038, 8> {  // Middle-Speed On-Chip Oscillator Control Register
+  typedef Reg<SYSTEM + 0xE038, 8> R;
+  RA4M1_BIT(MCSTP, MOCOCR_MCSTP);
+};
+
+struct OSCSF : Reg<SYSTEM + 0xE03C, 8> {  // Oscillation Stabilization Flag Register
+  typedef Reg<SYSTEM + 0xE03C, 8> R;
+  RA4M1_BIT(HOCOSF, OSCSF_HOCOSF);
+  RA4M1_BIT(MOSCSF, OSCSF_MOSCSF);
+  RA4M1_BIT(PLLSF, OSCSF_PLLSF);
+};
+
+struct CKOCR : Reg<SYSTEM + 0xE03E, 8> {  // Clock Out Control Register
+  typedef Reg<SYSTEM + 0xE03E, 8> R;
+  RA4M1_FIELD(CKOSEL, CKOCR_CKOSEL, 2, 0);
+  RA4M1_FIELD(CKODIV, CKOCR_CKODIV, 2, 0);
+  RA4M1_BIT(CKOEN, CKOCR_CKOEN);
+};
+
+struct MOCOUTCR : Reg<SYSTEM + 0xE061, 8> {  // MOCO User Trimming Control Register
+  typedef Reg<SYSTEM + 0xE061, 8> R;
+  RA4M1_FIELD(MOCOUTRM, MOCOUTCR_MOCOUTRM, 7, 0);
+};
+
+struct HOCOUTCR : Reg<SYSTEM + 0xE062, 8> {  // HOCO User Trimming Control Register
+  typedef Reg<SYSTEM + 0xE062, 8> R;
+  RA4M1_FIELD(HOCOUTRM, HOCOUTCR_HOCOUTRM, 7, 0);
+};
+
+struct MOSCWTCR : Reg<SYSTEM + 0xE0A2, 8> {  // Main Clock Oscillator Wait Control Register
+  typedef Reg<SYSTEM + 0xE0A2, 8> R;
+  RA4M1_FIELD(MSTS, MOSCWTCR_MSTS, 3, 0);
+};
+
+struct HOCOWTCR : Reg<SYSTEM + 0xE0A5, 8> {  // High-Speed On-Chip Oscillator Wait Control Register
+  typedef Reg<SYSTEM + 0xE0A5, 8> R;
+  RA4M1_FIELD(MSTS, HOCOWTCR_MSTS, 2, 0);
+};
+
+struct MOMCR : Reg<SYSTEM + 0xE413, 8> {  // Main Clock Oscillator Mode Oscillation Control Register
+  typedef Reg<SYSTEM + 0xE413, 8> R;
+  RA4M1_BIT(MODRV1, MOMCR_MODRV1);
+  RA4M1_BIT(MOSEL, MOMCR_MOSEL);
+};
+
+struct LOCOCR : Reg<SYSTEM + 0xE490, 8> {  // Low-Speed On-Chip Oscillator Control Register
+  typedef Reg<SYSTEM + 0xE490, 8> R;
+  RA4M1_BIT(LCSTP, LOCOCR_LCSTP);
+};
+
+struct LOCOUTCR : Reg<SYSTEM + 0xE492, 8> {  // LOCO User Trimming Control Register
+  typedef Reg<SYSTEM + 0xE492, 8> R;
+  RA4M1_FIELD(LOCOUTRM, LOCOUTCR_LOCOUTRM, 7, 0);
+};
+
+struct RSTSR2 : Reg<SYSTEM + 0xE411, 8> {  // Reset Status Register 2
+  typedef Reg<SYSTEM + 0xE411, 8> R;
+  RA4M1_BIT(CWSF, RSTSR2_CWSF);
+};
+
+// Module stop - the MSTPxn bit defines are plain numbers, use them as Bit<MSTPCRD, MSTPD16>
+typedef Reg<SYSTEM + 0xE01C, 32> MSTPCRA;  // Module Stop Control Register A - PRC1
+typedef Reg<MSTP + 0x7000, 32> MSTPCRB;  // Module Stop Control Register B
+typedef Reg<MSTP + 0x7004, 32> MSTPCRC;  // Module Stop Control Register C
+typedef Reg<MSTP + 0x7008, 32> MSTPCRD;  // Module Stop Control Register D
+
+
+// ==== Clock Frequency Accuracy Measurement Circuit (CAC) ====
+
+struct CACR0 : Reg<CACBASE + 0x4600, 8> {  // CAC Control Register 0
+  typedef Reg<CACBASE + 0x4600, 8> R;
+  RA4M1_BIT(CFME, CACR0_CFME);
+};
+
+struct CACR1 : Reg<CACBASE + 0x4601, 8> {  // CAC Control Register 1
+  typedef Reg<CACBASE + 0x4601, 8> R;
+  RA4M1_BIT(CACREFE, CACR1_CACREFE);
+  RA4M1_FIELD(FMCS, CACR1_FMCS, 2, 0);
+  RA4M1_FIELD(TCSS, CACR1_TCSS, 1, 0);
+  RA4M1_FIELD(EDGES, CACR1_EDGES, 1, 0);
+};
+
+struct CACR2 : Reg<CACBASE + 0x4602, 8> {  // CAC Control Register 2
+  typedef Reg<CACBASE + 0x4602, 8> R;
+  RA4M1_BIT(RPS, CACR2_RPS);
+  RA4M1_FIELD(RSCS, CACR2_RSCS, 2, 0);
+  RA4M1_FIELD(RCDS, CACR2_RCDS, 1, 0);
+  RA4M1_FIELD(DFS, CACR2_DFS, 1, 0);
+};
+
+struct CAICR : Reg<CACBASE + 0x4603, 8> {  // CAC Interrupt Control Register
+  typedef Reg<CACBASE + 0x4603, 8> R;
+  RA4M1_BIT(FERRIE, CAICR_FERRIE);
+  RA4M1_BIT(MENDIE, CAICR_MENDIE);
+  RA4M1_BIT(OVFIE, CAICR_OVFIE);
+  RA4M1_BIT(FERRFCL, CAICR_FERRFCL);
+  RA4M1_BIT(MENDFCL, CAICR_MENDFCL);
+  RA4M1_BIT(OVFFCL, CAICR_OVFFCL);
+};
+
+struct CASTR : Reg<CACBASE + 0x4604, 8> {  // CAC Status Register
+  typedef Reg<CACBASE + 0x4604, 8> R;
+  RA4M1_BIT(FERRF, CASTR_FERRF);
+  RA4M1_BIT(MENDF, CASTR_MENDF);
+  RA4M1_BIT(OVFF, CASTR_OVFF);
+};
+
+typedef Reg<CACBASE + 0x4606, 16> CAULVR;   // CAC Upper-Limit Value Setting Register
+typedef Reg<CACBASE + 0x4608, 16> CALLVR;   // CAC Lower-Limit Value Setting Register
+typedef Reg<CACBASE + 0x460A, 16> CACNTBR;  // CAC Counter Buffer Register
+
+
+// ==== 14-Bit A/D Converter ====
+
+struct ADCSR : Reg<ADCBASE + 0xC000, 16> {  // A/D Control Register
+  typedef Reg<ADCBASE + 0xC000, 16> R;
+  RA4M1_FIELD(DBLANS, ADCSR_DBLANS, 4, 0);
+  RA4M1_BIT(GBADIE, ADCSR_GBADIE);
+  RA4M1_BIT(DBLE, ADCSR_DBLE);
+  RA4M1_BIT(EXTRG, ADCSR_EXTRG);
+  RA4M1_BIT(TRGE, ADCSR_TRGE);
+  RA4M1_BIT(ADHSC, ADCSR_ADHSC);
+  RA4M1_FIELD(ADCS, ADCSR_ADCS, 1, 0);
+  RA4M1_BIT(ADST, ADCSR_ADST);
+};
+
+typedef Reg<ADCBASE + 0xC004, 16> ADANSA0;  // A/D Channel Select Register A0 - ADANSA0_ANSAnn bits
+typedef Reg<ADCBASE + 0xC006, 16> ADANSA1;  // A/D Channel Select Register A1 - ADANSA1_ANSAnn bits
+typedef Reg<ADCBASE + 0xC008, 16> ADADS0;   // A/D-Converted Value Addition/Average Channel Select Register 0
+typedef Reg<ADCBASE + 0xC00A, 16> ADADS1;   // A/D-Converted Value Addition/Average Channel Select Register 1
+typedef Reg<ADCBASE + 0xC014, 16> ADANSB0;  // A/D Channel Select Register B0
+typedef Reg<ADCBASE + 0xC016, 16> ADANSB1;  // A/D Channel Select Register B1
+
+struct ADCER : Reg<ADCBASE + 0xC00E, 16> {  // A/D Control Extended Register
+  typedef Reg<ADCBASE + 0xC00E, 16> R;
+  RA4M1_FIELD(ADPCR, ADCER_ADPCR, 1, 0);
+  RA4M1_BIT(ACE, ADCER_ACE);
+  RA4M1_FIELD(DIAGVAL, ADCER_DIAGVAL, 1, 0);
+  RA4M1_BIT(DIAGLD, ADCER_DIAGLD);
+  RA4M1_BIT(DIAGM, ADCER_DIAGM);
+  RA4M1_BIT(ADRFMT, ADCER_ADRFMT);
+};
+
+struct ADSTRGR : Reg<ADCBASE + 0xC010, 16> {  // A/D Conversion Start Trigger Select Register
+  typedef Reg<ADCBASE + 0xC010, 16> R;
+  RA4M1_FIELD(TRSB, ADSTRGR_TRSB, 5, 0);
+  RA4M1_FIELD(TRSA, ADSTRGR_TRSA, 5, 0);
+};
+
+struct ADEXICR : Reg<ADCBASE + 0xC012, 16> {  // A/D Conversion Extended Input Control Register
+  typedef Reg<ADCBASE + 0xC012, 16> R;
+  RA4M1_BIT(TSSAD, ADEXICR_TSSAD);
+  RA4M1_BIT(OCSAD, ADEXICR_OCSAD);
+  RA4M1_BIT(TSSA, ADEXICR_TSSA);
+  RA4M1_BIT(OCSA, ADEXICR_OCSA);
+};
+
+struct ADGSPCR : Reg<ADCBASE + 0xC080, 16> {  // A/D Group Scan Priority Control Register
+  typedef Reg<ADCBASE + 0xC080, 16> R;
+  RA4M1_BIT(PGS, ADGSPCR_PGS);
+  RA4M1_BIT(GBRSCN, ADGSPCR_GBRSCN);
+  RA4M1_BIT(GBRP, ADGSPCR_GBRP);
+};
+
+struct ADCMPCR : Reg<ADCBASE + 0xC090, 16> {  // A/D Compare Function Control Register
+  typedef Reg<ADCBASE + 0xC090, 16> R;
+  RA4M1_FIELD(CMPAB, ADCMPCR_CMPAB, 1, 0);
+  RA4M1_BIT(CMPBE, ADCMPCR_CMPBE);
+  RA4M1_BIT(CMPAE, ADCMPCR_CMPAE);
+  RA4M1_BIT(CMPBIE, ADCMPCR_CMPBIE);
+  RA4M1_BIT(WCMPE, ADCMPCR_WCMPE);
+  RA4M1_BIT(CMPAIE, ADCMPCR_CMPAIE);
+};
+
+struct ADADC : Reg<ADCBASE + 0xC00C, 8> {  // A/D-Converted Value Addition/Average Count Select Register
+  typedef Reg<ADCBASE + 0xC00C, 8> R;
+  RA4M1_FIELD(ADC, ADADC_ADC, 2, 0);  // ADC_AVG_1 .. ADC_AVG_16
+  RA4M1_BIT(AVEE, ADADC_AVEE);
+};
+
+
+// ====  Asynchronous General Purpose Timer (AGT) =====
+
+template <unsigned int N>
+struct AGTn {
+  static_assert(N <= 1, "AGT0 and AGT1 only");
+  typedef Reg<AGTBASE + 0x000 + (N * 0x100), 16> AGT;     // AGT Counter Register
+  typedef Reg<AGTBASE + 0x002 + (N * 0x100), 16> AGTCMA;  // AGT Compare Match A Register
+  typedef Reg<AGTBASE + 0x004 + (N * 0x100), 16> AGTCMB;  // AGT Compare Match B Register
+  struct AGTCR : Reg<AGTBASE + 0x008 + (N * 0x100), 8> {  // AGT Control Register
+    typedef Reg<AGTBASE + 0x008 + (N * 0x100), 8> R;
+    RA4M1_BIT(TSTART, AGTCR_TSTART);
+    RA4M1_BIT(TCSTF, AGTCR_TCSTF);
+    RA4M1_BIT(TSTOP, AGTCR_TSTOP);
+  };
+  typedef Reg<AGTBASE + 0x009 + (N * 0x100), 8> AGTMR1;   // AGT Mode Register 1
+  typedef Reg<AGTBASE + 0x00A + (N * 0x100), 8> AGTMR2;   // AGT Mode Register 2
+};
+typedef AGTn<0> AGT0;
+typedef AGTn<1> AGT1;
+
+
+// ==== DMA Controller (DMAC) ====
+
+template <unsigned int N>
+struct DMACn {
+  static_assert(N <= 3, "DMAC0 - DMAC3 only");
+  static constexpr unsigned int base = DMACBASE + N * 0x40;
+  typedef Reg<base + DMSAR, 32> SAR;  // Source Address
+  typedef Reg<base + DMDAR, 32> DAR;  // Destination Address
+  typedef Reg<base + DMCRA, 32> CRA;  // Transfer Count
+  typedef Reg<base + DMCRB, 16> CRB;  // Block Transfer Count
+  struct TMD : Reg<base + DMTMD, 16> {  // Transfer Mode
+    typedef Reg<base + DMTMD, 16> R;
+    RA4M1_FIELD(DCTG, DMTMD_DCTG, 1, 0);
+    RA4M1_FIELD(SZ, DMTMD_SZ, 1, 0);
+    RA4M1_FIELD(DTS, DMTMD_DTS, 1, 0);
+    RA4M1_FIELD(MD, DMTMD_MD, 1, 0);
+  };
+  typedef Reg<base + DMINT, 8> INT;   // Interrupt Setting
+  struct AMD : Reg<base + DMAMD, 16> {  // Address Mode
+    typedef Reg<base + DMAMD, 16> R;
+    RA4M1_FIELD(DARA, DMAMD_DARA, 4, 0);
+    RA4M1_FIELD(DM, DMAMD_DM, 1, 0);
+    RA4M1_FIELD(SARA, DMAMD_SARA, 4, 0);
+    RA4M1_FIELD(SM, DMAMD_SM, 1, 0);
+  };
+  typedef Reg<base + DMOFR, 32> OFR;  // Offset
+  typedef Reg<base + DMCNT, 8> CNT;   // Transfer Enable
+  typedef Reg<base + DMREQ, 8> REQ;   // Software Start
+  typedef Reg<base + DMSTS, 8> STS;   // Status
+  typedef Reg<ICUBASE + DELSR + N * 4, 32> DELSRn;  // Start event
+};
+typedef DMACn<0> DMAC0;
+typedef DMACn<1> DMAC1;
+typedef DMACn<2> DMAC2;
+typedef DMACn<3> DMAC3;
+typedef Reg<DMACBASE + 0x0200, 8> DMAST;  // DMA Module Activation
+
+}  // namespace ra4m1
+
+#endif  // SUSAN_RA4M1_MINIMA_REGISTER_TYPES_H